@@ -1,7 +1,9 @@
 // Autogenerated include file for Selector instantiation handling...
 #include <string>
+#include "ExpressionSelector.h"
 #include "MySelector.h"
-#define CREATE_SELECTOR(name,config,service,pointer) \
+#define CREATE_SELECTOR(type,name,config,service,pointer) \
 pointer = 0; \
-if (!std::string(name).compare("MySelector")) pointer = new MySelector(name,config,service); \
+if (!std::string(type).compare("ExpressionSelector")) pointer = new ExpressionSelector(name,config,service); \
+if (!std::string(type).compare("MySelector")) pointer = new MySelector(name,config,service); \
 // EOL
@@ -0,0 +1,10 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __ALLOCATIONHOOKS__
+#define __ALLOCATIONHOOKS__
+
+// Replacements of the global operator new and delete (AllocationHooks.cxx), which forward to malloc
+// and free, and count allocations in the context of the calling thread while AllocationProfiler is
+// enabled. They are only linked into bin/AnalysisManager (see Makefile) - other executables keep
+// the standard operators.
+
+#endif
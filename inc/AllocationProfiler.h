@@ -0,0 +1,63 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __ALLOCATIONPROFILER__
+#define __ALLOCATIONPROFILER__
+
+// Standard Template Library includes
+#include <string>
+#include <cstddef>
+
+// Analysis includes
+#include "Log.h"
+
+
+// Counts heap allocations (global operator new and delete are replaced by counting versions, which
+// only count once enabled - see AllocationHooks.h, they are only linked into bin/AnalysisManager). Allocations are attributed to the context of the calling thread - a
+// selector or a phase of the framework - set with a Scope:
+//
+//   const unsigned int context = AllocationProfiler::AddContext("read entry");
+//   ...
+//   {
+//     AllocationProfiler::Scope scope(context);
+//     service.GetEntry(event);
+//   }
+//
+// Allocations outside any scope are attributed to context 0 ("other").
+class AllocationProfiler {
+
+public:
+
+  // maximum number of contexts (further contexts are counted as "other")
+  static const unsigned int MAXCONTEXTS = 256;
+
+  // start or stop counting, and set counters of all contexts to zero (e.g. at the start of a run)
+  static void Enable(bool enable);
+  static bool IsEnabled();
+  static void Reset();
+
+  // add context, returns its index (the same index for the same name)
+  static unsigned int AddContext(const std::string & name);
+
+  // set context of calling thread, returns previous context
+  static unsigned int SetContext(unsigned int context);
+
+  // count allocation or deallocation in context of calling thread (used by operator new and delete)
+  static void CountAllocation(std::size_t bytes);
+  static void CountDeallocation();
+
+  // print allocations per event of each context that allocated
+  static void Report(long nEvents, const Log::LEVEL & logLevel);
+
+  // set context of calling thread while in scope
+  class Scope {
+  public:
+    Scope(unsigned int context) : m_previous( SetContext(context) ) {}
+    ~Scope() { SetContext(m_previous); }
+  private:
+    Scope(const Scope &);
+    Scope & operator=(const Scope &);
+    unsigned int m_previous;
+  };
+
+};
+
+#endif
@@ -0,0 +1,225 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __BULKREADER__
+#define __BULKREADER__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+
+// ROOT includes
+#include "TBufferFile.h"
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "ColumnFormat.h"
+
+// forward declarations
+class TTree;
+class TBranch;
+
+
+// Connects a simple variable (int, float,...) to a branch read in bulk. The entries of a basket are
+// decoded in one call into a contiguous array, and each entry is copied from the array.
+class BulkBindingBase {
+
+public:
+
+  // constructor
+  BulkBindingBase(const std::string & name) : m_name(name), m_branch(0), m_first(0), m_n(0), m_entry(0), m_nBaskets(0) {}
+
+  // destructor
+  virtual ~BulkBindingBase() {}
+
+  // name of variable
+  const std::string & GetName() const { return m_name; }
+
+  // element type code (see ColumnFormat.h), 0 if variable type is not supported
+  virtual char GetType() const = 0;
+
+  // set branch (0 if it can't be read in bulk)
+  void SetBranch(TBranch * branch) { m_branch = branch; m_first = m_n = 0; }
+  TBranch * GetBranch() const { return m_branch; }
+
+  // copy value of entry to variable (the basket holding entry is read if needed)
+  bool Read(long entry, TBufferFile & buffer)
+  {
+    if ( ( entry < m_first || entry >= m_first + m_n ) && ! Load(entry,buffer) ) return false;
+    m_entry = entry;
+    Copy( entry - m_first );
+    return true;
+  }
+
+  // number of baskets read
+  long GetNBaskets() const { return m_nBaskets; }
+
+  // values of last entry read and the following entries of its basket (n values)
+  const void * GetValues(long & n) const
+  {
+    n = m_first + m_n - m_entry;
+    return GetArray( m_entry - m_first );
+  }
+
+
+protected:
+
+  // store n decoded values, copy value i to variable, and address of value i
+  virtual void         Store(const char * data, long n) = 0;
+  virtual void         Copy(long i) = 0;
+  virtual const void * GetArray(long i) const = 0;
+
+
+private:
+
+  // read basket holding entry
+  bool Load(long entry, TBufferFile & buffer);
+
+  std::string m_name;
+  TBranch *   m_branch;
+  long        m_first;   // first entry of basket in array
+  long        m_n;       // number of entries in array
+  long        m_entry;   // last entry read
+  long        m_nBaskets;
+
+};
+
+
+// variables that can't be read in bulk (vectors, objects owned by ROOT,...) - read by TTree::GetEntry()
+template <class T, bool = std::is_arithmetic<T>::value>
+class BulkBinding : public BulkBindingBase {
+
+public:
+
+  BulkBinding(const std::string & name, T * /*addr*/) : BulkBindingBase(name) {}
+
+  char GetType() const { return 0; }
+
+
+protected:
+
+  void         Store(const char * /*data*/, long /*n*/) {}
+  void         Copy(long /*i*/)                         {}
+  const void * GetArray(long /*i*/) const               { return 0; }
+
+};
+
+
+// simple variables (int, float,...)
+template <class T>
+class BulkBinding<T,true> : public BulkBindingBase {
+
+public:
+
+  BulkBinding(const std::string & name, T * addr) : BulkBindingBase(name), m_addr(addr) {}
+
+  char GetType() const { return COLUMNFORMAT::TypeCode<T>(); }
+
+
+protected:
+
+  void Store(const char * data, long n) 
+  { 
+    m_values.resize(n);
+    std::memcpy( m_values.data() , data , n * sizeof(T) );
+  }
+  void         Copy(long i)           { *m_addr = m_values[i]; }
+  const void * GetArray(long i) const { return m_values.data() + i; }
+
+
+private:
+
+  T *            m_addr;
+  std::vector<T> m_values;
+
+};
+
+
+// vector<bool> is not contiguous - values are kept as bytes
+template <>
+class BulkBinding<bool,true> : public BulkBindingBase {
+
+public:
+
+  BulkBinding(const std::string & name, bool * addr) : BulkBindingBase(name), m_addr(addr) {}
+
+  char GetType() const { return COLUMNFORMAT::TypeCode<bool>(); }
+
+
+protected:
+
+  void Store(const char * data, long n) 
+  { 
+    m_values.resize(n);
+    std::memcpy( m_values.data() , data , n );
+  }
+  void         Copy(long i)           { *m_addr = m_values[i] != 0; }
+  const void * GetArray(long i) const { return m_values.data() + i; }
+
+
+private:
+
+  bool *                     m_addr;
+  std::vector<unsigned char> m_values;
+
+};
+
+
+// Bulk reading of the fixed-size scalar branches of the input tree (useBulkRead in the card file):
+// ROOT decodes all entries of a basket in one call (TBranch::GetBulkRead()) into a contiguous
+// array, instead of unpacking each entry through TTree::GetEntry(). The variables connected by
+// selectors are kept up to date by copying each entry from the array, so GetVariable() pointers
+// work unchanged, and batch-style code can use the arrays directly (Service::GetBulkValues()).
+// Branches that can't be read in bulk (vectors, arrays, several leaves, or old file formats) are
+// read by TTree::GetEntry() as usual.
+class BulkReader {
+
+public:
+
+  // constructor
+  BulkReader(const Log::LEVEL & logLevel);
+
+  // destructor
+  ~BulkReader();
+
+  // forget connected variables of previous input tree
+  void NewInputFile(TTree * tree);
+
+  // register variable connected in input tree (takes ownership)
+  void AddBinding(BulkBindingBase * binding);
+
+  // choose branches read in bulk, and exclude them from TTree::GetEntry() (once all variables are connected)
+  GLOBAL::STATUS Prepare();
+  bool IsPrepared() const { return m_prepared; }
+
+  // copy entry of branches read in bulk to connected variables
+  GLOBAL::STATUS Read(long entry);
+
+  // binding of branch read in bulk (0 if not read in bulk)
+  const BulkBindingBase * GetBinding(const std::string & name) const;
+
+
+private:
+
+  // check if branch is a fixed-size scalar of type that supports bulk reads
+  bool IsSupported(const BulkBindingBase & binding, TBranch * branch, std::string & reason) const;
+
+  TTree *                          m_tree;
+  bool                             m_prepared;
+  std::vector<BulkBindingBase *>   m_bindings;
+  std::vector<BulkBindingBase *>   m_bulk;
+  TBufferFile                      m_buffer;
+
+  // entries and baskets read in bulk (summed over all input files)
+  long                             m_nEntries;
+  long                             m_nBaskets;
+
+  // add baskets read of current input file, and delete bindings
+  void Finish();
+
+  mutable Log                      m_log;
+
+};
+
+#endif
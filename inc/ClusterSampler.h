@@ -0,0 +1,104 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __CLUSTERSAMPLER__
+#define __CLUSTERSAMPLER__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "PassBitmap.h"
+
+// forward declarations
+class TTree;
+class TDirectory;
+
+
+// Selection of a subset of the input, e.g. to iterate quickly on cuts. Whole clusters of the input
+// tree are selected, so the baskets of the other clusters are never read or decompressed:
+//
+//   int    prescale       = 10     (every 10th cluster)
+//   double sampleFraction = 0.05   (each cluster with probability 0.05)
+//   int    sampleSeed     = 1
+//
+// The random selection depends only on the seed, the input file name and the first entry of the
+// cluster, so it is reproducible. Both may be given, then a cluster must pass both. With random
+// order, the selected clusters of each input file are read in an order shuffled with the seed, so
+// the event loop can stop early (see Convergence.h) with an unbiased subset of the input.
+//
+// The fraction of entries in the clusters read is used to scale the histograms to the full input,
+// and is stored in histogram "sampling" of the output (bin 1: entries read, bin 2: entries of
+// input, so merged outputs keep the right fraction).
+class ClusterSampler {
+
+public:
+
+  // constructor (prescale <= 1 and fraction >= 1 select everything)
+  ClusterSampler(int prescale, double fraction, unsigned long seed, bool randomOrder, const Log::LEVEL & logLevel);
+
+  // true if clusters are selected or reordered, and if not all clusters are selected
+  bool IsActive() const { return IsSubset() || m_randomOrder; }
+  bool IsSubset() const { return m_prescale > 1 || m_fraction < 1.; }
+
+  // set number of entries of all input files
+  void SetInputEntries(long nEntries) { m_nEntries = nEntries; }
+
+  // select clusters of tree (entries to read are set in bitmap, which may be reduced further
+  // before the first entry is requested)
+  GLOBAL::STATUS Select(TTree * tree, const std::string & fileName, PassBitmap & entries);
+
+  // first entry to read, and next entry to read after given entry of current cluster (number of
+  // entries of tree if there is none)
+  long FirstEntry();
+  long NextEntry(long entry);
+
+  // stop reading before given entry of current cluster - the entries of the cluster before it were
+  // read, and are counted (call when the event loop ends early)
+  void Stop(long entry);
+
+  // true if entry returned last is the first read of its cluster
+  bool IsNewCluster() const { return m_newCluster; }
+
+  // fraction of entries of input in clusters read (1 if nothing was read)
+  double GetEffectiveFraction() const;
+
+  // scale histograms in directory to the full input
+  void Scale(TDirectory * dir) const;
+
+  // write histogram with entries read and entries of input to directory
+  void Annotate(TDirectory * dir) const;
+
+  // print numbers of clusters and entries read, and speedup
+  void Report(double duration) const;
+
+
+private:
+
+  // 64 random bits for cluster of file
+  unsigned long long Hash(const std::string & fileName, long firstEntry) const;
+
+  int            m_prescale;
+  double         m_fraction;
+  unsigned long  m_seed;
+  bool           m_randomOrder;
+
+  // selected clusters of current tree [first,last), in the order they are read
+  std::vector<std::pair<long,long> > m_clusters;
+  unsigned int                       m_cluster;
+  const PassBitmap *                 m_entries;
+  long                               m_treeEntries;
+  bool                               m_newCluster;
+
+  // clusters seen and read, entries of input and read
+  long           m_nClusters;
+  long           m_nClustersRead;
+  long           m_nEntries;
+  long           m_nEntriesRead;
+
+  mutable Log    m_log;
+
+};
+
+#endif
@@ -0,0 +1,190 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __COLUMNBINDING__
+#define __COLUMNBINDING__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Analysis includes
+#include "ColumnFormat.h"
+#include "ColumnReader.h"
+#include "ColumnWriter.h"
+
+
+// Connects a variable in the input or output tree to a column in a columnar file
+class ColumnBindingBase {
+
+public:
+
+  // constructor
+  ColumnBindingBase(const std::string & name) : m_name(name), m_column(-1), m_skipRead(false) {}
+
+  // destructor
+  virtual ~ColumnBindingBase() {}
+
+  // name of variable
+  const std::string & GetName() const { return m_name; }
+
+  // column index in file
+  int  GetColumn() const           { return m_column;   }
+  void SetColumn(const int column) { m_column = column; }
+
+  // don't copy values from reader to variable (nobody uses the variable itself)
+  bool IsSkipRead() const { return m_skipRead; }
+  void SkipRead()         { m_skipRead = true; }
+
+  // element type code (see ColumnFormat.h), 0 if variable type is not supported
+  virtual char GetType() const = 0;
+
+  // check if variable is a vector
+  virtual bool IsVector() const = 0;
+
+  // copy value of variable to writer
+  virtual void Write(ColumnWriter & writer) const = 0;
+
+  // copy value of entry from reader to variable
+  virtual void Read(const ColumnReader & reader, uint64_t entry) = 0;
+
+
+private:
+
+  std::string m_name;
+  int         m_column;
+  bool        m_skipRead;
+
+};
+
+
+// simple variables (int, float,...)
+template <class T>
+class ColumnBinding : public ColumnBindingBase {
+
+public:
+
+  ColumnBinding(const std::string & name, T * addr) : ColumnBindingBase(name), m_addr(addr) {}
+
+  char GetType() const  { return COLUMNFORMAT::TypeCode<T>(); }
+  bool IsVector() const { return false; }
+
+  void Write(ColumnWriter & writer) const { writer.Write(GetColumn(), m_addr, 1); }
+
+  void Read(const ColumnReader & reader, uint64_t entry) 
+  { 
+    size_t n = 0;
+    *m_addr = *reader.Get<T>(GetColumn(), entry, n); 
+  }
+
+private:
+
+  T * m_addr;
+
+};
+
+
+// non-simple variables (objects owned by ROOT) - not supported in general
+template <class T>
+class ColumnBinding<T *> : public ColumnBindingBase {
+
+public:
+
+  ColumnBinding(const std::string & name, T ** /*addr*/) : ColumnBindingBase(name) {}
+
+  char GetType() const  { return 0; }
+  bool IsVector() const { return false; }
+
+  void Write(ColumnWriter & /*writer*/) const {}
+  void Read(const ColumnReader & /*reader*/, uint64_t /*entry*/) {}
+
+};
+
+
+// vectors of simple variables
+template <class T>
+class ColumnBinding<std::vector<T> *> : public ColumnBindingBase {
+
+public:
+
+  ColumnBinding(const std::string & name, std::vector<T> ** addr) : ColumnBindingBase(name), m_addr(addr) {}
+
+  char GetType() const  { return COLUMNFORMAT::TypeCode<T>(); }
+  bool IsVector() const { return true; }
+
+  void Write(ColumnWriter & writer) const { writer.Write(GetColumn(), (*m_addr)->data(), (*m_addr)->size()); }
+
+  void Read(const ColumnReader & reader, uint64_t entry) 
+  { 
+    size_t n = 0;
+    const T * values = reader.Get<T>(GetColumn(), entry, n);
+    (*m_addr)->assign(values, values + n); 
+  }
+
+private:
+
+  std::vector<T> ** m_addr;
+
+};
+
+
+// vectors of simple variables (addressed directly)
+template <class T>
+class ColumnBinding<std::vector<T> > : public ColumnBindingBase {
+
+public:
+
+  ColumnBinding(const std::string & name, std::vector<T> * addr) : ColumnBindingBase(name), m_addr(addr) {}
+
+  char GetType() const  { return COLUMNFORMAT::TypeCode<T>(); }
+  bool IsVector() const { return true; }
+
+  void Write(ColumnWriter & writer) const { writer.Write(GetColumn(), m_addr->data(), m_addr->size()); }
+
+  void Read(const ColumnReader & reader, uint64_t entry) 
+  { 
+    size_t n = 0;
+    const T * values = reader.Get<T>(GetColumn(), entry, n);
+    m_addr->assign(values, values + n); 
+  }
+
+private:
+
+  std::vector<T> * m_addr;
+
+};
+
+
+// vector<bool> is not contiguous - not supported
+template <>
+class ColumnBinding<std::vector<bool> > : public ColumnBindingBase {
+
+public:
+
+  ColumnBinding(const std::string & name, std::vector<bool> * /*addr*/) : ColumnBindingBase(name) {}
+
+  char GetType() const  { return 0; }
+  bool IsVector() const { return true; }
+
+  void Write(ColumnWriter & /*writer*/) const {}
+  void Read(const ColumnReader & /*reader*/, uint64_t /*entry*/) {}
+
+};
+
+
+// vector<bool> is not contiguous - not supported
+template <>
+class ColumnBinding<std::vector<bool> *> : public ColumnBindingBase {
+
+public:
+
+  ColumnBinding(const std::string & name, std::vector<bool> ** /*addr*/) : ColumnBindingBase(name) {}
+
+  char GetType() const  { return 0; }
+  bool IsVector() const { return true; }
+
+  void Write(ColumnWriter & /*writer*/) const {}
+  void Read(const ColumnReader & /*reader*/, uint64_t /*entry*/) {}
+
+};
+
+#endif
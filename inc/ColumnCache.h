@@ -0,0 +1,93 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __COLUMNCACHE__
+#define __COLUMNCACHE__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "ColumnReader.h"
+#include "ColumnWriter.h"
+
+// forward declarations
+class TTree;
+class ColumnBindingBase;
+class ViewBase;
+
+
+// Cache of the variables connected in the input tree, stored as an uncompressed columnar 
+// file (see ColumnFormat.h) per input file. The first run over an input file writes the cache, 
+// and later runs with the same input file and the same set of connected variables read the 
+// memory-mapped cache instead of the input tree. The cache file name is derived from a hash of 
+// the input file identity (name, size, modification time, inode) and the set of variables.
+class ColumnCache {
+
+public:
+
+  enum MODE {
+    OFF   = 0,
+    READ  = 1,
+    WRITE = 2
+  };
+
+  // constructor
+  ColumnCache(const std::string & directory, const Log::LEVEL & logLevel);
+
+  // destructor (finishes cache for current input file)
+  ~ColumnCache();
+
+  // finish cache for previous input file, and start new one
+  GLOBAL::STATUS NewInputFile(TTree * tree, const std::string & fileName);
+
+  // register variable connected in input tree (takes ownership)
+  void AddBinding(ColumnBindingBase * binding);
+
+  // choose mode for current input file (once all variables are connected)
+  GLOBAL::STATUS Prepare();
+
+  // get state
+  bool IsPrepared() const { return m_prepared;      }
+  bool IsReading()  const { return m_mode == READ;  }
+  bool IsWriting()  const { return m_mode == WRITE; }
+
+  // copy entry from cache to connected variables
+  GLOBAL::STATUS Read(long entry);
+
+  // copy connected variables of entry to cache
+  GLOBAL::STATUS Write(long entry);
+
+  // point view at values of entry in the mapped cache (no copy), returns false if not possible
+  bool MapView(const std::string & name, long entry, ViewBase * view) const;
+
+  // stop copying vector variable from the cache, when it's only read through mapped views
+  void SkipRead(const std::string & name);
+
+
+private:
+
+  // commit (or discard) cache file for current input file, and forget connected variables
+  GLOBAL::STATUS Finish();
+
+  // describe input file and set of connected variables
+  std::string Identity() const;
+
+  std::string                      m_directory;
+  std::string                      m_fileName;
+  std::string                      m_cacheName;
+  TTree *                          m_tree;
+  long                             m_entries;
+  bool                             m_prepared;
+  MODE                             m_mode;
+  std::vector<ColumnBindingBase *> m_bindings;
+  std::map<std::string,int>        m_vectorColumns;
+  ColumnReader                     m_reader;
+  ColumnWriter                     m_writer;
+  Log                              m_log;
+
+};
+
+#endif
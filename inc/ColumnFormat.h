@@ -0,0 +1,82 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __COLUMNFORMAT__
+#define __COLUMNFORMAT__
+
+// Standard Template Library includes
+#include <cstddef>
+#include <cstring>
+#include <typeinfo>
+#include <type_traits>
+#include <stdint.h>
+
+
+// Chunked columnar binary format (".amcol"), designed to be memory-mapped by readers.
+// All integers are little-endian, and every data block starts at an 8-byte aligned offset,
+// so values can be used in place once the file is mapped.
+//
+//   Header  : char[8] "AMCOLUMN" | uint32 version | uint32 reserved (0)
+//
+//   Chunks  : each chunk holds a contiguous range of entries. For each column, in column order:
+//               offsets : uint64[nEntries+1]  (vector columns only) - element offsets of each
+//                         entry relative to the start of the chunk's values block, offsets[0] = 0
+//               values  : element data, nEntries elements for scalar columns, offsets[nEntries]
+//                         elements for vector columns
+//
+//   Footer  : uint32 nColumns
+//             per column   : uint32 nameLength | char[nameLength] name | char type | uint8 isVector | uint16 reserved (0)
+//             uint32 nMetadata
+//             per metadata : uint32 keyLength | char[keyLength] key | uint32 valueLength | char[valueLength] value
+//             uint32 nChunks
+//             per chunk    : uint64 firstEntry | uint64 nEntries
+//                            per column : uint64 valuesOffset | uint64 offsetsOffset (0 for scalar columns)
+//
+//   Trailer : uint64 footerOffset | char[8] "AMCOLEND"
+//
+// A file is either a column cache (see ColumnCache.h) or an output ntuple (outputFormats = columnar).
+// ColumnReader.h is a standalone reader, and bin/DumpColumnar prints the content of a file. 
+// Other tools can map a column block directly, e.g. numpy.frombuffer(mapped, dtype, count, offset).
+//
+// Offsets in the chunk table are absolute file offsets. The element type is encoded with the
+// same single-character code as typeid().name() uses for fundamental types:
+//
+//   b : bool           c : char           h : unsigned char
+//   s : short          t : unsigned short
+//   i : int            j : unsigned int   f : float
+//   l : long           m : unsigned long  x : long long       y : unsigned long long       d : double
+
+namespace COLUMNFORMAT {
+
+  const char     MAGIC[9]        = "AMCOLUMN";
+  const char     TRAILER[9]      = "AMCOLEND";
+  const uint32_t VERSION         = 1;
+  const size_t   HEADERSIZE      = 16;
+  const size_t   TRAILERSIZE     = 16;
+  const size_t   ALIGNMENT       = 8;
+
+  // size in bytes of element type (0 if type is not supported)
+  inline size_t ElementSize(char type)
+  {
+    switch (type) {
+    case 'b': case 'c': case 'h':                     return 1;
+    case 's': case 't':                               return 2;
+    case 'i': case 'j': case 'f':                     return 4;
+    case 'l': case 'm': case 'x': case 'y': case 'd': return 8;
+    default:                                          return 0;
+    }
+  }
+
+  // type code of fundamental type T (0 if type is not supported)
+  template <class T>
+  inline char TypeCode()
+  {
+    const char * name = typeid(T).name();
+    if ( ! std::is_arithmetic<T>::value || std::strlen(name) != 1 || ElementSize(name[0]) != sizeof(T) ) return 0;
+    return name[0];
+  }
+
+  // number of padding bytes needed to align offset
+  inline size_t Padding(size_t offset) { return (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT; }
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __COLUMNOUTPUT__
+#define __COLUMNOUTPUT__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "ColumnWriter.h"
+
+// forward declarations
+class ColumnBindingBase;
+
+
+// Output backend writing the variables declared in the output tree to a columnar file 
+// (see ColumnFormat.h), as an alternative or in addition to the ROOT ntuple.
+class ColumnOutput {
+
+public:
+
+  // constructor
+  ColumnOutput(const std::string & fileName, const std::string & treeName, const Log::LEVEL & logLevel);
+
+  // destructor
+  ~ColumnOutput();
+
+  // register declared variable (takes ownership), replacing any previous binding of the same variable
+  void AddBinding(ColumnBindingBase * binding);
+
+  // write current values of all variables as new entry (columns are fixed at the first entry)
+  GLOBAL::STATUS Fill();
+
+  // write footer and close file
+  GLOBAL::STATUS Close();
+
+  // get file name
+  const std::string & GetFileName() const { return m_fileName; }
+
+
+private:
+
+  // open file and declare columns
+  GLOBAL::STATUS Open();
+
+  std::string                                m_fileName;
+  std::string                                m_treeName;
+  std::vector<ColumnBindingBase *>           m_bindings;
+  std::map<std::string,unsigned int>         m_index;
+  bool                                       m_open;
+  bool                                       m_closed;
+  ColumnWriter                               m_writer;
+  Log                                        m_log;
+
+};
+
+#endif
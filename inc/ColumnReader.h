@@ -0,0 +1,345 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __COLUMNREADER__
+#define __COLUMNREADER__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <atomic>
+#include <stdint.h>
+
+// POSIX includes
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Analysis includes
+#include "ColumnFormat.h"
+
+
+// Reader for the chunked columnar format described in ColumnFormat.h.
+// The file is memory-mapped, and values are returned as pointers into the mapping (no copy).
+// This header has no dependencies on ROOT or the rest of the framework, so it can be used
+// by standalone programs.
+//
+// Usage:
+//
+//   ColumnReader reader;
+//   if ( ! reader.Open("ntuple.amcol") ) { std::cerr << reader.GetError() << std::endl; return 1; }
+//   int col = reader.FindColumn("my_vector_float");
+//   for (uint64_t entry = 0; entry < reader.GetEntries(); ++entry) {
+//     size_t n = 0;
+//     const float * values = static_cast<const float *>( reader.GetValues(col,entry,n) );
+//     ...
+//   }
+//
+// A reader may be shared between threads once it is open (GetValues() only reads the mapping).
+class ColumnReader {
+
+public:
+
+  // column description
+  struct Column {
+    std::string name;
+    char        type;
+    bool        isVector;
+  };
+
+  // chunk description
+  struct Chunk {
+    uint64_t firstEntry;
+    uint64_t nEntries;
+    std::vector<uint64_t> valuesOffset;  // per column
+    std::vector<uint64_t> offsetsOffset; // per column (0 for scalar columns)
+    std::vector<uint64_t> nValues;       // per column (size of values array)
+  };
+
+  // constructor
+  ColumnReader() : m_data(0), m_size(0), m_entries(0), m_lastChunk(0) {}
+
+  // destructor
+  ~ColumnReader() { Close(); }
+
+  // map file and read footer
+  bool Open(const std::string & fileName);
+
+  // unmap file
+  void Close();
+
+  // check if file is mapped
+  bool IsOpen() const { return m_data != 0; }
+
+  // get error message (if Open() failed)
+  const std::string & GetError() const { return m_error; }
+
+  // columns
+  unsigned int   GetNColumns() const                 { return m_columns.size(); }
+  const Column & GetColumn(unsigned int index) const { return m_columns[index];  }
+  int            FindColumn(const std::string & name) const;
+
+  // metadata
+  const std::map<std::string,std::string> & GetMetadata() const { return m_metadata; }
+  std::string GetMetadata(const std::string & key) const;
+
+  // chunks
+  unsigned int  GetNChunks() const                 { return m_chunks.size(); }
+  const Chunk & GetChunk(unsigned int index) const { return m_chunks[index];  }
+
+  // total number of entries
+  uint64_t GetEntries() const { return m_entries; }
+
+  // pointer to the values of column for entry, and number of values (1 for scalar columns). For
+  // offsets of a vector column beyond its values array (corrupt file), 0 is returned with n = 0
+  const void * GetValues(unsigned int column, uint64_t entry, size_t & n) const;
+
+  // typed version of GetValues()
+  template <class T>
+  const T * Get(unsigned int column, uint64_t entry, size_t & n) const { return static_cast<const T *>( GetValues(column,entry,n) ); }
+
+
+private:
+
+  // no copying (owns mapping)
+  ColumnReader(const ColumnReader &);
+  ColumnReader & operator=(const ColumnReader &);
+
+  // read helpers (advance position, return false if reading beyond end of footer)
+  template <class T>
+  bool ReadValue(size_t & pos, size_t end, T & value) const;
+  bool ReadString(size_t & pos, size_t end, std::string & value) const;
+
+  // find chunk holding entry
+  unsigned int FindChunk(uint64_t entry) const;
+
+  const char *                      m_data;
+  size_t                            m_size;
+  std::string                       m_error;
+  std::vector<Column>               m_columns;
+  std::map<std::string,std::string> m_metadata;
+  std::vector<Chunk>                m_chunks;
+  uint64_t                          m_entries;
+  mutable std::atomic<unsigned int> m_lastChunk;  // only a hint (checked before use), so threads may race on it
+
+};
+
+
+inline bool ColumnReader::Open(const std::string & fileName)
+{
+
+  Close();
+
+  // map file
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if ( fd < 0 ) {
+    m_error = "couldn't open file " + fileName;
+    return false;
+  }
+  struct stat info;
+  if ( fstat(fd,&info) != 0 || static_cast<size_t>(info.st_size) < COLUMNFORMAT::HEADERSIZE + COLUMNFORMAT::TRAILERSIZE ) {
+    ::close(fd);
+    m_error = "file " + fileName + " is too small";
+    return false;
+  }
+  m_size = info.st_size;
+  void * addr = mmap(0, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if ( addr == MAP_FAILED ) {
+    m_size = 0;
+    m_error = "couldn't map file " + fileName;
+    return false;
+  }
+  m_data = static_cast<const char *>(addr);
+
+  // check header and trailer
+  uint32_t version = 0;
+  std::memcpy(&version, m_data + 8, sizeof(version));
+  if ( std::memcmp(m_data, COLUMNFORMAT::MAGIC, 8) || version != COLUMNFORMAT::VERSION ||
+       std::memcmp(m_data + m_size - 8, COLUMNFORMAT::TRAILER, 8) ) {
+    Close();
+    m_error = "file " + fileName + " is not a columnar file (or is incomplete)";
+    return false;
+  }
+
+  // read footer
+  uint64_t footerOffset = 0;
+  std::memcpy(&footerOffset, m_data + m_size - COLUMNFORMAT::TRAILERSIZE, sizeof(footerOffset));
+  size_t pos = footerOffset;
+  const size_t end = m_size - COLUMNFORMAT::TRAILERSIZE;
+  bool ok = pos >= COLUMNFORMAT::HEADERSIZE && pos <= end;
+
+  uint32_t nColumns = 0;
+  ok = ok && ReadValue(pos,end,nColumns);
+  for (uint32_t i = 0; ok && i < nColumns; ++i) {
+    Column column;
+    uint8_t  isVector = 0;
+    uint16_t reserved = 0;
+    ok = ReadString(pos,end,column.name) && ReadValue(pos,end,column.type) && ReadValue(pos,end,isVector) && ReadValue(pos,end,reserved);
+    column.isVector = isVector;
+    ok = ok && COLUMNFORMAT::ElementSize(column.type) > 0;
+    m_columns.push_back(column);
+  }
+
+  uint32_t nMetadata = 0;
+  ok = ok && ReadValue(pos,end,nMetadata);
+  for (uint32_t i = 0; ok && i < nMetadata; ++i) {
+    std::string key, value;
+    ok = ReadString(pos,end,key) && ReadString(pos,end,value);
+    m_metadata[key] = value;
+  }
+
+  uint32_t nChunks = 0;
+  ok = ok && ReadValue(pos,end,nChunks);
+  for (uint32_t i = 0; ok && i < nChunks; ++i) {
+    Chunk chunk;
+    ok = ReadValue(pos,end,chunk.firstEntry) && ReadValue(pos,end,chunk.nEntries) && chunk.firstEntry == m_entries;
+    chunk.valuesOffset.resize(nColumns);
+    chunk.offsetsOffset.resize(nColumns);
+    chunk.nValues.resize(nColumns);
+    for (uint32_t col = 0; ok && col < nColumns; ++col) {
+      ok = ReadValue(pos,end,chunk.valuesOffset[col]) && ReadValue(pos,end,chunk.offsetsOffset[col]);
+      ok = ok && chunk.valuesOffset[col] <= footerOffset && chunk.offsetsOffset[col] <= footerOffset;
+      ok = ok && ( m_columns[col].isVector ? chunk.offsetsOffset[col] + (chunk.nEntries + 1)*sizeof(uint64_t) <= footerOffset 
+		                           : chunk.valuesOffset[col] + chunk.nEntries*COLUMNFORMAT::ElementSize(m_columns[col].type) <= footerOffset );
+
+      // values array of vector column ends at last offset
+      chunk.nValues[col] = chunk.nEntries;
+      if ( ok && m_columns[col].isVector ) {
+	std::memcpy(&chunk.nValues[col], m_data + chunk.offsetsOffset[col] + chunk.nEntries*sizeof(uint64_t), sizeof(uint64_t));
+	ok = chunk.nValues[col] <= ( footerOffset - chunk.valuesOffset[col] ) / COLUMNFORMAT::ElementSize(m_columns[col].type);
+      }
+    }
+    m_entries += chunk.nEntries;
+    m_chunks.push_back(chunk);
+  }
+
+  if ( ! ok ) {
+    Close();
+    m_error = "file " + fileName + " has a corrupt footer";
+    return false;
+  }
+
+  return true;
+
+}
+
+
+inline void ColumnReader::Close()
+{
+
+  if ( m_data ) munmap(const_cast<char *>(m_data), m_size);
+  m_data    = 0;
+  m_size    = 0;
+  m_entries = 0;
+  m_lastChunk = 0;
+  m_columns.clear();
+  m_metadata.clear();
+  m_chunks.clear();
+
+}
+
+
+inline int ColumnReader::FindColumn(const std::string & name) const
+{
+
+  for (unsigned int i = 0; i < m_columns.size(); ++i) {
+    if ( m_columns[i].name == name ) return i;
+  }
+
+  return -1;
+
+}
+
+
+inline std::string ColumnReader::GetMetadata(const std::string & key) const
+{
+
+  std::map<std::string,std::string>::const_iterator iter = m_metadata.find(key);
+
+  return iter == m_metadata.end() ? std::string() : iter->second;
+
+}
+
+
+inline const void * ColumnReader::GetValues(unsigned int column, uint64_t entry, size_t & n) const
+{
+
+  const Chunk & chunk = m_chunks[ FindChunk(entry) ];
+  const uint64_t local = entry - chunk.firstEntry;
+  const size_t   size  = COLUMNFORMAT::ElementSize(m_columns[column].type);
+
+  // scalar column - one value per entry
+  if ( ! m_columns[column].isVector ) {
+    n = 1;
+    return m_data + chunk.valuesOffset[column] + local*size;
+  }
+
+  // vector column - look up range of values in offsets
+  const uint64_t * offsets = reinterpret_cast<const uint64_t *>( m_data + chunk.offsetsOffset[column] );
+  if ( offsets[local] > offsets[local+1] || offsets[local+1] > chunk.nValues[column] ) {
+    n = 0;
+    return 0;
+  }
+  n = offsets[local+1] - offsets[local];
+  return m_data + chunk.valuesOffset[column] + offsets[local]*size;
+
+}
+
+
+inline unsigned int ColumnReader::FindChunk(uint64_t entry) const
+{
+
+  // entries are usually read in order - try last chunk (and the next) first
+  const unsigned int hint = m_lastChunk.load(std::memory_order_relaxed);
+  if ( hint < m_chunks.size() ) {
+    const Chunk & last = m_chunks[hint];
+    if ( entry >= last.firstEntry && entry < last.firstEntry + last.nEntries ) return hint;
+    if ( hint + 1 < m_chunks.size() && entry >= last.firstEntry + last.nEntries &&
+	 entry < m_chunks[hint+1].firstEntry + m_chunks[hint+1].nEntries ) {
+      m_lastChunk.store(hint + 1, std::memory_order_relaxed);
+      return hint + 1;
+    }
+  }
+
+  // binary search
+  unsigned int lo = 0, hi = m_chunks.size();
+  while ( hi - lo > 1 ) {
+    unsigned int mid = (lo + hi) / 2;
+    if ( m_chunks[mid].firstEntry <= entry ) lo = mid;
+    else hi = mid;
+  }
+  m_lastChunk.store(lo, std::memory_order_relaxed);
+
+  return lo;
+
+}
+
+
+template <class T>
+inline bool ColumnReader::ReadValue(size_t & pos, size_t end, T & value) const
+{
+
+  if ( pos + sizeof(T) > end ) return false;
+  std::memcpy(&value, m_data + pos, sizeof(T));
+  pos += sizeof(T);
+
+  return true;
+
+}
+
+
+inline bool ColumnReader::ReadString(size_t & pos, size_t end, std::string & value) const
+{
+
+  uint32_t length = 0;
+  if ( ! ReadValue(pos,end,length) || pos + length > end ) return false;
+  value.assign(m_data + pos, length);
+  pos += length;
+
+  return true;
+
+}
+
+#endif
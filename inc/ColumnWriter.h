@@ -0,0 +1,98 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __COLUMNWRITER__
+#define __COLUMNWRITER__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <stdint.h>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+
+
+// Writer for the chunked columnar format described in ColumnFormat.h.
+// Values of the current entry are passed with Write(), and Fill() ends the entry. 
+// Entries are buffered in memory and written one chunk at a time.
+class ColumnWriter {
+
+public:
+
+  // constructor
+  ColumnWriter(const Log::LEVEL & logLevel, unsigned long chunkSize = 65536);
+
+  // destructor (closes file without writing footer, i.e. leaves an invalid file)
+  ~ColumnWriter();
+
+  // open output file
+  GLOBAL::STATUS Open(const std::string & fileName);
+
+  // declare column (before first call to Fill()), returns column index or -1 for unsupported type
+  int AddColumn(const std::string & name, char type, bool isVector);
+
+  // add metadata (written in footer)
+  void SetMetadata(const std::string & key, const std::string & value) { m_metadata[key] = value; }
+
+  // set values of column for current entry (n must be 1 for scalar columns)
+  void Write(unsigned int column, const void * data, size_t n);
+
+  // end current entry
+  GLOBAL::STATUS Fill();
+
+  // write remaining entries and footer, and close file
+  GLOBAL::STATUS Close();
+
+  // check if file is open
+  bool IsOpen() const { return m_file != 0; }
+
+  // number of entries filled
+  uint64_t GetEntries() const { return m_entries; }
+
+
+private:
+
+  // no copying (owns file)
+  ColumnWriter(const ColumnWriter &);
+  ColumnWriter & operator=(const ColumnWriter &);
+
+  // buffered column data for current chunk
+  struct ColumnBuffer {
+    std::string           name;
+    char                  type;
+    bool                  isVector;
+    size_t                size;
+    std::vector<char>     values;
+    std::vector<uint64_t> offsets;
+  };
+
+  // location of chunk in file
+  struct ChunkInfo {
+    uint64_t              firstEntry;
+    uint64_t              nEntries;
+    std::vector<uint64_t> valuesOffset;
+    std::vector<uint64_t> offsetsOffset;
+  };
+
+  // write buffered chunk
+  GLOBAL::STATUS FlushChunk();
+
+  // write raw bytes (optionally padded to alignment first), and return offset where they start
+  bool WriteBytes(const void * data, size_t size, bool align, uint64_t & offset);
+
+  std::FILE *                       m_file;
+  std::string                       m_fileName;
+  uint64_t                          m_position;
+  uint64_t                          m_entries;
+  uint64_t                          m_chunkEntries;
+  unsigned long                     m_chunkSize;
+  std::vector<ColumnBuffer>         m_columns;
+  std::vector<ChunkInfo>            m_chunks;
+  std::map<std::string,std::string> m_metadata;
+  Log                               m_log;
+
+};
+
+#endif
@@ -0,0 +1,64 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __CONVERGENCE__
+#define __CONVERGENCE__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <functional>
+
+// Analysis includes
+#include "Log.h"
+
+// forward declarations
+class TH1;
+class MultiHist;
+
+
+// Criteria to stop the event loop early, once histograms are precise enough: the relative
+// statistical error of the integral (bin < 0) or of a bin content of a histogram must be below a
+// target. Selectors add criteria in Initialise():
+//
+//   my_hist = new TH1D( "my_hist" , "my_hist" , 100 , 0. , 100. );
+//   AddConvergence( "my_hist" , my_hist , 0.01 );
+//
+// and histograms declared in the card file by (see HistogramBook.h):
+//
+//   double MySelector::h_new_float::convergence    = 0.01
+//   int    MySelector::h_new_float::convergenceBin = 12
+//
+// The criteria are only used with stopWhenConverged (see AnalysisManager.cpp), which reads the
+// clusters of the input in random order and checks the criteria every convergenceInterval events.
+class Convergence {
+
+public:
+
+  // constructor
+  Convergence(const Log::LEVEL & logLevel);
+
+  // add criterion for histogram
+  void Add(const std::string & name, const TH1 * hist, double target, int bin = -1);
+  void Add(const std::string & name, const MultiHist * hist, double target, int bin = -1, unsigned int variation = 0);
+
+  // check if there are criteria
+  bool IsEmpty() const { return m_criteria.empty(); }
+
+  // check if all criteria are met (histograms must be filled)
+  bool IsMet() const;
+
+
+private:
+
+  // criterion - function giving value and squared error
+  struct Criterion {
+    std::string                             name;
+    double                                  target;
+    std::function<void(double &, double &)> evaluate;
+  };
+
+  std::vector<Criterion> m_criteria;
+  mutable Log            m_log;
+
+};
+
+#endif
@@ -0,0 +1,20 @@
+// Autogenerated from cards/eventSchema - typed event model of the input tree (see Service::GetEvent())
+#ifndef __EVENT__
+#define __EVENT__
+#include <vector>
+struct Event {
+  int                            my_int;
+  float                          my_float;
+  std::vector<int>               my_vector_int;
+  std::vector<float>             my_vector_float;
+  std::vector<std::vector<float> > my_vector_vector_float;
+  template <class B> void Bind(B & binder) {
+    binder.ConnectMember("my_int",my_int);
+    binder.ConnectMember("my_float",my_float);
+    binder.ConnectMember("my_vector_int",my_vector_int);
+    binder.ConnectMember("my_vector_float",my_vector_float);
+    binder.ConnectMember("my_vector_vector_float",my_vector_vector_float);
+  }
+};
+// EOL
+#endif
@@ -0,0 +1,228 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __EVENTPIPELINE__
+#define __EVENTPIPELINE__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "SpscQueue.h"
+#include "PassBitmap.h"
+
+// forward declarations
+class TFile;
+class TMemFile;
+class TTree;
+class ColumnOutput;
+class SlotBindingBase;
+
+
+// Pipeline of the event loop, with each stage running on its own thread:
+//
+//   read    : reader thread with its own copy of the input tree - reads baskets (prefetched by
+//             the tree cache), decompresses them and copies the entries into batches of slots
+//   execute : calling thread - moves each entry of a batch into the selectors' variables (Next()),
+//             runs the selectors, and copies the output of passing entries into slots (Fill())
+//   write   : writer thread - moves the output slots into its own copy of the output variables,
+//             and fills (serialises and compresses) the output trees and columnar output
+//
+// Stages are connected by bounded lock-free queues of batches. A stage waits when the next stage
+// hasn't returned a free batch (back-pressure), or when the previous stage hasn't delivered a full
+// batch. The time each stage is busy and waiting, and the occupancy of the queues, show which
+// stage limits the throughput (see Report()).
+//
+// With several writers (SetWriters()), blocks of consecutive output batches are handed to the
+// writers in turn. Each writer fills its own copy of the output trees, in a file in memory, so
+// baskets are serialised and compressed in parallel. At the end of a block the writer hands the
+// file to a sink thread, which copies the compressed baskets into the output trees without
+// unzipping them (TTree::CopyEntries() with option "fast"). The sink takes the blocks in order
+// (entries keep the order of the input), or as soon as they are finished. Columnar output needs
+// a single writer.
+//
+// The pipeline runs per input file. If a connected variable can't be copied (array leaves),
+// the file is read serially by the service.
+class EventPipeline {
+
+public:
+
+  // constructor (depth = batches in flight between two stages)
+  EventPipeline(unsigned int depth, unsigned int batchSize, const Log::LEVEL & logLevel);
+
+  // destructor (stops threads)
+  ~EventPipeline();
+
+  // size of the reader's tree cache (bytes, 0 for the ROOT default)
+  void SetCacheSize(long bytes) { m_cacheSize = bytes; }
+
+  // number of writers, entries in the block of each writer, and whether the sink keeps the order
+  // of the blocks (set before any output variable is registered)
+  void SetWriters(unsigned int nWriters, unsigned int blockSize, bool keepOrder);
+
+  // register variable connected in input tree (takes ownership, forgotten when stopped)
+  void AddInput(SlotBindingBase * binding);
+
+  // register variable declared in output of chain (takes ownership, replaces variable with same name)
+  void AddOutput(unsigned int chain, SlotBindingBase * binding);
+
+  // start threads for input file (once all variables are connected). Output trees and columnar
+  // outputs are given per chain (0 if disabled). With an entry list, only its entries are read
+  GLOBAL::STATUS Start(TTree * inTree, const std::string & fileName,
+		       const std::vector<TTree *> & outTrees, const std::vector<ColumnOutput *> & columnOutputs,
+		       const PassBitmap * entryList = 0);
+
+  // get state
+  bool IsPrepared() const { return m_prepared; }
+  bool IsRunning()  const { return m_running;  }
+
+  // move to entry (entries must be requested in order, skipping those not in the entry list), and
+  // copy it to the selectors' variables
+  GLOBAL::STATUS Next(long entry);
+
+  // queue output of chain for current entry
+  void Fill(unsigned int chain);
+
+  // write queued output, stop threads and forget input variables
+  GLOBAL::STATUS Stop();
+
+  // print time spent in each stage and queue occupancy (summed over input files)
+  void Report() const;
+
+
+private:
+
+  // no copying (owns threads)
+  EventPipeline(const EventPipeline &);
+  EventPipeline & operator=(const EventPipeline &);
+
+  // batch of input entries
+  struct InputBatch {
+    long         first;
+    unsigned int n;
+  };
+
+  // batch of output entries, with flags of chains passed by each entry
+  struct OutputBatch {
+    unsigned int      n;
+    std::vector<char> passed;
+  };
+
+  // output variables of chain
+  struct Output {
+    std::vector<SlotBindingBase *>     bindings;
+    std::map<std::string,unsigned int> index;
+    std::vector<void *>                addresses;   // addresses of output tree branches before start
+    TTree *                            tree;
+    ColumnOutput *                     columns;
+  };
+
+  // time spent by stage
+  struct Stage {
+    double        busy;
+    double        waitInput;
+    double        waitOutput;
+    unsigned long batches;
+    double        occupancy;   // sum of input queue size seen when taking a batch
+  };
+
+  // writer thread, with its output batches [index * depth, (index + 1) * depth), and with several
+  // writers its copies of the output trees and the serialised blocks handed to the sink
+  struct Writer {
+    Writer(unsigned int depth) : free(depth), full(depth), blocks(depth), file(0), nEntries(0), finished(false), stage() {}
+    std::thread                      thread;
+    SpscQueue<unsigned int>          free;
+    SpscQueue<unsigned int>          full;
+    SpscQueue<std::vector<char> *>   blocks;     // 0 for a block without entries
+    TMemFile *                       file;
+    std::vector<TTree *>             trees;      // per chain (0 without output tree)
+    long                             nEntries;   // entries filled in current block
+    std::atomic<bool>                finished;
+    Stage                            stage;
+  };
+
+  // thread loops
+  void Read();
+  void Write(unsigned int index);
+  void Sink();
+
+  // hand block of writer to sink (parallel writing)
+  void FinishBlock(Writer & writer);
+
+  // copy baskets of block into output trees (parallel writing)
+  bool MergeBlock(const std::vector<char> & block);
+
+  // pop value from queue, waiting until it is available - returns false if queue is empty once
+  // flag is set. The time spent waiting is added to seconds
+  template <class T>
+  bool Wait(SpscQueue<T> & queue, T & value, const std::atomic<bool> & flag, double & seconds) const;
+
+  // hand current output batch to writer
+  void FlushOutput();
+
+  // first entry to read at or after given entry
+  long NextEntry(long entry) const { return m_entryList ? m_entryList->FindNext(entry) : entry; }
+
+  // re-point output of chains to the writer's variables (or back to the selectors' variables)
+  void SwitchOutput(bool toWriter);
+
+  unsigned int                   m_depth;
+  unsigned int                   m_batchSize;
+  long                           m_cacheSize;
+  bool                           m_prepared;
+  bool                           m_running;
+
+  // variables
+  std::vector<SlotBindingBase *> m_inputs;
+  std::vector<Output>            m_outputs;
+
+  // reader stage
+  TFile *                        m_file;
+  TTree *                        m_tree;
+  long                           m_entries;
+  const PassBitmap *             m_entryList;
+  std::thread                    m_reader;
+  std::atomic<bool>              m_readerDone;
+  std::atomic<bool>              m_readerError;
+  std::atomic<bool>              m_abort;
+
+  // writer stage (writers, of which m_nWriters are used for current input file, and batches in a
+  // block of a writer)
+  std::vector<Writer *>          m_writers;
+  unsigned int                   m_nWriters;
+  unsigned int                   m_blockSize;
+  unsigned int                   m_blockBatches;
+  bool                           m_keepOrder;
+  bool                           m_parallel;
+  std::thread                    m_sink;
+  std::atomic<bool>              m_finishing;
+  std::atomic<bool>              m_writerError;
+
+  // batches and queues
+  std::vector<InputBatch>        m_inBatches;
+  std::vector<OutputBatch>       m_outBatches;
+  SpscQueue<unsigned int>        m_inFree;
+  SpscQueue<unsigned int>        m_inFull;
+
+  // position of execute stage (and writer and number of batches of current block)
+  long                           m_nextEntry;
+  int                            m_inBatch;
+  unsigned int                   m_inPos;
+  int                            m_outBatch;
+  unsigned int                   m_outWriter;
+  unsigned int                   m_outBlockBatches;
+  bool                           m_hasEntry;
+
+  // statistics (read, execute, write, sink)
+  Stage                          m_stages[4];
+  double                         m_startTime;
+
+  mutable Log                    m_log;
+
+};
+
+#endif
@@ -0,0 +1,228 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __EXPRESSION__
+#define __EXPRESSION__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+
+
+// Variable read by expressions (a scalar, or a vector of values), loaded into a register
+// at the start of each evaluation
+class ExpressionInput {
+
+public:
+
+  // destructor
+  virtual ~ExpressionInput() {}
+
+  // shape of variable
+  virtual bool IsVector() const = 0;
+
+  // value of scalar variable
+  virtual double Get() const = 0;
+
+  // values of vector variable
+  virtual void Load(std::vector<double> & values) const = 0;
+
+};
+
+
+// scalar variable at address set by the owner (e.g. connected with GetVariable())
+template <class T>
+class ScalarInput : public ExpressionInput {
+
+public:
+
+  ScalarInput() : m_addr(0) {}
+
+  bool IsVector() const { return false; }
+
+  double Get() const { return m_addr ? static_cast<double>(*m_addr) : 0.; }
+
+  void Load(std::vector<double> & values) const { values.assign(1,Get()); }
+
+  const T *& Address() { return m_addr; }
+
+private:
+
+  const T * m_addr;
+
+};
+
+
+// vector variable (any container with size() and operator[], e.g. std::vector<T> or Span<const T>)
+template <class C>
+class VectorInput : public ExpressionInput {
+
+public:
+
+  VectorInput() : m_addr(0) {}
+
+  bool IsVector() const { return true; }
+
+  double Get() const { return 0.; }
+
+  void Load(std::vector<double> & values) const
+  {
+    const std::size_t n = m_addr ? m_addr->size() : 0;
+    values.resize(n);
+    double * out = values.data();
+    for (std::size_t i = 0; i < n; ++i) out[i] = static_cast<double>((*m_addr)[i]);
+  }
+
+  const C *& Address() { return m_addr; }
+
+private:
+
+  const C * m_addr;
+
+};
+
+
+// Arithmetic expression over scalar and vector variables, e.g.
+//
+//   my_float > 40 && count(my_vector_float < 40) >= 1
+//
+// The text is parsed once (Parse()), and compiled once the variables are known (Compile()) into
+// a program for a register machine. Every instruction reads its operands from registers and writes
+// its result to a register. Registers holding vectors keep their memory between evaluations, and
+// operations on vectors are plain loops over contiguous values (vectorised by the compiler). Scalar
+// operands of vector operations are broadcast, and sub-expressions of constants are folded.
+//
+// Syntax (C-like precedence, booleans are 1 and 0):
+//
+//   numbers, true, false, variables          3.5  1e3  my_float  my_vector_float
+//   arithmetic                               +  -  *  /  (unary -)
+//   comparison                               <  <=  >  >=  ==  !=
+//   logic (both sides are evaluated)         &&  ||  !
+//   element of vector (NaN if out of range)  my_vector_float[0]
+//   element-wise functions                   abs(x)  sqrt(x)  exp(x)  log(x)
+//   reductions of vectors                    size(v)  count(v)  sum(v)  min(v)  max(v)  any(v)  all(v)
+//
+// count() is the number of non-zero elements, min() and max() of an empty vector are NaN (all
+// comparisons with NaN are false). Vectors combined element-wise must have the same size.
+class Expression {
+
+public:
+
+  // constructor (name is used in messages)
+  Expression(const std::string & name, const std::string & text, const Log::LEVEL & logLevel);
+
+  // parse text, and collect names of variables
+  GLOBAL::STATUS Parse();
+
+  // names of variables used by expression (available after parsing)
+  const std::vector<std::string> & GetVariables() const { return m_variables; }
+
+  // compile program (inputs must hold all variables, and must outlive the expression)
+  GLOBAL::STATUS Compile(const std::map<std::string,const ExpressionInput *> & inputs);
+
+  // get state
+  bool IsCompiled() const { return m_compiled; }
+  bool IsVector  () const { return m_result.isVector; }
+
+  // evaluate expression for current values of inputs
+  GLOBAL::STATUS Evaluate();
+
+  // result of last evaluation
+  double                      GetScalar() const { return m_result.isConst ? m_result.value : m_scalars[m_result.reg]; }
+  const std::vector<double> & GetVector() const { return m_vectors[m_result.reg]; }
+
+  // print program
+  void Print() const;
+
+
+private:
+
+  // operations
+  enum OP {
+    LOAD, NEG, NOT, ABS, SQRT, EXP, LOGN,
+    ADD, SUB, MUL, DIV, LT, LE, GT, GE, EQ, NE, AND, OR,
+    SIZE, COUNT, SUM, MIN, MAX, ANY, ALL, INDEX
+  };
+
+  // syntax tree
+  enum KIND { NUMBER, VARIABLE, UNARY, BINARY, CALL, ELEMENT };
+  struct Node {
+    KIND             kind;
+    OP               op;
+    double           value;
+    std::string      name;
+    std::vector<int> args;
+  };
+
+  // compiled sub-expression - a constant, or a scalar or vector register
+  struct Operand {
+    bool   isConst;
+    bool   isVector;
+    int    reg;
+    double value;
+  };
+
+  // instruction (a and b are registers of the operands, shape tells which of them are vectors)
+  enum SHAPE { SS = 0, VS = 1, SV = 2, VV = 3 };
+  struct Instruction {
+    OP    op;
+    SHAPE shape;
+    int   dst;
+    int   a;
+    int   b;
+  };
+
+  // parser (recursive descent, returns index of node or -1)
+  bool Tokenize();
+  int  ParseOr();
+  int  ParseAnd();
+  int  ParseComparison();
+  int  ParseSum();
+  int  ParseProduct();
+  int  ParseUnary();
+  int  ParsePostfix();
+  int  ParsePrimary();
+  bool Accept(const std::string & token);
+  int  AddNode(KIND kind, OP op, int a = -1, int b = -1);
+  int  Error(const std::string & message);
+
+  // compiler
+  bool    Emit(int node, Operand & result);
+  bool    CheckVector(const Node & node, const Operand & operand, bool isVector);
+  Operand Register(bool isVector);
+  int     ScalarRegister(const Operand & operand);
+
+  // operation on constants
+  static double Fold(OP op, double a, double b);
+
+  // execution of instructions
+  template <class F> void Unary (const Instruction & ins);
+  template <class F> bool Binary(const Instruction & ins);
+  template <class F> void Reduce(const Instruction & ins, double init);
+
+  std::string                          m_text;
+  bool                                 m_compiled;
+
+  // parser state
+  std::vector<std::string>             m_tokens;
+  unsigned int                         m_pos;
+  std::vector<Node>                    m_nodes;
+  int                                  m_root;
+  std::vector<std::string>             m_variables;
+
+  // program and registers
+  std::vector<const ExpressionInput *> m_inputs;
+  std::vector<Operand>                 m_loads;
+  std::vector<Instruction>             m_program;
+  std::vector<double>                  m_scalars;
+  std::vector< std::vector<double> >   m_vectors;
+  Operand                              m_result;
+
+  mutable Log                          m_log;
+
+};
+
+#endif
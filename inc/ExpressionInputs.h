@@ -0,0 +1,58 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __EXPRESSIONINPUTS__
+#define __EXPRESSIONINPUTS__
+
+// Standard Template Library includes
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+
+// Analysis includes
+#include "Enums.h"
+#include "Expression.h"
+
+// forward declarations
+class SelectorBase;
+
+
+// Variables used by expressions, connected through a selector (GetVariable()). Variables are
+// branches of the input tree (vectors are connected to read-only views), new variables declared
+// by selectors (of type float, double, int or vector<float>), or derived variables set by the owner.
+// The first connection fixes the type of a variable, later input files only re-point it.
+class ExpressionInputs {
+
+public:
+
+  // constructor
+  ExpressionInputs() {}
+
+  // destructor
+  ~ExpressionInputs();
+
+  // connect variables of expression (not set with SetDerived()), and compile it the first time
+  GLOBAL::STATUS Connect(SelectorBase & selector, Expression & expression);
+
+  // set derived variable computed by the owner
+  void SetDerived(const std::string & name, const float * addr);
+  void SetDerived(const std::string & name, const std::vector<float> * addr);
+
+
+private:
+
+  // no copying (owns inputs)
+  ExpressionInputs(const ExpressionInputs &);
+  ExpressionInputs & operator=(const ExpressionInputs &);
+
+  // connect variable through selector, as view on branch in input tree or as new variable
+  template <class T>
+  bool ConnectScalar(SelectorBase & selector, const std::string & name, ExpressionInput *& input);
+  template <class C>
+  bool ConnectVector(SelectorBase & selector, const std::string & name, ExpressionInput *& input);
+
+  std::map<std::string,ExpressionInput*> m_inputs;
+  std::set<std::string>                  m_derived;
+
+};
+
+#endif
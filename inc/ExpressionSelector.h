@@ -0,0 +1,76 @@
+#ifndef EXPRESSIONSELECTOR
+#define EXPRESSIONSELECTOR
+
+// Standard Template Library includes
+#include <vector>
+#include <string>
+#include <map>
+
+// Analysis includes
+#include "SelectorBase.h"
+#include "Enums.h"
+#include "Log.h"
+#include "Service.h"
+#include "Expression.h"
+#include "ExpressionInputs.h"
+
+// forward declarations
+class Store;
+
+
+// Selector configured in the card file, without writing code. Derived variables are computed and
+// declared in the output tree (as float, or vector<float> for element-wise expressions), and the
+// event is skipped if the cut is false. Expressions may use branches of the input tree, new variables
+// of earlier selectors, and derived variables defined before them (see Expression.h for the syntax):
+//
+//   vector<string> selectors                       = ExpressionSelector
+//   vector<string> ExpressionSelector::defines     = sum_vector_float
+//   string         ExpressionSelector::sum_vector_float = sum(my_vector_float)
+//   string         ExpressionSelector::cut         = my_float > 40 && count(my_vector_float < 40) >= 1
+//
+// Several instances are configured by giving them their own names and the type:
+//
+//   vector<string> selectors          = HighPt
+//   string         HighPt::type       = ExpressionSelector
+//   string         HighPt::cut        = max(my_vector_float) > 80
+class ExpressionSelector : public SelectorBase {
+
+public:
+
+  // constructor
+  ExpressionSelector (const std::string & name, const Store & config, Service & service);
+
+  // destructor
+  ~ExpressionSelector();
+
+  // analysis functions
+  GLOBAL::STATUS Initialise();
+  GLOBAL::STATUS BeginInputFile();
+  GLOBAL::STATUS ExecuteEvent();
+  GLOBAL::STATUS Finalise();
+
+
+private:
+
+  // derived variable
+  struct Define {
+    std::string          name;
+    Expression *         expression;
+    float *              scalar;
+    std::vector<float> * vector;
+  };
+
+  // expressions
+  std::vector<Define>                    m_defines;
+  Expression *                           m_cut;
+
+  // variables used by expressions (branches of input tree, and derived variables)
+  ExpressionInputs                       m_inputs;
+
+  // statistics
+  unsigned long                          m_nEvents;
+  unsigned long                          m_nPassed;
+
+};
+
+#endif
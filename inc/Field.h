@@ -30,6 +30,7 @@ public:
   
   // method to retrieve value of field
   const T & get() const { return m_value ; }
+  T & get() { return m_value ; }
   
   // clone
   FieldBase * clone() const { return new Field<T>( m_value ) ; }
@@ -0,0 +1,95 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __HISTOGRAMBOOK__
+#define __HISTOGRAMBOOK__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "Expression.h"
+#include "ExpressionInputs.h"
+#include "MultiHist.h"
+
+// forward declarations
+class SelectorBase;
+class Store;
+
+
+// Histograms of a selector declared in the card file, filled for events passing the selector:
+//
+//   vector<string> MySelector::histograms                 = h_new_float h_my_vector_float
+//   string         MySelector::h_new_float::variable      = new_float
+//   vector<double> MySelector::h_new_float::binning       = 100 0 100
+//   string         MySelector::h_new_float::weight        = my_int
+//   string         MySelector::h_my_vector_float::variable = my_vector_float
+//   vector<double> MySelector::h_my_vector_float::edges   = 0 10 20 50 100
+//
+// variable and weight are expressions (see Expression.h). A vector variable fills one entry per
+// element, with a scalar weight or a vector weight of the same size. The binning is given as
+// "nBins low high", or as bin edges. An optional title may be given too, and a target relative
+// error of the integral (or of bin convergenceBin) to stop early (see Convergence.h):
+//
+//   double         MySelector::h_new_float::convergence   = 0.01
+//
+// The values of each event are only staged. Flush() fills the staged values of a batch of events
+// in bulk: bin indices are computed for the whole batch first, then the weights are added to
+// contiguous arrays of bin contents (see MultiHist.h). ROOT histograms are created by Write(), in
+// the current directory (the selector's directory).
+class HistogramBook {
+
+public:
+
+  // constructor
+  HistogramBook(SelectorBase & selector, const Store & config);
+
+  // destructor
+  ~HistogramBook();
+
+  // read declarations from card file
+  GLOBAL::STATUS Book();
+
+  // connect variables of expressions (after selector's BeginInputFile())
+  GLOBAL::STATUS BeginInputFile();
+
+  // stage values of current event (passed the selector)
+  GLOBAL::STATUS Stage();
+
+  // fill staged values
+  void Flush();
+
+  // fill staged values, and write histograms to current directory
+  void Write();
+
+  // number of declared histograms
+  unsigned int GetSize() const { return m_histograms.size(); }
+
+
+private:
+
+  // no copying (owns expressions and histograms)
+  HistogramBook(const HistogramBook &);
+  HistogramBook & operator=(const HistogramBook &);
+
+  // declared histogram
+  struct Histogram {
+    std::string               name;
+    Expression *              variable;
+    Expression *              weight;
+    MultiHist *               hist;
+    std::vector<double>       values;   // staged values
+    std::vector<double>       weights;  // staged weights
+    std::vector<unsigned int> bins;     // bin indices of staged values
+  };
+
+
+  SelectorBase &            m_selector;
+  const Store &             m_config;
+  std::vector<Histogram>    m_histograms;
+  ExpressionInputs          m_inputs;
+
+};
+
+#endif
@@ -0,0 +1,23 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __IDENTITY__
+#define __IDENTITY__
+
+// Standard Template Library includes
+#include <string>
+
+
+// Descriptions of files and of the executable, used to name and validate cache files.
+namespace IDENTITY {
+
+  // describe file by name, size, modification time and inode (empty if it doesn't exist)
+  std::string File(const std::string & fileName);
+
+  // describe executable by size and modification time (changes when it is rebuilt)
+  std::string Build();
+
+  // 64 bit hash of text (FNV-1a), as 16 hex digits
+  std::string Hash(const std::string & text);
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __INCREMENTALCACHE__
+#define __INCREMENTALCACHE__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+
+// forward declarations
+class Store;
+
+
+// Cache of the partial outputs (histograms and ntuples) of each input file, so a dataset that grows
+// is processed incrementally: only new or changed input files are processed, and the partial outputs
+// of all input files are merged into the final outputs (see OutputMerger.h).
+//
+// The partial outputs of an input file are identified by a hash of the input file identity (name,
+// size, modification time, inode), the card file settings (except the names of input and output
+// files), and the identity of the executable. They are only used once they were completed (marked
+// by a "<name>.done" file), so an interrupted run processes the input file again.
+//
+// Each input file is processed on its own, so Finalise() of the selectors runs once per input file
+// and the histograms it writes are summed when merging - histograms normalised or fitted in Finalise()
+// are wrong in the merged output, and must be normalised after the merge instead.
+class IncrementalCache {
+
+public:
+
+  // constructor
+  IncrementalCache(const std::string & directory, const Store & config, const Log::LEVEL & logLevel);
+
+  // check if partial outputs of input file are in cache
+  bool IsCached(const std::string & fileName) const;
+
+  // configuration to process input file into its partial outputs (caller takes ownership)
+  Store * CreateConfig(const std::string & fileName) const;
+
+  // mark partial outputs of input file as complete
+  GLOBAL::STATUS Commit(const std::string & fileName) const;
+
+  // get names of partial outputs of input file
+  std::string GetHistogramFileName(const std::string & fileName) const { return GetBaseName(fileName) + ".hist.root"; }
+  std::string GetNtupleFileName(const std::string & fileName, const std::string & chain) const
+  {
+    return GetBaseName(fileName) + ( chain.empty() ? ".ntuple.root" : ".ntuple_" + chain + ".root" );
+  }
+
+
+private:
+
+  // describe input file and configuration
+  std::string Identity(const std::string & fileName) const;
+
+  // path of partial outputs of input file, without extension
+  std::string GetBaseName(const std::string & fileName) const;
+
+  std::string              m_directory;
+  const Store &            m_config;
+  std::string              m_configIdentity;
+  std::vector<std::string> m_chains;
+  mutable Log              m_log;
+
+};
+
+#endif
@@ -0,0 +1,107 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __JAGGEDARRAY__
+#define __JAGGEDARRAY__
+
+// Standard Template Library includes
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+// Analysis includes
+#include "Span.h"
+
+
+// Flat storage for a collection of variable-length collections (e.g. a vector<vector<float> > branch).
+// All elements are kept in one contiguous values array, and inner collection i spans the 
+// range [offsets[i],offsets[i+1]) of it. Memory is re-used between events, so once the 
+// largest event has been seen, filling the array does not allocate.
+//
+// This only changes the layout selectors read: ROOT still unpacks the branch into its nested
+// vector, and the array is copied from it once per entry (see JaggedView in View.h). It pays
+// off when the elements are looped over more than once, or handed to code expecting flat arrays.
+//
+// Usage in a selector (bound through SelectorBase::GetVariable like any other variable):
+//
+//   const JaggedArray<float> * my_vector_vector_float;
+//   GetVariable( "my_vector_vector_float" , my_vector_vector_float );
+//   for (unsigned int i=0; i<my_vector_vector_float->size(); ++i) {
+//     Span<const float> inner = (*my_vector_vector_float)[i];
+//     ...
+//   }
+template <class T>
+class JaggedArray {
+
+public:
+
+  // constructor
+  JaggedArray() : m_offsets(1,0) {}
+
+  // number of inner collections
+  std::size_t size()  const { return m_offsets.size() - 1; }
+  bool        empty() const { return size() == 0; }
+
+  // view of inner collection i
+  Span<const T> operator[](std::size_t i) const { return Span<const T>(m_values.data() + m_offsets[i], m_offsets[i+1] - m_offsets[i]); }
+  Span<T>       operator[](std::size_t i)       { return Span<T>      (m_values.data() + m_offsets[i], m_offsets[i+1] - m_offsets[i]); }
+  Span<const T> at(std::size_t i) const 
+  { 
+    if ( i >= size() ) throw std::out_of_range("JaggedArray::at()");
+    return (*this)[i]; 
+  }
+
+  // view of all elements (flattened)
+  Span<const T> values() const { return Span<const T>(m_values.data(), m_values.size()); }
+  Span<T>       values()       { return Span<T>      (m_values.data(), m_values.size()); }
+
+  // offsets of inner collections into values (size()+1 entries)
+  const std::vector<std::size_t> & offsets() const { return m_offsets; }
+
+  // remove all inner collections (keeps allocated memory)
+  void clear() { m_offsets.resize(1); m_values.clear(); }
+
+  // append inner collection 
+  template <class Iter>
+  void push_back(Iter first, Iter last) 
+  { 
+    m_values.insert(m_values.end(), first, last); 
+    m_offsets.push_back(m_values.size()); 
+  }
+  void push_back(const Span<const T> & inner) { push_back(inner.begin(), inner.end()); }
+
+  // fill from nested vector (keeps allocated memory)
+  void assign(const std::vector<std::vector<T> > & nested);
+
+
+private:
+
+  // vector<bool> is not contiguous
+  static_assert(sizeof(T) > 0 && ! std::is_same<T,bool>::value, "JaggedArray<bool> is not supported");
+
+  std::vector<std::size_t> m_offsets;
+  std::vector<T>           m_values;
+
+};
+
+
+template <class T>
+void JaggedArray<T>::assign(const std::vector<std::vector<T> > & nested)
+{
+
+  // compute offsets
+  m_offsets.resize(nested.size() + 1);
+  m_offsets[0] = 0;
+  for (std::size_t i = 0; i < nested.size(); ++i) {
+    m_offsets[i+1] = m_offsets[i] + nested[i].size();
+  }
+
+  // copy values
+  m_values.resize(m_offsets.back());
+  for (std::size_t i = 0; i < nested.size(); ++i) {
+    std::copy(nested[i].begin(), nested[i].end(), m_values.begin() + m_offsets[i]);
+  }
+
+}
+
+#endif
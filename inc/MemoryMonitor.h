@@ -0,0 +1,82 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __MEMORYMONITOR__
+#define __MEMORYMONITOR__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// Analysis includes
+#include "Log.h"
+
+
+// Accounting of the resident memory (RSS) of the job. The RSS is sampled before and after the hooks
+// of each component (selectors, reading the input, filling the output and histograms), and the
+// growth in between is attributed to the component. The event loop is sampled every few events
+// only, while hooks outside the event loop (Initialise(), BeginInputFile(), Finalise()) are always
+// sampled. Report() prints the memory attributed to each component, largest first.
+//
+// The RSS is shared by all threads, so memory allocated by other threads while a hook runs (e.g. the
+// pipeline's reader) is attributed to it too. The growth while selectors run in parallel is shared
+// equally between them.
+class MemoryMonitor {
+
+public:
+
+  // constructor (budget in MB, 0 for none). A disabled monitor never samples
+  MemoryMonitor(long budgetMB, bool enabled, const Log::LEVEL & logLevel);
+
+  // get resident memory of process (bytes)
+  static long GetRSS();
+
+  // add component, returns its index
+  unsigned int AddComponent(const std::string & name);
+
+  // switch sampling on or off (e.g. for all but every n-th event)
+  void SetSampling(bool sampling) { m_sampling = m_enabled && sampling; }
+  bool IsSampling() const         { return m_sampling;     }
+
+  // measure memory before and after hook of component
+  void Begin() { if ( m_sampling ) m_before = GetRSS(); }
+  void End(unsigned int component) { if ( m_sampling ) Attribute(component, GetRSS()); }
+
+  // measure memory after hooks of components running in parallel (growth is shared equally)
+  void End(const std::vector<unsigned int> & components)
+  {
+    if ( ! m_sampling || components.empty() ) return;
+    const long rss = GetRSS();
+    for (unsigned int i = 0; i < components.size(); ++i) Attribute(components[i], rss, components.size());
+  }
+
+  // memory budget (bytes, 0 for none)
+  long GetBudget() const { return m_budget; }
+
+  // print memory attributed to components, and peak RSS
+  void Report() const;
+
+
+private:
+
+  // memory of component
+  struct Component {
+    std::string   name;
+    long          growth;    // sum of RSS increases during hooks
+    long          peak;      // highest RSS after hooks
+    unsigned long samples;
+  };
+
+  // add RSS change since Begin() (its share of it) to component, and check budget
+  void Attribute(unsigned int component, long rss, unsigned int shares = 1);
+
+  long                   m_budget;
+  bool                   m_enabled;
+  bool                   m_sampling;
+  long                   m_before;
+  long                   m_peak;
+  bool                   m_exceeded;
+  std::vector<Component> m_components;
+  mutable Log            m_log;
+
+};
+
+#endif
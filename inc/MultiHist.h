@@ -0,0 +1,86 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __MULTIHIST__
+#define __MULTIHIST__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+// One-dimensional histogram filled with several weights at once (e.g. systematic variations of
+// the event weight). Bin contents are stored as one contiguous block [bin][variation], so a fill
+// finds the bin once and updates all variations with one loop over adjacent values. The ROOT
+// histograms (TH1D, one per variation) are only created by Write().
+//
+// Usage in a selector:
+//
+//   // Initialise()
+//   std::vector<std::string> variations = { "nominal" , "up" , "down" };
+//   my_multiHist = new MultiHist("my_multiHist", "my_multiHist", 100, 0., 100., variations);
+//
+//   // ExecuteEvent()
+//   const double weights[] = { w , w*1.1 , w*0.9 };
+//   my_multiHist->Fill( (*new_float) , weights );
+//
+//   // Finalise() (histograms are written to the selector's directory)
+//   my_multiHist->Write();
+class MultiHist {
+
+public:
+
+  // constructors (uniform binning, or bin edges). Without variations, there is one weight
+  MultiHist(const std::string & name, const std::string & title, unsigned int nBins, double low, double high,
+	    const std::vector<std::string> & variations = std::vector<std::string>());
+  MultiHist(const std::string & name, const std::string & title, const std::vector<double> & edges,
+	    const std::vector<std::string> & variations = std::vector<std::string>());
+
+  // get binning and variations
+  unsigned int GetNBins()       const { return m_nBins;             }
+  unsigned int GetNVariations() const { return m_variations.size(); }
+  const std::vector<std::string> & GetVariations() const { return m_variations; }
+
+  // find bin of value (0 is the underflow, nBins+1 the overflow)
+  unsigned int FindBin(double x) const;
+
+  // find bins of n values
+  void FindBins(const double * x, unsigned int * bins, std::size_t n) const;
+
+  // add one weight per variation
+  void Fill(double x, const double * weights) { FillBin(FindBin(x), x, weights); }
+  void Fill(double x, const std::vector<double> & weights) { FillBin(FindBin(x), x, weights.data()); }
+
+  // add one weight per variation to bin found before
+  void FillBin(unsigned int bin, double x, const double * weights);
+
+  // get content, and sum of squared weights, of bin
+  double GetBinContent(unsigned int bin, unsigned int variation = 0) const { return m_sumw[bin * m_variations.size() + variation]; }
+  double GetBinSumw2  (unsigned int bin, unsigned int variation = 0) const { return m_sumw2[bin * m_variations.size() + variation]; }
+
+  // create histogram of each variation in current directory (<name>_<variation>, or <name> for an
+  // unnamed variation), which takes ownership
+  void Write() const;
+
+
+private:
+
+  std::string              m_name;
+  std::string              m_title;
+  unsigned int             m_nBins;
+  double                   m_low;
+  double                   m_high;
+  double                   m_scale;      // bins per unit (uniform binning)
+  std::vector<double>      m_edges;      // bin edges (empty for uniform binning)
+  std::vector<std::string> m_variations;
+
+  // contents [bin][variation], with underflow and overflow
+  std::vector<double>      m_sumw;
+  std::vector<double>      m_sumw2;
+
+  // sums of w, w^2, w*x and w*x^2 in range [statistic][variation], and number of fills
+  std::vector<double>      m_stats;
+  double                   m_entries;
+
+};
+
+#endif
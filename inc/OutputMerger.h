@@ -0,0 +1,75 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __OUTPUTMERGER__
+#define __OUTPUTMERGER__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+
+// forward declarations
+class TFile;
+class TDirectory;
+class TTree;
+
+
+// Merges output files (histograms.root, ntuple.root, ...) of several jobs or input files into one file.
+//
+//  - every directory is merged by its own task, and tasks run in parallel. A task reads its directory
+//    from one input file at a time and sums the histograms (other objects are taken from the first
+//    input), so only the merged directories of running tasks are held in memory
+//  - trees are merged by copying the compressed baskets ("fast" cloning), without decompressing and
+//    recompressing them, one input file at a time. Each tree is merged into a temporary file next to
+//    the output, so trees are merged in parallel, and then copied into the output
+//  - all inputs must have the same structure as the first input: the same directories and objects,
+//    and trees with the same branches and types. Otherwise nothing is merged.
+class OutputMerger {
+
+public:
+
+  // constructor
+  OutputMerger(unsigned int nThreads, const Log::LEVEL & logLevel);
+
+  // merge inputs into output (output is removed if merging failed)
+  GLOBAL::STATUS Merge(const std::string & outputName, const std::vector<std::string> & inputs);
+
+
+private:
+
+  // key names and classes in directory
+  typedef std::map<std::string,std::string> Content;
+
+  // get names and classes of keys in directory (the highest cycle of each key is used)
+  static Content GetContent(TDirectory * dir);
+
+  // get directory in file (top directory for empty path)
+  static TDirectory * GetDirectory(TDirectory * file, const std::string & path);
+
+  // describe branches of tree (names and types)
+  static std::string GetSchema(TTree * tree);
+
+  // collect paths of directories and trees in first input
+  static void Scan(TDirectory * dir, const std::string & path, std::vector<std::string> & directories, std::vector<std::string> & trees);
+
+  // merge objects (except directories and trees) in directory of all inputs, and write them to output
+  bool MergeDirectory(const std::string & path, const std::vector<std::string> & inputs);
+
+  // merge tree of all inputs by copying compressed baskets (into temporary file, then into output)
+  bool MergeTree(const std::string & path, const std::vector<std::string> & inputs, const std::string & tempName);
+
+  unsigned int m_nThreads;
+
+  // output file, shared by tasks
+  TFile *      m_output;
+  std::mutex   m_mutex;
+
+  Log          m_log;
+
+};
+
+#endif
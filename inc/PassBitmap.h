@@ -0,0 +1,76 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __PASSBITMAP__
+#define __PASSBITMAP__
+
+// Standard Template Library includes
+#include <vector>
+#include <cstdint>
+
+
+// One bit per entry of an input tree, e.g. set for the entries that passed a selector. Used as
+// an entry list: FindNext() gives the next entry to read.
+class PassBitmap {
+
+public:
+
+  // constructor (all bits cleared)
+  PassBitmap(long nEntries = 0) : m_size(nEntries), m_words((nEntries + 63) / 64, 0) {}
+
+  // clear all bits, for given number of entries
+  void Reset(long nEntries)
+  {
+    m_size = nEntries;
+    m_words.assign((nEntries + 63) / 64, 0);
+  }
+
+  // set and test bit of entry
+  void Set(long entry)        { m_words[entry >> 6] |= uint64_t(1) << (entry & 63);          }
+  bool Test(long entry) const { return ( m_words[entry >> 6] >> (entry & 63) ) & 1;          }
+
+  // add bits of other bitmap (same number of entries)
+  void Merge(const PassBitmap & other)
+  {
+    for (std::size_t i = 0; i < m_words.size(); ++i) m_words[i] |= other.m_words[i];
+  }
+
+  // keep only bits also set in other bitmap (same number of entries)
+  void Intersect(const PassBitmap & other)
+  {
+    for (std::size_t i = 0; i < m_words.size(); ++i) m_words[i] &= other.m_words[i];
+  }
+
+  // number of entries, and of set bits
+  long GetSize() const { return m_size; }
+  long Count() const
+  {
+    long n = 0;
+    for (std::size_t i = 0; i < m_words.size(); ++i) n += __builtin_popcountll(m_words[i]);
+    return n;
+  }
+
+  // first entry at or after given entry with its bit set (number of entries if there is none)
+  long FindNext(long entry) const
+  {
+    if ( entry >= m_size ) return m_size;
+    std::size_t i = entry >> 6;
+    uint64_t word = m_words[i] & ( ~uint64_t(0) << (entry & 63) );
+    while ( ! word ) {
+      if ( ++i == m_words.size() ) return m_size;
+      word = m_words[i];
+    }
+    return ( static_cast<long>(i) << 6 ) + __builtin_ctzll(word);
+  }
+
+  // words of bitmap (for reading and writing files)
+  std::vector<uint64_t> &       GetWords()       { return m_words; }
+  const std::vector<uint64_t> & GetWords() const { return m_words; }
+
+
+private:
+
+  long                  m_size;
+  std::vector<uint64_t> m_words;
+
+};
+
+#endif
@@ -0,0 +1,112 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __PASSCACHE__
+#define __PASSCACHE__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "PassBitmap.h"
+
+// forward declarations
+class SelectorBase;
+class Store;
+class TDirectory;
+
+
+// Bitmaps of the entries passing each selector, stored per input file so later runs can skip
+// selectors that didn't change. The bitmap of selector i has the entries that passed selectors
+// 0..i of its chain. It is identified by a hash of the input file identity (name, size,
+// modification time, inode), the names and card file settings (keys starting with "<name>::")
+// of selectors 0..i, and the identity of the executable (unless ignoreBuild is set, e.g. when
+// only the code of later selectors changes between runs).
+//
+// When an input file is opened, each chain looks for the bitmaps of its leading selectors. The
+// selectors found are not run, and only the entries that passed them are read (the entry list
+// is the union over all chains). Selectors that declare output variables are always run, as
+// later selectors may use them. Note that skipped selectors don't fill their own histograms or
+// put objects in the store - histograms declared in the card file are still filled. A warning
+// names each selector skipped, and its histogram directory gets histogram "passCacheSkipped"
+// (bin 1: input files where it was skipped, bin 2: input files, so merged outputs keep the count).
+//
+// A bitmap file is written for every selector that ran, once all entries of the input file were
+// processed (nEventsMax not reached).
+class PassCache {
+
+public:
+
+  // constructor
+  PassCache(const std::string & directory, bool ignoreBuild, const Log::LEVEL & logLevel);
+
+  // add chain of selectors (after they were initialised)
+  void AddChain(const std::vector<SelectorBase *> & selectors, const Store & config);
+
+  // load bitmaps of input file (after selectors connected their variables)
+  GLOBAL::STATUS NewInputFile(const std::string & fileName, const std::string & treeName, long nEntries);
+
+  // number of leading selectors of chain that are skipped for current input file
+  unsigned int GetNSkipped(unsigned int chain) const { return m_chains[chain].nSkipped; }
+
+  // entries to read from current input file (0 if all entries are read)
+  const PassBitmap * GetEntryList() const { return m_useEntryList ? &m_entryList : 0; }
+
+  // check if chain must run for entry (the entry passed its skipped selectors)
+  bool IsSelected(unsigned int chain, long entry) const
+  {
+    const Chain & c = m_chains[chain];
+    return c.nSkipped == 0 || c.passed.Test(entry);
+  }
+
+  // record number of selectors of chain passed by entry
+  void Record(unsigned int chain, long entry, unsigned int nPassed)
+  {
+    Chain & c = m_chains[chain];
+    for (unsigned int i = c.nSkipped; i < nPassed; ++i) c.bitmaps[i].Set(entry);
+  }
+
+  // write bitmaps of current input file (if all entries were processed)
+  GLOBAL::STATUS EndInputFile(bool complete);
+
+  // write histogram with input files where selector of chain was skipped, and input files, to its
+  // directory (nothing if it was never skipped)
+  void Annotate(unsigned int chain, unsigned int selector, TDirectory * dir) const;
+
+
+private:
+
+  // selectors of chain, and their bitmaps for current input file
+  struct Chain {
+    std::vector<SelectorBase *> selectors;
+    std::vector<std::string>    keys;       // identity of selectors 0..i
+    std::vector<PassBitmap>     bitmaps;    // bitmaps being recorded
+    PassBitmap                  passed;     // entries passing the skipped selectors
+    unsigned int                nSkipped;
+    std::vector<unsigned int>   nFilesSkipped;
+  };
+
+  // cache file name of identity
+  std::string FileName(const std::string & identity) const;
+
+  // read and write bitmap
+  bool Load(const std::string & identity, PassBitmap & bitmap) const;
+  GLOBAL::STATUS Save(const std::string & identity, const PassBitmap & bitmap) const;
+
+  std::string              m_directory;
+  std::string              m_build;
+  std::vector<Chain>       m_chains;
+
+  // current input file
+  std::string              m_fileName;
+  std::string              m_fileIdentity;
+  unsigned int             m_nFiles;
+  PassBitmap               m_entryList;
+  bool                     m_useEntryList;
+
+  mutable Log              m_log;
+
+};
+
+#endif
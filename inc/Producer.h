@@ -0,0 +1,103 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __PRODUCER__
+#define __PRODUCER__
+
+// Standard Template Library includes
+#include <string>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+
+// Base class for derived quantities computed at most once per event
+class ProducerBase {
+
+public:
+
+  // constructor
+  ProducerBase(const std::string & name) : m_name(name), m_event(-1), m_hits(0), m_misses(0), m_seconds(0.) {}
+
+  // destructor
+  virtual ~ProducerBase() {}
+
+  // get name
+  const std::string & GetName() const { return m_name; }
+
+  // statistics
+  unsigned long GetHits()    const { return m_hits;    }
+  unsigned long GetMisses()  const { return m_misses;  }
+  double        GetSeconds() const { return m_seconds; }
+
+  // check if calling thread is computing this quantity - requesting it again from its own function
+  // (directly, or through other quantities) would deadlock
+  bool IsComputing() const { return std::find(Computing().begin(), Computing().end(), this) != Computing().end(); }
+
+  // names of quantities calling thread is computing (outermost first, e.g. "a -> b")
+  static std::string GetComputingNames()
+  {
+    std::string names;
+    for (unsigned int i = 0; i < Computing().size(); ++i) names += ( i ? " -> " : "" ) + Computing()[i]->GetName();
+    return names;
+  }
+
+
+protected:
+
+  // quantities calling thread is computing (a function requesting another quantity adds it on top)
+  static std::vector<const ProducerBase *> & Computing() { static thread_local std::vector<const ProducerBase *> computing; return computing; }
+
+  std::string   m_name;
+  long          m_event;
+  unsigned long m_hits;
+  unsigned long m_misses;
+  double        m_seconds;
+
+};
+
+
+// Derived quantity of type T. The function fills the value in place, so memory held 
+// by the value (e.g. a vector) is re-used between events.
+template <class T>
+class Producer : public ProducerBase {
+
+public:
+
+  // constructor
+  Producer(const std::string & name, const std::function<void(T &)> & function) : ProducerBase(name), m_function(function), m_value() {}
+
+  // destructor
+  virtual ~Producer() {}
+
+  // get value for event (computed on first request)
+  const T & Get(long event)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ( event == m_event ) {
+      ++m_hits;
+      return m_value;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Computing().push_back(this);
+    m_function(m_value);
+    Computing().pop_back();
+    m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_event = event;
+    ++m_misses;
+    return m_value;
+  }
+
+  // get value without computing it (only for the thread computing it, see IsComputing())
+  const T & GetValue() const { return m_value; }
+
+
+private:
+
+  std::function<void(T &)> m_function;
+  T                        m_value;
+  std::mutex               m_mutex;  // selectors may run in parallel
+
+};
+
+#endif
@@ -0,0 +1,74 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __PRODUCERREGISTRY__
+#define __PRODUCERREGISTRY__
+
+// Standard Template Library includes
+#include <string>
+#include <map>
+#include <functional>
+#include <atomic>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+#include "Producer.h"
+
+
+// Registry of derived quantities shared between selectors. A quantity is registered once 
+// (typically in a selector's Initialise()) with a function computing it. The first request 
+// in an event computes the value, and later requests in the same event get the cached value.
+//
+// Usage in a selector:
+//
+//   // Initialise()
+//   RegisterProducer<float>( "sum_my_vector_float" , [this](float & sum) { 
+//     sum = 0; 
+//     for (unsigned int i=0; i<my_vector_float->size(); ++i) sum += (*my_vector_float)[i]; 
+//   } );
+//
+//   // ExecuteEvent() (of this or any other selector)
+//   const float & sum = Produce<float>( "sum_my_vector_float" );
+class ProducerRegistry {
+
+public:
+
+  // constructor
+  ProducerRegistry(const Log::LEVEL & logLevel);
+
+  // destructor
+  ~ProducerRegistry();
+
+  // register producer
+  template <class T>
+  GLOBAL::STATUS Register(const std::string & name, const std::function<void(T &)> & function);
+
+  // get value of derived quantity for current event (throws if not registered or wrong type). A
+  // quantity requested by its own function (directly or through other quantities) is reported as
+  // error, and GetStatus() then returns GLOBAL::ERROR
+  template <class T>
+  const T & Get(const std::string & name);
+  GLOBAL::STATUS GetStatus() const { return m_failed ? GLOBAL::ERROR : GLOBAL::SUCCESS; }
+
+  // start new event (invalidates cached values)
+  void NewEvent() { ++m_event; }
+
+  // print hit/miss counts and cost of all producers
+  void Report();
+
+
+private:
+
+  // no copying (owns producers)
+  ProducerRegistry(const ProducerRegistry &);
+  ProducerRegistry & operator=(const ProducerRegistry &);
+
+  std::map<std::string,ProducerBase *> m_producers;
+  long                                 m_event;
+  std::atomic<bool>                    m_failed;  // cyclic request (selectors may run in parallel)
+  Log                                  m_log;
+
+};
+
+#include "ProducerRegistry.icc"
+
+#endif
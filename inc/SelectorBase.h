@@ -5,12 +5,16 @@
 // Standard Template Library
 #include <string>
 #include <map>
+#include <set>
+#include <functional>
 
 // Analysis includes
 #include "Enums.h"
 #include "Service.h"
 #include "Log.h"
 #include "Store.h"
+#include "JaggedArray.h"
+#include "Span.h"
 
 // forward declarations
 class TFile;
@@ -24,6 +28,9 @@ public:
   // constructor
   SelectorBase(const std::string & name, const Store & config, Service & service);
 
+  // destructor
+  virtual ~SelectorBase() {}
+
   // analysis functions
   virtual GLOBAL::STATUS Initialise()     = 0;
   virtual GLOBAL::STATUS BeginInputFile() = 0;
@@ -36,6 +43,12 @@ public:
 
   // get object store
   Store & store() { return m_service.GetStore() ; }
+
+  // register/get derived quantity shared between selectors (computed once per event)
+  template< typename T>
+  GLOBAL::STATUS RegisterProducer(const std::string & name, const std::function<void(T &)> & function) { return m_service.GetProducers().Register<T>(name,function); }
+  template< typename T>
+  const T & Produce(const std::string & name) { return m_service.GetProducers().Get<T>(name); }
   
   // connect/declare variable in input/output trees
   template< typename T>
@@ -43,6 +56,54 @@ public:
   template< typename T>
   void GetVariable(const char * _keyword, const T *& _addr, const int & isNewVar=-1);
 
+  // connect vector<vector<T> > branch in input tree to flat jagged array
+  template< typename T>
+  void GetVariable(const char * _keyword, JaggedArray<T> *& _addr, const int & isNewVar=-1);
+
+  // connect vector<T> branch or array leaf in input tree to read-only view (no copy)
+  template< typename T>
+  void GetVariable(const char * _keyword, Span<const T> *& _addr, const int & isNewVar=-1);
+
+  // values of a scalar branch read in bulk (useBulkRead), from the current entry to the end of its
+  // basket, e.g. to process a batch of entries at once. Returns 0 if the branch isn't read in bulk:
+  //
+  //   long n = 0;
+  //   const float * values = GetBulkValues<float>( "my_float" , n );
+  template< typename T>
+  const T * GetBulkValues(const char * _keyword, long & n) const { return m_service.GetBulkValues<T>(_keyword,n); }
+
+  // get typed event model generated from the schema of the input tree (cards/eventSchema -> Event.h),
+  // e.g. in Initialise(). Its members are bound to each input tree once for all selectors (no
+  // per-file re-binding of pointers), and declared as inputs. Overwriting a variable from the input
+  // tree still needs GetVariable():
+  //
+  //   const Event * event = 0;
+  //   GetEvent( event );
+  //   if ( event->my_float < my_float_min ) return GLOBAL::SKIP;
+  template< typename E>
+  void GetEvent(const E *& _event);
+
+  // declare inputs/outputs (variables or Store keys) used to schedule selectors in parallel.
+  // variables connected with GetVariable() are declared automatically: branches in the input tree 
+  // as inputs, new variables as inputs and outputs. Overwriting a variable from the input tree, or 
+  // passing objects through the Store, must be declared explicitly (with several chains, an input
+  // variable overwritten without being declared is reported as an error after the chain).
+  void DeclareInput (const std::string & name) { m_inputs.insert(name);  }
+  void DeclareOutput(const std::string & name) { m_outputs.insert(name); }
+  const std::set<std::string> & GetInputs () const { return m_inputs;  }
+  const std::set<std::string> & GetOutputs() const { return m_outputs; }
+
+  // declare that ExecuteEvent() never returns SKIP, so later selectors don't need to wait for it.
+  // Every selector is treated as a cut by default - with nSelectorThreads > 1, a selector only runs
+  // in parallel with later selectors if it calls DeclareNoCut() (e.g. in its constructor or
+  // Initialise()), and otherwise the sequence runs one selector after the other
+  void DeclareNoCut() { m_isCut = false; }
+  bool IsCut() const  { return m_isCut;  }
+
+  // add criterion to stop the event loop early: relative error of histogram integral (or bin) below target
+  template< typename H>
+  void AddConvergence(const std::string & name, const H * hist, double target, int bin = -1) { m_service.GetConvergence().Add(m_name + "/" + name,hist,target,bin); }
+
   // get service
   const Service & GetService() const { return m_service; }
 
@@ -58,8 +119,8 @@ public:
 
 private:
 
-  // selector name
-  const std::string & m_name;
+  // selector name (copied - the same selector may appear in several chains)
+  const std::string m_name;
 
   // service
   Service & m_service;
@@ -67,6 +128,18 @@ private:
   // logger
   mutable Log m_log;
 
+  // declared inputs/outputs, and whether ExecuteEvent() may return SKIP
+  std::set<std::string> m_inputs;
+  std::set<std::string> m_outputs;
+  bool                  m_isCut;
+
+  // declares members of event as inputs (binder for E::Bind())
+  struct InputDeclaration {
+    SelectorBase & selector;
+    template< typename T>
+    void ConnectMember(const char * _keyword, T &) { selector.DeclareInput(_keyword); }
+  };
+
   // book-keeping of memory allocations
   std::map<unsigned long,std::pair<void *,const char *> > m_ptrs; // address of pointer , pair(pointer, type)
 
@@ -0,0 +1,89 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __SELECTORSEQUENCE__
+#define __SELECTORSEQUENCE__
+
+// Standard Template Library includes
+#include <vector>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+
+// forward declarations
+class SelectorBase;
+class ThreadPool;
+class MemoryMonitor;
+
+
+// Runs a sequence of selectors for each event. With more than one thread, selectors are grouped 
+// in levels using their declared inputs and outputs: a selector depends on an earlier selector if 
+// one reads what the other writes, if both write the same, or if the earlier one is a cut (may 
+// return SKIP). Selectors in the same level run in parallel, and the levels are joined in order, 
+// so an event that fails a cut is never seen by any selector after it.
+//
+// Every selector is a cut unless it calls DeclareNoCut() (see SelectorBase.h), so selectors only
+// run in parallel once the selectors before them have opted in.
+class SelectorSequence {
+
+public:
+
+  // constructor
+  SelectorSequence(const std::vector<SelectorBase *> & selectors, unsigned int nThreads, const Log::LEVEL & logLevel);
+
+  // destructor
+  ~SelectorSequence();
+
+  // group selectors in levels (called after selectors have connected their variables)
+  GLOBAL::STATUS Schedule();
+
+  // run selectors for current event, returns first status that is not SUCCESS (in sequence order)
+  GLOBAL::STATUS ExecuteEvent();
+
+  // attribute memory used by ExecuteEvent() of each selector to its component (one per selector,
+  // see MemoryMonitor.h). The memory used by a level of selectors running in parallel is shared
+  // equally between them
+  void SetMemoryMonitor(MemoryMonitor * monitor, const std::vector<unsigned int> & components);
+
+  // attribute heap allocations in ExecuteEvent() of each selector to its context (one per selector,
+  // see AllocationProfiler.h)
+  void SetAllocationContexts(const std::vector<unsigned int> & contexts) { m_allocationContexts = contexts; }
+
+  // record ExecuteEvent() of each selector in timeline under its name (one per selector, see Tracer.h)
+  void SetTraceNames(const std::vector<unsigned int> & names) { m_traceNames = names; }
+
+  // don't run the first n selectors - events are known to pass them (see PassCache.h)
+  void SetSkipped(unsigned int n) { m_nSkipped = n < m_selectors.size() ? n : m_selectors.size(); }
+
+  // number of selectors (in sequence order) passed by current event - the event passed selector i
+  // if it passed all selectors up to and including i
+  unsigned int GetNPassed() const { return m_nPassed; }
+
+  // get selectors
+  const std::vector<SelectorBase *> & GetSelectors() const { return m_selectors; }
+
+
+private:
+
+  // no copying (owns thread pool)
+  SelectorSequence(const SelectorSequence &);
+  SelectorSequence & operator=(const SelectorSequence &);
+
+  // check if selector j must wait for earlier selector i
+  bool DependsOn(unsigned int j, unsigned int i) const;
+
+  std::vector<SelectorBase *>              m_selectors;
+  std::vector<std::vector<unsigned int> >  m_levels;
+  std::vector<GLOBAL::STATUS>              m_status;
+  unsigned int                             m_nPassed;
+  unsigned int                             m_nSkipped;
+  ThreadPool *                             m_pool;
+  MemoryMonitor *                          m_memory;
+  std::vector<unsigned int>                m_memoryComponents;
+  std::vector<unsigned int>                m_levelComponents;     // of selectors running in parallel
+  std::vector<unsigned int>                m_allocationContexts;
+  std::vector<unsigned int>                m_traceNames;
+  Log                                      m_log;
+
+};
+
+#endif
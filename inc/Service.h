@@ -5,15 +5,28 @@
 // Standard Template Library includes
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
+#include <functional>
 
 // Analysis includes
 #include "Enums.h"
 #include "Log.h"
 #include "Store.h"
+#include "ProducerRegistry.h"
+#include "PassBitmap.h"
+#include "Convergence.h"
 
 // forward declarations
 class TTree;
 class TFile;
+class ViewBase;
+class ColumnCache;
+class ColumnOutput;
+class FieldBase;
+class SnapshotBase;
+class EventPipeline;
+class BulkReader;
 
 
 class Service {
@@ -30,20 +43,63 @@ public:
   GLOBAL::STATUS PrepareOutTree();
   GLOBAL::STATUS PrepareInput(const std::vector<std::string>& inFileNames);
   GLOBAL::STATUS NextInTree();
-
+  GLOBAL::STATUS GetEntry(long entry);
+  GLOBAL::STATUS FinishInTree();
+  GLOBAL::STATUS EnableColumnCache(const std::string & directory);
+  GLOBAL::STATUS EnablePipeline(unsigned int depth, unsigned int batchSize, unsigned int nWriters = 1, unsigned int blockSize = 10000, bool keepOrder = true);
+  GLOBAL::STATUS EnableColumnOutput(const std::string & fileName);
+  GLOBAL::STATUS EnableImplicitMT(unsigned int poolSize);
+  GLOBAL::STATUS EnableBulkRead();
+  GLOBAL::STATUS FillOutput();
+  GLOBAL::STATUS CloseOutput();
+
+  // size of the input tree cache, and of the output baskets after which output trees are flushed
+  // (bytes, 0 for the ROOT defaults). Set before input trees are loaded and output trees prepared
+  void SetInputCacheSize(long bytes);
+  void SetOutputFlushSize(long bytes) { m_outputFlushSize = bytes; }
+
+  // read only the entries of current input tree in list (set before the first GetEntry(), reset
+  // by NextInTree()). NextEntry() gives the first entry to read at or after given entry
+  void SetEntryList(const PassBitmap * entryList) { m_entryList = entryList; }
+  long NextEntry(long entry) const { return m_entryList ? m_entryList->FindNext(entry) : entry; }
+
+  // criteria to stop the event loop early
+  Convergence & GetConvergence() { return m_convergence; }
+
+  // selection chains - each chain has its own output and derived quantities, and all functions
+  // handling output act on the active chain. By default there is a single chain without name.
+  GLOBAL::STATUS SetChains(const std::vector<std::string> & names);
+  GLOBAL::STATUS SetActiveChain(unsigned int index);
+  unsigned int         GetNChains()    const { return m_chains.size();                    }
+  const std::string &  GetChainName()  const { return m_chains[m_activeChain].name;       }
+
+  // input variables overwritten by a chain are saved after GetEntry() and restored before the next chain.
+  // Input variables not declared as outputs must not be modified - CheckInputs() compares them with
+  // their copy after a chain, and reports those the chain modified anyway
+  void ProtectInputs(const std::set<std::string> & names);
+  void SaveInputs();
+  GLOBAL::STATUS CheckInputs();
+  void RestoreInputs();
 
   // get object store
   Store & GetStore() { return m_objects; }
 
   // clear object store
   void ClearStore() { m_objects.flush(); }
+
+  // get registry of derived quantities
+  ProducerRegistry & GetProducers() { return *m_chains[m_activeChain].producers; }
   
   // inline functions
-  void       SetTreeName(std::string& treeName) { m_treeName = treeName;    }
-  TTree *    GetInTree  ()                      { return m_inTree;          }
-  TTree *    GetOutTree ()                      { return m_outTree;         }
-  long       GetNEvents () const                { return m_nEvents;         }
-  Log::LEVEL GetLogLevel() const                { return m_log.GetLevel() ; }
+  void       SetTreeName(std::string& treeName) { m_treeName = treeName;                           }
+  void       SetTreeOutput(bool enable)         { m_chains[m_activeChain].treeOutput = enable;     }
+  void       DisableOutput()                    { m_chains[m_activeChain].hasOutput = false;       }
+  bool       HasOutput  () const                { return m_chains[m_activeChain].hasOutput;        }
+  TTree *    GetInTree  () const                { return m_inTree;                                 }
+  TTree *    GetOutTree () const                { return m_chains[m_activeChain].outTree;          }
+  long       GetNEvents () const                { return m_nEvents;                                }
+  const EventPipeline * GetPipeline() const     { return m_pipeline;                               }
+  Log::LEVEL GetLogLevel() const                { return m_log.GetLevel() ;                        }
   
   // connect/declare variables in input and output trees
   template< typename T>
@@ -55,24 +111,125 @@ public:
   template< typename T>
   void DeclareVariable(const char* _keyword, T& _addr);
 
+  // re-bind declared variable that moved to new memory (e.g. input variable for new input file)
+  template< typename T>
+  void RebindVariable(const char* _keyword, T& _addr);
+
+  // get buffer for new variable when output is disabled (created on first request, shared by all selectors)
+  template< typename T>
+  T * GetBuffer(const char* _keyword);
+
+  // check if buffer for new variable exists with given type
+  template< typename T>
+  bool HasBuffer(const char* _keyword) const;
+
+  // keep track of input variable, so it can be protected against changes by other chains
+  template< typename T>
+  void TrackInputVariable(const char* _keyword, T* _addr);
+
+  // keep track of input variable used through a pointer (at given address) rather than a view mapped 
+  // onto the column cache - only such variables are copied from the cache
+  void TrackDirectInput(const char* _keyword, const void * _ptr);
+
+  // values of scalar branch read in bulk (see BulkReader.h), from current entry to the end of its
+  // basket (n values) - 0 if the branch isn't read in bulk, or has a different type
+  template< typename T>
+  const T * GetBulkValues(const char* _keyword, long & n) const;
+
+  // get view derived from branch in input tree (created on first request, refreshed in GetEntry())
+  template< typename V>
+  V * GetView(const char* _keyword);
+
+  // get typed event model generated from the schema of the input tree (see Event.h), shared by all
+  // selectors. Created on first request, and bound to each input tree by NextInTree() - before
+  // selectors connect their variables, so GetVariable() re-binds to the members of the event
+  template< typename E>
+  E * GetEvent();
+
+  // connect member of event to input tree, and declare it in output trees (called by E::Bind())
+  template< typename T>
+  void ConnectMember(const char* _keyword, T& _member);
   
 private:
 
   // Object store (for passing objects between selectors)
   Store m_objects;
 
+  // state of a selection chain
+  struct ChainState {
+    std::string                       name;
+    ProducerRegistry *                producers;    // derived quantities shared between selectors (computed once per event)
+    TTree *                           outTree;
+    bool                              hasOutput;
+    bool                              treeOutput;
+    ColumnOutput *                    columnOutput;
+    std::map<std::string,FieldBase *> buffers;      // new variables when output is disabled
+  };
+  std::vector<ChainState> m_chains;
+  unsigned int            m_activeChain;
+
+  // add chain with default settings / delete all chains
+  void AddChain(const std::string & name);
+  void ClearChains();
+
   // TTrees
   std::string m_treeName;
   TTree * m_inTree;
-  TTree * m_outTree;
+
+  // entries to read from input tree (0 if all are read)
+  const PassBitmap * m_entryList;
+
+  // criteria to stop the event loop early
+  Convergence m_convergence;
+
+  // memory limits of input tree cache and output baskets (0 for ROOT defaults)
+  long m_inputCacheSize;
+  long m_outputFlushSize;
 
   // input files
   unsigned int m_counter;
   std::vector<TFile *> m_inFiles;
+
+  // views derived from branches in input tree, and input variables used directly (see TrackDirectInput())
+  std::map<std::string,ViewBase *> m_views;
+  std::set<std::string>            m_directInputs;
   
   // total number of events
   long m_nEvents;
 
+  // cache of connected variables (0 if disabled)
+  ColumnCache * m_cache;
+
+  // bulk reading of scalar branches (0 if disabled)
+  BulkReader * m_bulk;
+
+  // pipeline of read, execute and write stages (0 if disabled)
+  EventPipeline * m_pipeline;
+
+  // start pipeline for current input file
+  GLOBAL::STATUS StartPipeline();
+
+  // copies of input variables (per input file), and those overwritten by a chain
+  std::map<std::string,SnapshotBase *> m_snapshots;
+  std::vector<SnapshotBase *>          m_protected;
+
+  // typed event model (0 if not requested), routine binding its members, and pointers to its
+  // non-simple members (vectors are connected through the address of a pointer)
+  FieldBase *                       m_event;
+  std::function<void()>             m_bindEvent;
+  std::map<std::string,FieldBase *> m_eventPointers;
+  GLOBAL::STATUS                    m_eventStatus;
+
+  // bind members of event to current input tree
+  GLOBAL::STATUS BindEvent();
+
+  // choose mode of column cache for current input file
+  GLOBAL::STATUS PrepareColumnCache();
+
+  // pointer to non-simple member of event
+  template< typename T>
+  T *& EventPointer(const char* _keyword, T& _member);
+
   // logger
   Log m_log;
 
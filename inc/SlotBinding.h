@@ -0,0 +1,143 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __SLOTBINDING__
+#define __SLOTBINDING__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+// Analysis includes
+#include "ColumnBinding.h"
+
+
+// Connects a variable to the event slots of the pipeline (see EventPipeline.h).
+// The front is the variable seen by the selectors, the back is a private copy bound to the
+// tree of another thread (input tree of the reader, or output tree of the writer), and the
+// slots hold the values of the events in flight between the two. With several writers, each
+// writer has its own back:
+//
+//   input  : back --BackToSlot()--> slot --SlotToFront()--> front
+//   output : front --FrontToSlot()--> slot --SlotToBack()--> back
+//
+// Values are swapped where the source is overwritten anyway, so memory held by a vector is
+// recycled instead of copied.
+class SlotBindingBase {
+
+public:
+
+  // constructor
+  SlotBindingBase(const std::string & name) : m_name(name) {}
+
+  // destructor
+  virtual ~SlotBindingBase() {}
+
+  // name of variable
+  const std::string & GetName() const { return m_name; }
+
+  // allocate slots
+  virtual void Resize(unsigned int nSlots) = 0;
+
+  // allocate backs (before any address of a back is taken)
+  virtual void SetNBacks(unsigned int nBacks) = 0;
+
+  // address of back to pass to SetBranchAddress() (address of pointer for objects)
+  virtual void * GetBackAddress(unsigned int back) = 0;
+
+  // columnar output binding of front or first back
+  virtual ColumnBindingBase * NewColumnBinding(bool back) = 0;
+
+  // move values between front, slots and back (the reader uses the first back)
+  virtual void BackToSlot (unsigned int slot) = 0;
+  virtual void SlotToFront(unsigned int slot) = 0;
+  virtual void FrontToSlot(unsigned int slot) = 0;
+  virtual void SlotToBack (unsigned int slot, unsigned int back) = 0;
+
+
+private:
+
+  std::string m_name;
+
+};
+
+
+// value held by slot (wrapped, so slots of bool are not packed into std::vector<bool>)
+template <class T>
+struct SlotValue {
+  T value;
+};
+
+
+// variable at fixed address (simple variables, or objects declared by reference)
+template <class T>
+class SlotBinding : public SlotBindingBase {
+
+public:
+
+  SlotBinding(const std::string & name, T * front) : SlotBindingBase(name), m_front(front) { SetNBacks(1); }
+
+  void Resize(unsigned int nSlots) { m_slots.resize(nSlots); }
+
+  void SetNBacks(unsigned int nBacks)
+  {
+    m_backs.resize(nBacks);
+    m_backPtrs.resize(nBacks);
+    for (unsigned int i = 0; i < nBacks; ++i) m_backPtrs[i] = &m_backs[i].value;
+  }
+
+  void * GetBackAddress(unsigned int back) { return std::is_arithmetic<T>::value ? static_cast<void *>(m_backPtrs[back]) : static_cast<void *>(&m_backPtrs[back]); }
+
+  ColumnBindingBase * NewColumnBinding(bool back) { return new ColumnBinding<T>(GetName(), back ? m_backPtrs[0] : m_front); }
+
+  void BackToSlot (unsigned int slot)                    { std::swap(m_backs[0].value, m_slots[slot].value);    }
+  void SlotToFront(unsigned int slot)                    { std::swap(*m_front, m_slots[slot].value);            }
+  void FrontToSlot(unsigned int slot)                    { m_slots[slot].value = *m_front;                      }
+  void SlotToBack (unsigned int slot, unsigned int back) { std::swap(m_backs[back].value, m_slots[slot].value); }
+
+private:
+
+  T *                         m_front;
+  std::vector< SlotValue<T> > m_backs;
+  std::vector<T *>            m_backPtrs;
+  std::vector< SlotValue<T> > m_slots;
+
+};
+
+
+// object connected through pointer (non-simple variables, e.g. std::vector)
+template <class T>
+class SlotBinding<T *> : public SlotBindingBase {
+
+public:
+
+  SlotBinding(const std::string & name, T ** front) : SlotBindingBase(name), m_front(front) { SetNBacks(1); }
+
+  void Resize(unsigned int nSlots) { m_slots.resize(nSlots); }
+
+  void SetNBacks(unsigned int nBacks)
+  {
+    m_backs.resize(nBacks);
+    m_backPtrs.resize(nBacks);
+    for (unsigned int i = 0; i < nBacks; ++i) m_backPtrs[i] = &m_backs[i].value;
+  }
+
+  void * GetBackAddress(unsigned int back) { return &m_backPtrs[back]; }
+
+  ColumnBindingBase * NewColumnBinding(bool back) { return new ColumnBinding<T *>(GetName(), back ? &m_backPtrs[0] : m_front); }
+
+  void BackToSlot (unsigned int slot)                    { std::swap(m_backs[0].value, m_slots[slot].value);    }
+  void SlotToFront(unsigned int slot)                    { std::swap(**m_front, m_slots[slot].value);           }
+  void FrontToSlot(unsigned int slot)                    { m_slots[slot].value = **m_front;                     }
+  void SlotToBack (unsigned int slot, unsigned int back) { std::swap(m_backs[back].value, m_slots[slot].value); }
+
+private:
+
+  T **                        m_front;
+  std::vector< SlotValue<T> > m_backs;
+  std::vector<T *>            m_backPtrs;
+  std::vector< SlotValue<T> > m_slots;
+
+};
+
+#endif
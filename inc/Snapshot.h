@@ -0,0 +1,72 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __SNAPSHOT__
+#define __SNAPSHOT__
+
+
+// Standard Template Library includes
+#include <utility>
+
+
+// Base class for copies of input variables, which are saved after an entry is read and
+// restored before each selection chain, so a chain can't see what another chain wrote.
+// Variables not declared as outputs are only compared with their copy, to find selectors
+// writing to them without declaring it
+class SnapshotBase {
+
+ public:
+
+  // constructor
+  SnapshotBase() {};
+
+  // destructor
+  virtual ~SnapshotBase() {};
+
+  // copy variable
+  virtual void Save() = 0;
+
+  // overwrite variable with copy
+  virtual void Restore() = 0;
+
+  // check if variable differs from copy
+  virtual bool IsModified() const = 0;
+
+};
+
+
+namespace SNAPSHOT {
+
+  // compare with operator== if the type has one (otherwise the variable is never reported as modified)
+  template <class T>
+  auto Equal(const T & a, const T & b, int) -> decltype( static_cast<bool>( a == b ) ) { return a == b; }
+  template <class T>
+  bool Equal(const T &, const T &, long) { return true; }
+
+}
+
+
+// Copy of input variable of type T
+template <class T>
+class Snapshot : public SnapshotBase {
+
+ public:
+
+  // constructor
+  Snapshot(T * addr) : m_addr(addr), m_copy() {}
+
+  // copy variable (assignment re-uses memory held by the copy, e.g. of a vector)
+  virtual void Save() { m_copy = *m_addr; }
+
+  // overwrite variable with copy
+  virtual void Restore() { *m_addr = m_copy; }
+
+  // check if variable differs from copy
+  virtual bool IsModified() const { return ! SNAPSHOT::Equal( *m_addr , m_copy , 0 ); }
+
+ private:
+
+  T * m_addr;
+  T   m_copy;
+
+};
+
+#endif
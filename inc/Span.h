@@ -0,0 +1,65 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __SPAN__
+#define __SPAN__
+
+// Standard Template Library includes
+#include <cstddef>
+#include <stdexcept>
+
+
+// Non-owning view of a contiguous block of elements. 
+// The framework re-points spans handed out to selectors when new data is read, 
+// so selectors must not keep copies of the data pointer across events.
+//
+// Usage in a selector, for a vector<float> branch or a variable-length array leaf (e.g. "x[n]/F"),
+// in place of a std::vector<float> pointer:
+//
+//   const Span<const float> * my_vector_float;
+//   GetVariable( "my_vector_float" , my_vector_float );
+//   for (unsigned int i=0; i<my_vector_float->size(); ++i) {
+//     if ( (*my_vector_float)[i] < my_float_min ) return GLOBAL::SKIP;
+//   }
+template <class T>
+class Span {
+
+public:
+
+  // constructors
+  Span() : m_data(0), m_size(0) {}
+  Span(T * data, std::size_t size) : m_data(data), m_size(size) {}
+
+  // conversion from span of non-const elements (e.g. Span<float> -> Span<const float>)
+  template <class U>
+  Span(const Span<U> & other) : m_data(other.data()), m_size(other.size()) {}
+
+  // element access
+  T & operator[](std::size_t i) const { return m_data[i]; }
+  T & at(std::size_t i) const 
+  { 
+    if ( i >= m_size ) throw std::out_of_range("Span::at()");
+    return m_data[i]; 
+  }
+  T & front() const { return m_data[0]; }
+  T & back()  const { return m_data[m_size-1]; }
+  T * data()  const { return m_data; }
+
+  // size
+  std::size_t size()  const { return m_size; }
+  bool        empty() const { return m_size == 0; }
+
+  // iterators
+  T * begin() const { return m_data; }
+  T * end()   const { return m_data + m_size; }
+
+  // re-point view (used by the framework)
+  void Reset(T * data, std::size_t size) { m_data = data; m_size = size; }
+
+
+private:
+
+  T *         m_data;
+  std::size_t m_size;
+
+};
+
+#endif
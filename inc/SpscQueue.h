@@ -0,0 +1,66 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __SPSCQUEUE__
+#define __SPSCQUEUE__
+
+// Standard Template Library includes
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Push() fails if the queue is full and Pop() fails if it is empty - the caller decides how to wait.
+template <class T>
+class SpscQueue {
+
+public:
+
+  // constructor
+  SpscQueue(unsigned int capacity) : m_buffer(capacity + 1), m_head(0), m_tail(0) {}
+
+  // add value (producer thread only), returns false if queue is full
+  bool Push(const T & value)
+  {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t next = (tail + 1) % m_buffer.size();
+    if ( next == m_head.load(std::memory_order_acquire) ) return false;
+    m_buffer[tail] = value;
+    m_tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // remove value (consumer thread only), returns false if queue is empty
+  bool Pop(T & value)
+  {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if ( head == m_tail.load(std::memory_order_acquire) ) return false;
+    value = m_buffer[head];
+    m_head.store((head + 1) % m_buffer.size(), std::memory_order_release);
+    return true;
+  }
+
+  // number of values in queue (approximate while other thread is active)
+  unsigned int Size() const
+  {
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+    const std::size_t tail = m_tail.load(std::memory_order_acquire);
+    return (tail + m_buffer.size() - head) % m_buffer.size();
+  }
+
+  // maximum number of values in queue
+  unsigned int Capacity() const { return m_buffer.size() - 1; }
+
+
+private:
+
+  // no copying
+  SpscQueue(const SpscQueue &);
+  SpscQueue & operator=(const SpscQueue &);
+
+  std::vector<T>           m_buffer;
+  std::atomic<std::size_t> m_head;
+  std::atomic<std::size_t> m_tail;
+
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <map>
 #include <string>
 #include <vector>
+#include <mutex>
 
 // Framework includes
 #include "Log.h"
@@ -48,6 +49,10 @@ class Store {
   // flush store (remove all entries)
   void flush();
 
+  // card file lines of the fields with keys starting with prefix, in key order (fields not
+  // read from the card file are not described)
+  std::string describe(const std::string & prefix = "") const;
+
   
   // create store from card file
   static Store * createStore(const char * filename);
@@ -58,6 +63,12 @@ class Store {
 
   // map of data fields
   std::map<std::string,FieldBase *> m_data;
+
+  // card file line of each field read by createStore() (tokens separated by single spaces)
+  std::map<std::string,std::string> m_lines;
+
+  // guards m_data (selectors may run in parallel)
+  mutable std::mutex m_mutex;
   
   // convert string field to other type, used by createStore()
   template <class T>
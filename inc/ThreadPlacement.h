@@ -0,0 +1,50 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __THREADPLACEMENT__
+#define __THREADPLACEMENT__
+
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// Analysis includes
+#include "Log.h"
+
+// forward declarations
+class Store;
+
+
+// Pins the threads of the framework to cores given in the card file (one list per role):
+//
+//   vector<int> mainCpus   = 0         (event loop, selectors run one by one, histograms)
+//   vector<int> workerCpus = 1 2 3     (selectors run in parallel, see nSelectorThreads)
+//   vector<int> readerCpus = 4         (pipeline reader - reads and decompresses baskets)
+//   vector<int> writerCpus = 5 6       (pipeline writers - compress and write baskets)
+//   vector<int> sinkCpus   = 7         (pipeline sink - merges blocks of several writers)
+//
+// Thread k of a role (index given by the caller, e.g. the k-th pipeline writer) is pinned to the
+// k-th core of its list (cyclically), so threads started again for a new input file get the same
+// cores. A thread is pinned when it starts, before it allocates its buffers, so the kernel's
+// first-touch policy places them on the NUMA node of its core. The main thread is pinned before
+// selectors are initialised, so the Store, histograms and variables connected by selectors are
+// local to it. The NUMA nodes and the placement requested are reported at startup, and each thread
+// reports the core and node it was pinned to (Linux only - elsewhere threads are not pinned).
+class ThreadPlacement {
+
+public:
+
+  // roles of threads
+  enum ROLE { MAIN = 0, WORKER, READER, WRITER, SINK, NROLES };
+
+  // read cores of roles from card file, report NUMA nodes and placement, and pin calling (main) thread
+  static void Configure(const Store & config, const Log::LEVEL & logLevel);
+
+  // pin calling thread, with given index among the threads of its role, to its core (nothing if no
+  // cores are given for role)
+  static void Apply(ROLE role, unsigned int index);
+
+  // NUMA node of core (-1 if unknown)
+  static int GetNode(int cpu);
+
+};
+
+#endif
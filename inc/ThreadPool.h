@@ -0,0 +1,58 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __THREADPOOL__
+#define __THREADPOOL__
+
+// Standard Template Library includes
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+
+// Fixed-size pool of threads running a function for a range of task indices.
+// The calling thread takes part in the work, so a pool of N threads starts N-1 workers.
+class ThreadPool {
+
+public:
+
+  // constructor
+  ThreadPool(unsigned int nThreads);
+
+  // destructor (joins workers)
+  ~ThreadPool();
+
+  // run function(i) for i in [0,n) in parallel, and return when all calls are done
+  void Run(unsigned int n, const std::function<void(unsigned int)> & function);
+
+  // number of threads (including the calling thread)
+  unsigned int GetNThreads() const { return m_threads.size() + 1; }
+
+
+private:
+
+  // no copying (owns threads)
+  ThreadPool(const ThreadPool &);
+  ThreadPool & operator=(const ThreadPool &);
+
+  // worker loop (index of worker thread)
+  void Work(unsigned int index);
+
+  // run tasks until none are left
+  void Drain();
+
+  std::vector<std::thread>                  m_threads;
+  std::mutex                                m_mutex;
+  std::condition_variable                   m_start;
+  std::condition_variable                   m_done;
+  const std::function<void(unsigned int)> * m_function;
+  unsigned int                              m_n;
+  std::atomic<unsigned int>                 m_next;
+  unsigned int                              m_active;
+  unsigned long                             m_generation;
+  bool                                      m_stop;
+
+};
+
+#endif
@@ -0,0 +1,68 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __TRACER__
+#define __TRACER__
+
+// Standard Template Library includes
+#include <string>
+
+// Analysis includes
+#include "Enums.h"
+#include "Log.h"
+
+
+// Timeline of framework and selector activity, written as Chrome trace-event JSON (open it in
+// chrome://tracing or https://ui.perfetto.dev). Spans are recorded with a Span, named by an index
+// from AddName():
+//
+//   const unsigned int name = Tracer::AddName("GetEntry");
+//   ...
+//   {
+//     Tracer::Span span(name);
+//     service.GetEntry(event);
+//   }
+//
+// Each thread records into its own ring buffer (no locks or allocations while recording) - when it
+// is full, the oldest spans are overwritten, so the end of the job is kept. Nothing is recorded
+// until the tracer is enabled (card file: bool trace, string traceFileName, int traceBufferSize).
+class Tracer {
+
+public:
+
+  // maximum number of names (further names are recorded as "other")
+  static const unsigned int MAXNAMES = 1024;
+
+  // start or stop recording (capacity is the number of spans kept per thread)
+  static void Enable(bool enable, unsigned int capacity = 1000000);
+  static bool IsEnabled();
+
+  // add name of spans (in category, e.g. "framework" or "selector"), returns its index (the same
+  // index for the same name)
+  static unsigned int AddName(const std::string & name, const std::string & category = "framework");
+
+  // name calling thread in the timeline (if enabled)
+  static void SetThreadName(const std::string & name);
+
+  // time since tracer was enabled (nanoseconds)
+  static long long Now();
+
+  // record span of calling thread
+  static void Record(unsigned int name, long long start, long long end);
+
+  // write spans of all threads (threads must not record while writing)
+  static GLOBAL::STATUS Write(const std::string & fileName, const Log::LEVEL & logLevel);
+
+  // record span from construction to destruction
+  class Span {
+  public:
+    Span(unsigned int name) : m_name(name), m_start( IsEnabled() ? Now() : -1 ) {}
+    ~Span() { if ( m_start >= 0 ) Record(m_name, m_start, Now()); }
+  private:
+    Span(const Span &);
+    Span & operator=(const Span &);
+    unsigned int m_name;
+    long long    m_start;
+  };
+
+};
+
+#endif
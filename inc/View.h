@@ -0,0 +1,118 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __VIEW__
+#define __VIEW__
+
+// Standard Template Library includes
+#include <vector>
+
+// Analysis includes
+#include "ViewBase.h"
+#include "JaggedArray.h"
+#include "Span.h"
+#include "ColumnFormat.h"
+
+// ROOT includes
+#include <TLeaf.h>
+
+
+// Flattens a vector<vector<T> > branch into a JaggedArray<T>. ROOT still fills the nested vector
+// it owns, so each entry costs one extra copy of the elements into the flat array.
+template <class T>
+class JaggedView : public ViewBase {
+
+public:
+
+  // constructor
+  JaggedView() : m_source(0) {}
+
+  // destructor
+  virtual ~JaggedView() {}
+
+  // refresh view after new entry was read
+  void Update() 
+  { 
+    if ( m_source ) m_array.assign( *m_source );
+    else m_array.clear();
+  }
+
+  // detach view from input tree
+  void Release() { m_source = 0; m_array.clear(); }
+
+  // pointer connected to the branch in the input tree (owned by ROOT)
+  std::vector<std::vector<T> > *& Source() { return m_source; }
+
+  // flattened array handed out to selectors
+  JaggedArray<T> & Array() { return m_array; }
+
+
+private:
+
+  std::vector<std::vector<T> > * m_source;
+  JaggedArray<T>                 m_array;
+
+};
+
+
+// Read-only view of a vector<T> branch, or of a variable-length array leaf (e.g. "x[n]/F").
+// No data is copied: for vector<T> branches the span points into the vector that ROOT 
+// unpacks the basket into, and for array leaves ROOT unpacks directly into the view's buffer.
+template <class T>
+class SpanView : public ViewBase {
+
+public:
+
+  // constructor
+  SpanView() : m_source(0), m_leaf(0) {}
+
+  // destructor
+  virtual ~SpanView() {}
+
+  // refresh view after new entry was read
+  void Update() 
+  { 
+    if      ( m_source ) m_span.Reset(m_source->data(), m_source->size());
+    else if ( m_leaf   ) m_span.Reset(m_buffer.data(), m_leaf->GetLen());
+    else                 m_span.Reset(0, 0);
+  }
+
+  // detach view from input tree
+  void Release() { m_source = 0; m_leaf = 0; m_span.Reset(0, 0); }
+
+  // point view at externally owned values (e.g. a memory-mapped column)
+  bool Map(char type, const void * data, std::size_t size)
+  {
+    if ( type != COLUMNFORMAT::TypeCode<T>() ) return false;
+    m_span.Reset(static_cast<const T *>(data), size);
+    return true;
+  }
+
+  // pointer connected to a vector<T> branch in the input tree (owned by ROOT)
+  std::vector<T> *& Source() { return m_source; }
+  bool MapsSource(const void * source) const { return source == &m_source; }
+
+  // connect view to an array leaf, and return buffer that must be connected to the leaf's branch
+  T * ConnectLeaf(TLeaf * leaf) 
+  {
+    m_leaf = leaf;
+    const int maxCount = leaf->GetLeafCount() ? leaf->GetLeafCount()->GetMaximum() : 1;
+    if ( m_buffer.size() < static_cast<unsigned int>(maxCount * leaf->GetLenStatic()) ) m_buffer.resize(maxCount * leaf->GetLenStatic());
+    return m_buffer.data();
+  }
+
+  // check if view is connected to an array leaf
+  bool IsLeafConnected() const { return m_leaf != 0; }
+
+  // view handed out to selectors
+  Span<const T> & GetSpan() { return m_span; }
+
+
+private:
+
+  std::vector<T> * m_source;
+  TLeaf *          m_leaf;
+  std::vector<T>   m_buffer;
+  Span<const T>    m_span;
+
+};
+
+#endif
@@ -0,0 +1,37 @@
+// Dear emacs, this is -*- c++ -*-
+#ifndef __VIEWBASE__
+#define __VIEWBASE__
+
+// Standard Template Library includes
+#include <cstddef>
+
+
+// Base class for objects derived from branches in the input tree, 
+// which must be refreshed after every call to Service::GetEntry()
+class ViewBase {
+
+ public:
+  
+  // constructor
+  ViewBase() {};
+
+  // destructor
+  virtual ~ViewBase() {};
+
+  // refresh view after new entry was read
+  virtual void Update() = 0;
+
+  // detach view from input tree (called when moving to the next input file)
+  virtual void Release() = 0;
+
+  // point view at externally owned values of the given type code (see ColumnFormat.h) instead 
+  // of refreshing it from the input tree - returns false if the view doesn't support it
+  virtual bool Map(char /*type*/, const void * /*data*/, std::size_t /*size*/) { return false; }
+
+  // check if the pointer at the given address is the one the view connects to the input tree, and 
+  // the view can be mapped (so the pointer's values aren't needed when reading a mapped cache)
+  virtual bool MapsSource(const void * /*source*/) const { return false; }
+
+};
+
+#endif
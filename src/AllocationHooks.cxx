@@ -0,0 +1,100 @@
+// Standard Template Library includes
+#include <new>
+#include <cstdlib>
+
+// Analysis includes
+#include "AllocationHooks.h"
+#include "AllocationProfiler.h"
+
+
+namespace {
+
+  // allocate, calling the installed new_handler until the allocation succeeds (0 if there is none)
+  void * Allocate(std::size_t size)
+  {
+    if ( AllocationProfiler::IsEnabled() ) AllocationProfiler::CountAllocation(size);
+    while ( true ) {
+      void * pointer = std::malloc(size ? size : 1);
+      if ( pointer ) return pointer;
+      std::new_handler handler = std::get_new_handler();
+      if ( ! handler ) return 0;
+      handler();
+    }
+  }
+
+}
+
+
+void * operator new(std::size_t size)
+{
+
+  void * pointer = Allocate(size);
+  if ( ! pointer ) throw std::bad_alloc();
+
+  return pointer;
+
+}
+
+
+void * operator new[](std::size_t size)
+{
+
+  return operator new(size);
+
+}
+
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+
+  // the new_handler may throw (e.g. bad_alloc)
+  try {
+    return Allocate(size);
+  }
+  catch (...) {
+    return 0;
+  }
+
+}
+
+
+void * operator new[](std::size_t size, const std::nothrow_t & tag) noexcept
+{
+
+  return operator new(size, tag);
+
+}
+
+
+void operator delete(void * pointer) noexcept
+{
+
+  if ( ! pointer ) return;
+  if ( AllocationProfiler::IsEnabled() ) AllocationProfiler::CountDeallocation();
+  std::free(pointer);
+
+}
+
+
+void operator delete[](void * pointer) noexcept
+{
+
+  operator delete(pointer);
+
+}
+
+
+void operator delete(void * pointer, const std::nothrow_t &) noexcept
+{
+
+  operator delete(pointer);
+
+}
+
+
+void operator delete[](void * pointer, const std::nothrow_t &) noexcept
+{
+
+  operator delete(pointer);
+
+}
@@ -0,0 +1,142 @@
+// Standard Template Library includes
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+// Analysis includes
+#include "AllocationProfiler.h"
+
+
+namespace {
+
+  // counters of context (no allocations on the counting path)
+  struct Counter {
+    std::atomic<unsigned long> allocations;
+    std::atomic<unsigned long> bytes;
+    std::atomic<unsigned long> deallocations;
+  };
+
+  std::atomic<bool> g_enabled(false);
+  Counter           g_counters[AllocationProfiler::MAXCONTEXTS];
+  thread_local unsigned int t_context = 0;
+
+  // names of contexts (context 0 is "other")
+  std::mutex & NamesMutex() { static std::mutex mutex; return mutex; }
+  std::vector<std::string> & Names() { static std::vector<std::string> names(1,"other"); return names; }
+
+}
+
+
+void AllocationProfiler::Enable(bool enable)
+{
+
+  g_enabled.store(enable, std::memory_order_relaxed);
+
+}
+
+
+void AllocationProfiler::Reset()
+{
+
+  for (unsigned int i = 0; i < MAXCONTEXTS; ++i) {
+    g_counters[i].allocations.store(0, std::memory_order_relaxed);
+    g_counters[i].bytes.store(0, std::memory_order_relaxed);
+    g_counters[i].deallocations.store(0, std::memory_order_relaxed);
+  }
+
+}
+
+
+bool AllocationProfiler::IsEnabled()
+{
+
+  return g_enabled.load(std::memory_order_relaxed);
+
+}
+
+
+unsigned int AllocationProfiler::AddContext(const std::string & name)
+{
+
+  std::lock_guard<std::mutex> lock(NamesMutex());
+  std::vector<std::string> & names = Names();
+  std::vector<std::string>::iterator iter = std::find(names.begin(), names.end(), name);
+  if ( iter != names.end() ) return iter - names.begin();
+  if ( names.size() == MAXCONTEXTS ) return 0;
+  names.push_back(name);
+
+  return names.size() - 1;
+
+}
+
+
+unsigned int AllocationProfiler::SetContext(unsigned int context)
+{
+
+  const unsigned int previous = t_context;
+  t_context = context < MAXCONTEXTS ? context : 0;
+
+  return previous;
+
+}
+
+
+void AllocationProfiler::CountAllocation(std::size_t bytes)
+{
+
+  Counter & counter = g_counters[t_context];
+  counter.allocations.fetch_add(1, std::memory_order_relaxed);
+  counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+}
+
+
+void AllocationProfiler::CountDeallocation()
+{
+
+  g_counters[t_context].deallocations.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+
+void AllocationProfiler::Report(long nEvents, const Log::LEVEL & logLevel)
+{
+
+  Log log("AllocationProfiler");
+  log.SetLevel(logLevel);
+
+  // contexts that allocated, most allocations first
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock(NamesMutex());
+    names = Names();
+  }
+  std::vector<unsigned int> contexts;
+  for (unsigned int i = 0; i < names.size(); ++i) {
+    if ( g_counters[i].allocations.load() > 0 ) contexts.push_back(i);
+  }
+  std::stable_sort(contexts.begin(), contexts.end(), [](unsigned int a, unsigned int b) {
+      return g_counters[a].allocations.load() > g_counters[b].allocations.load();
+    });
+
+  const double n = nEvents > 0 ? nEvents : 1;
+  log << Log::INFO << "Heap allocations (" << nEvents << " events):" << Log::endl();
+  std::ostringstream header;
+  header << std::setw(40) << std::left << "context" << std::right << std::setw(16) << "allocs/event" << std::setw(16) << "bytes/event"
+	 << std::setw(16) << "frees/event" << std::setw(16) << "allocs" << std::setw(14) << "MB";
+  log << Log::INFO << header.str() << Log::endl();
+  for (unsigned int k = 0; k < contexts.size(); ++k) {
+    const Counter & counter = g_counters[ contexts[k] ];
+    std::ostringstream line;
+    line << std::setw(40) << std::left << names[ contexts[k] ] << std::right << std::fixed << std::setprecision(1)
+	 << std::setw(16) << counter.allocations.load() / n << std::setw(16) << counter.bytes.load() / n
+	 << std::setw(16) << counter.deallocations.load() / n << std::setw(16) << counter.allocations.load()
+	 << std::setw(14) << counter.bytes.load() / ( 1024. * 1024. );
+    log << Log::INFO << line.str() << Log::endl();
+  }
+
+}
@@ -5,6 +5,9 @@
 #include <fstream>
 #include <sstream>
 #include <ctime>
+#include <algorithm>
+#include <thread>
+#include <random>
 
 // ROOT includes
 #include "TFile.h"
@@ -14,9 +17,20 @@
 // Analysis includes
 #include "Service.h"
 #include "SelectorBase.h"
+#include "SelectorSequence.h"
 #include "Enums.h"
 #include "Log.h"
 #include "Store.h"
+#include "EventPipeline.h"
+#include "HistogramBook.h"
+#include "PassCache.h"
+#include "IncrementalCache.h"
+#include "OutputMerger.h"
+#include "MemoryMonitor.h"
+#include "AllocationProfiler.h"
+#include "ClusterSampler.h"
+#include "Tracer.h"
+#include "ThreadPlacement.h"
 
 
 int Usage(Log & log) {
@@ -33,31 +47,100 @@ int Usage(Log & log) {
 }
 
 
-int main(int argc, char** argv) 
+// selection chain - a sequence of selectors with its own histogram directory and output
+struct Chain {
+  std::string                 name;
+  std::vector<SelectorBase *> selectors;
+  std::vector<TDirectory *>   directories;
+  std::vector<HistogramBook*> histograms;
+  std::vector<unsigned int>   memory;        // memory components of selectors
+  std::vector<unsigned int>   allocations;   // allocation contexts of selectors
+  std::vector<std::string>    traces;        // names of selectors in timeline
+  SelectorSequence *          sequence;
+  TFile *                     outFileNtup;
+  bool                        fillOutputTree;
+};
+
+
+// default output file name of chain (chain name inserted before extension)
+std::string ChainFileName(const std::string & path, const std::string & chain) {
+
+  if ( chain.empty() ) return path;
+  std::string::size_type dot   = path.rfind('.');
+  std::string::size_type slash = path.rfind('/');
+  if ( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) ) return path + "_" + chain;
+
+  return path.substr(0,dot) + "_" + chain + path.substr(dot);
+
+}
+
+
+// set up process once, before any input file is analysed: pin threads to cores given in card file
+// (main thread now, before anything is allocated), and record timeline (see Tracer.h)
+void StartProcess(const Store * config, Log & log)
 {
 
+  ThreadPlacement::Configure( *config , log.GetLevel() );
 
-  // declare logger
-  Log log("AnalysisManager");
-  log << Log::INFO << "Starting program" << Log::endl();
+  bool trace = false;
+  int traceBufferSize = 1000000;
+  config->getif<bool>( "trace"           , trace           );
+  config->getif<int> ( "traceBufferSize" , traceBufferSize );
+  Tracer::Enable( trace , traceBufferSize > 0 ? traceBufferSize : 1 );
+  Tracer::SetThreadName( "main" );
 
+}
 
-  // read argument/steerfile
-  if ( argc != 2 || strcmp(argv[1],"--help") == 0 || strcmp(argv[1],"-h") == 0 ) return Usage( log );
-  const Store * config = Store::createStore( argv[1] ); 
-  if ( ! config ) return 0;
 
- 
+// write timeline once all input files were analysed (worker threads are idle)
+GLOBAL::STATUS FinishProcess(const Store * config, Log & log)
+{
+
+  bool trace = false;
+  std::string traceFileName = "trace.json";
+  config->getif<bool>       ( "trace"         , trace         );
+  config->getif<std::string>( "traceFileName" , traceFileName );
+  Tracer::Enable(false);
+  if ( trace && Tracer::Write( traceFileName , log.GetLevel() ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+// run selection chains over input files, and write histograms and outputs
+GLOBAL::STATUS Analyse(const Store * config, Log & log)
+{
+
   // open output files
   bool fillOutputTree = true;
   config->getif<bool>( "fillOutputTree" , fillOutputTree );
   std::string histFilePath = "histograms.root";
   std::string ntupFilePath = "ntuple.root";
+  std::string colFilePath  = "ntuple.amcol";
   config->getif<std::string>( "outputHistogramFileName" , histFilePath );
   config->getif<std::string>( "outputNtupleFileName"    , ntupFilePath );
-  TFile * outFileNtup = new TFile( ntupFilePath.c_str() ,"recreate" );
+  config->getif<std::string>( "outputColumnarFileName"  , colFilePath  );
+  std::vector<std::string> outputFormats(1,"root");
+  config->getif<std::vector<std::string> >( "outputFormats" , outputFormats );
+  for (unsigned int i = 0; i < outputFormats.size(); ++i) {
+    if ( outputFormats.at(i) != "root" && outputFormats.at(i) != "columnar" ) {
+      log << Log::ERROR << "Unknown output format \"" << outputFormats.at(i) << "\" (expected root or columnar)" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+  }
+  const bool treeOutput   = std::find(outputFormats.begin(),outputFormats.end(),"root")     != outputFormats.end();
+  const bool columnOutput = std::find(outputFormats.begin(),outputFormats.end(),"columnar") != outputFormats.end();
   TFile * outFileHist = new TFile( histFilePath.c_str() ,"recreate" );
 
+  // names of framework activity in timeline (see StartProcess)
+  const unsigned int traceOpen       = Tracer::AddName( "open input file" );
+  const unsigned int traceRead       = Tracer::AddName( "GetEntry" );
+  const unsigned int traceHistograms = Tracer::AddName( "histograms (card file)" );
+  const unsigned int traceFill       = Tracer::AddName( "fill output" );
+  const unsigned int traceFinish     = Tracer::AddName( "finish input file" );
+  const unsigned int traceWrite      = Tracer::AddName( "write output" );
+
 
   // initialise Service
   Service service( log.GetLevel() );
@@ -68,43 +151,193 @@ int main(int argc, char** argv)
   config->getif("inputFileNames",inFileNames);
   if (inFileNames.size() == 0) {
     log << Log::endl() << Log::ERROR << "No input files specified!" << Log::endl();
-    return 0;
+    return GLOBAL::ERROR;
   }
-  if ( service.PrepareInput( inFileNames ) != GLOBAL::SUCCESS ) return 0;;
-  if ( service.PrepareOutTree() != GLOBAL::SUCCESS ) return 0;
-  service.GetOutTree()->SetDirectory( outFileNtup );
-  
 
-  // declare and initialise selectors, and setup histogram directories
-  std::vector<SelectorBase *> selectors;
-  std::vector<std::string> selectorList;
-  config->getif<std::vector<std::string> >( "selectors" , selectorList );
-  for (unsigned int sel = 0; sel < selectorList.size(); ++sel ) {
+  // read only a subset of the clusters of the input trees, or stop early once the criteria of
+  // selectors and card file histograms are met (clusters and input files are then read in random order)
+  int prescale = 1;
+  double sampleFraction = 1.;
+  int sampleSeed = 1;
+  bool stopWhenConverged = false;
+  int convergenceInterval = 10000;
+  config->getif<int>   ( "prescale"            , prescale            );
+  config->getif<double>( "sampleFraction"      , sampleFraction      );
+  config->getif<int>   ( "sampleSeed"          , sampleSeed          );
+  config->getif<bool>  ( "stopWhenConverged"   , stopWhenConverged   );
+  config->getif<int>   ( "convergenceInterval" , convergenceInterval );
+  ClusterSampler sampler( prescale , sampleFraction , sampleSeed , stopWhenConverged , log.GetLevel() );
+  PassBitmap sampledEntries;
+  if ( stopWhenConverged ) {
+    std::mt19937 random( sampleSeed );
+    std::shuffle( inFileNames.begin() , inFileNames.end() , random );
+  }
+
+  if ( service.PrepareInput( inFileNames ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  sampler.SetInputEntries( service.GetNEvents() );
+
+  // memory budget - sizes the input tree cache and the output baskets (1/16 of the budget each),
+  // and the resident memory is accounted to selectors and I/O
+  int memoryBudgetMB = 0;
+  bool monitorMemory = false;
+  int memorySampleInterval = 100;
+  config->getif<int> ( "memoryBudgetMB"       , memoryBudgetMB       );
+  config->getif<bool>( "monitorMemory"        , monitorMemory        );
+  config->getif<int> ( "memorySampleInterval" , memorySampleInterval );
+  if ( memorySampleInterval < 1 ) memorySampleInterval = 1;
+  MemoryMonitor memory( memoryBudgetMB , monitorMemory || memoryBudgetMB > 0 , log.GetLevel() );
+  if ( memory.GetBudget() > 0 ) {
+    std::vector<std::string> outputChains;
+    config->getif<std::vector<std::string> >( "chains" , outputChains );
+    const long inputCacheSize  = memory.GetBudget() / 16;
+    const long outputFlushSize = memory.GetBudget() / 16 / ( outputChains.size() > 0 ? outputChains.size() : 1 );
+    service.SetInputCacheSize( inputCacheSize );
+    service.SetOutputFlushSize( outputFlushSize );
+    log << Log::INFO << "Memory budget of " << memoryBudgetMB << " MB - input tree cache of " << inputCacheSize / 1024 << " kB, output baskets flushed every "
+	<< outputFlushSize / 1024 << " kB per chain" << Log::endl();
+  }
+  const unsigned int memoryInput      = memory.AddComponent( "input (read entries)" );
+  const unsigned int memoryOutput     = memory.AddComponent( "output (fill and write)" );
+  const unsigned int memoryHistograms = memory.AddComponent( "histograms (card file)" );
+
+  bool useColumnCache = false;
+  config->getif<bool>( "useColumnCache" , useColumnCache );
+  if ( useColumnCache ) {
+    std::string cacheDirectory = "columncache";
+    config->getif<std::string>( "columnCacheDirectory" , cacheDirectory );
+    if ( service.EnableColumnCache( cacheDirectory ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  }
+  bool useBulkRead = false;
+  config->getif<bool>( "useBulkRead" , useBulkRead );
+  if ( useBulkRead && service.EnableBulkRead() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  bool useImplicitMT = false;
+  int implicitMTPoolSize = 0;
+  config->getif<bool>( "useImplicitMT"      , useImplicitMT      );
+  config->getif<int> ( "implicitMTPoolSize" , implicitMTPoolSize );
+  if ( useImplicitMT && service.EnableImplicitMT( implicitMTPoolSize > 0 ? implicitMTPoolSize : 0 ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  bool usePipeline = false;
+  config->getif<bool>( "usePipeline" , usePipeline );
+  if ( usePipeline && sampler.IsActive() ) {
+    log << Log::WARNING << "The pipeline reads entries in order - disabled when clusters are sampled or read in random order" << Log::endl();
+  }
+  else if ( usePipeline ) {
+    int pipelineDepth     = 4;
+    int pipelineBatchSize = 100;
+    int pipelineWriters   = 1;
+    int pipelineBlockSize = 10000;
+    bool pipelineKeepOrder = true;
+    config->getif<int> ( "pipelineDepth"     , pipelineDepth     );
+    config->getif<int> ( "pipelineBatchSize" , pipelineBatchSize );
+    config->getif<int> ( "pipelineWriters"   , pipelineWriters   );
+    config->getif<int> ( "pipelineBlockSize" , pipelineBlockSize );
+    config->getif<bool>( "pipelineKeepOrder" , pipelineKeepOrder );
+    if ( service.EnablePipeline( pipelineDepth > 1 ? pipelineDepth : 2 , pipelineBatchSize > 0 ? pipelineBatchSize : 1 ,
+				 pipelineWriters > 0 ? pipelineWriters : 1 , pipelineBlockSize > 0 ? pipelineBlockSize : 1 , pipelineKeepOrder ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  }
+
+
+  // setup selection chains (by default a single chain without name, using the global settings).
+  // all chains run over the same events, which are read only once
+  std::vector<std::string> chainNames;
+  config->getif<std::vector<std::string> >( "chains" , chainNames );
+  if ( chainNames.size() > 0 && service.SetChains( chainNames ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  int nSelectorThreads = 1;
+  config->getif<int>( "nSelectorThreads" , nSelectorThreads );
+  std::vector<Chain> chains( service.GetNChains() );
+  for (unsigned int ichain = 0; ichain < chains.size(); ++ichain) {
+
+    // activate chain in service (output and derived quantities)
+    Chain & chain = chains.at(ichain);
+    if ( service.SetActiveChain( ichain ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    chain.name = service.GetChainName();
+    const std::string prefix = chain.name.empty() ? "" : chain.name + "::";
+    if ( ! chain.name.empty() ) log << Log::INFO << "Setting up chain \"" << chain.name << "\"" << Log::endl();
+
+    // open output files
+    chain.fillOutputTree = fillOutputTree;
+    std::string chainNtupFilePath = ChainFileName( ntupFilePath , chain.name );
+    std::string chainColFilePath  = ChainFileName( colFilePath  , chain.name );
+    config->getif<bool>( prefix + "fillOutputTree" , chain.fillOutputTree );
+    config->getif<std::string>( prefix + "outputNtupleFileName"   , chainNtupFilePath );
+    config->getif<std::string>( prefix + "outputColumnarFileName" , chainColFilePath  );
+    chain.outFileNtup = chain.fillOutputTree && treeOutput ? new TFile( chainNtupFilePath.c_str() ,"recreate" ) : 0;
+    service.SetTreeOutput( treeOutput );
+    if ( ! chain.fillOutputTree ) service.DisableOutput();
+    if ( chain.fillOutputTree && columnOutput && service.EnableColumnOutput( chainColFilePath ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( service.PrepareOutTree() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( service.GetOutTree() ) service.GetOutTree()->SetDirectory( chain.outFileNtup );
+
+    // make directory for histograms of chain
+    TDirectory * chainDir = chain.name.empty() ? outFileHist : outFileHist->mkdir( chain.name.c_str() );
+
+    // declare and initialise selectors, and setup histogram directories
+    std::vector<std::string> selectorList;
+    config->getif<std::vector<std::string> >( prefix + "selectors" , selectorList );
+    for (unsigned int sel = 0; sel < selectorList.size(); ++sel ) {
     
-    // get selector name 
-    const std::string & name = selectorList.at(sel);
-
-    // declare selector
-    SelectorBase* theSelector = SelectorBase::CreateSelector(name,*config,service);
-    if ( theSelector ) {
-      log << Log::INFO << "Adding selector \"" << name << "\" to sequence" << Log::endl();
-      selectors.push_back(theSelector);
-    } 
-    else {
-      log << Log::ERROR << "Couldn't recognise selector \"" << name << "\"" << Log::endl();
-      return 0;
+      // get selector name 
+      const std::string & name = selectorList.at(sel);
+
+      // declare selector
+      SelectorBase* theSelector = SelectorBase::CreateSelector(name,*config,service);
+      if ( theSelector ) {
+	log << Log::INFO << "Adding selector \"" << name << "\" to sequence" << Log::endl();
+	chain.selectors.push_back(theSelector);
+      } 
+      else {
+	log << Log::ERROR << "Couldn't recognise selector \"" << name << "\"" << Log::endl();
+	return GLOBAL::ERROR;
+      }
+
+      // make directory for histograms
+      TDirectory* dir = chainDir->mkdir((chain.selectors.back()->GetName()).c_str());
+      chain.directories.push_back(dir);
+      dir->cd();
+
+      // initialise selector
+      chain.memory.push_back( memory.AddComponent( chain.name.empty() ? name : chain.name + "/" + name ) );
+      chain.allocations.push_back( AllocationProfiler::AddContext( chain.name.empty() ? name : chain.name + "/" + name ) );
+      chain.traces.push_back( chain.name.empty() ? name : chain.name + "/" + name );
+      memory.Begin();
+      {
+	Tracer::Span span( Tracer::AddName( chain.traces.back() + "::Initialise" , "selector" ) );
+	if ( chain.selectors.back()->Initialise() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+      }
+      memory.End( chain.memory.back() );
+
+      // book histograms declared in card file
+      memory.Begin();
+      chain.histograms.push_back( new HistogramBook( *chain.selectors.back() , *config ) );
+      if ( chain.histograms.back()->Book() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+      memory.End( memoryHistograms );
+
     }
+  
+    // setup execution of selectors
+    chain.sequence = new SelectorSequence( chain.selectors , nSelectorThreads > 1 ? nSelectorThreads : 1 , log.GetLevel() );
+    chain.sequence->SetMemoryMonitor( &memory , chain.memory );
+    chain.sequence->SetAllocationContexts( chain.allocations );
+    std::vector<unsigned int> traceExecute;
+    for (unsigned int algo = 0; algo < chain.traces.size(); ++algo) traceExecute.push_back( Tracer::AddName( chain.traces.at(algo) + "::ExecuteEvent" , "selector" ) );
+    chain.sequence->SetTraceNames( traceExecute );
 
-    // make directory for histograms
-    TDirectory* dir = outFileHist->mkdir((selectors.back()->GetName()).c_str());
-    dir->cd();
+  }
 
-    // initialise selector
-    if ( selectors.back()->Initialise() != GLOBAL::SUCCESS ) return 0;
 
+  // bitmaps of entries passing each selector, to skip unchanged selectors in later runs
+  bool usePassCache = false;
+  config->getif<bool>( "usePassCache" , usePassCache );
+  PassCache * passCache = 0;
+  if ( usePassCache ) {
+    std::string passCacheDirectory = "passcache";
+    bool passCacheIgnoreBuild = false;
+    config->getif<std::string>( "passCacheDirectory"   , passCacheDirectory   );
+    config->getif<bool>       ( "passCacheIgnoreBuild" , passCacheIgnoreBuild );
+    passCache = new PassCache( passCacheDirectory , passCacheIgnoreBuild , log.GetLevel() );
+    for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) passCache->AddChain( chains.at(ichain).selectors , *config );
   }
 
-  
+
   //
   // start analysis
   //
@@ -117,28 +350,109 @@ int main(int argc, char** argv)
 
   int reportFrac = nEventsMax/(nEventsMax > 100000 ? 10 : 1) + 1;
 
+  // histograms declared in card file are filled in batches of events
+  int histogramBatchSize = 1000;
+  config->getif<int>( "histogramBatchSize" , histogramBatchSize );
+  if ( histogramBatchSize < 1 ) histogramBatchSize = 1;
+
+  // count heap allocations of selectors and framework phases in the event loop
+  bool profileAllocations = false;
+  config->getif<bool>( "profileAllocations" , profileAllocations );
+  const unsigned int allocationsOpen       = AllocationProfiler::AddContext( "framework: open input file" );
+  const unsigned int allocationsRead       = AllocationProfiler::AddContext( "framework: read entry" );
+  const unsigned int allocationsStore      = AllocationProfiler::AddContext( "framework: clear object store" );
+  const unsigned int allocationsHistograms = AllocationProfiler::AddContext( "framework: histograms (card file)" );
+  const unsigned int allocationsOutput     = AllocationProfiler::AddContext( "framework: fill output" );
+  long nEventsTotal = 0;
+  if ( profileAllocations ) AllocationProfiler::Reset();
+  AllocationProfiler::Enable( profileAllocations );
+
+  // convergence criteria are checked every few events
+  if ( stopWhenConverged && service.GetConvergence().IsEmpty() ) {
+    log << Log::ERROR << "stopWhenConverged is set, but no selector or histogram in the card file has a convergence criterion" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( convergenceInterval < 1 ) convergenceInterval = 1;
+  long nEventsSinceCheck = 0;
+  bool converged = false;
+
   std::clock_t start = std::clock();
   for (unsigned int ifile = 0; ifile < inFileNames.size(); ++ifile) {
 
     // open next file and load tree
-    if ( service.NextInTree() != GLOBAL::SUCCESS ) return 0;
-
-    // update pointers in selectors
-    for ( unsigned int algo=0; algo<selectors.size(); ++algo ) {      
-      if ( selectors.at(algo)->BeginInputFile() != GLOBAL::SUCCESS ) {
-	log << Log::ERROR << "Couldn't update pointers!" << Log::endl();
-	return 0;
+    AllocationProfiler::SetContext( allocationsOpen );
+    memory.SetSampling(true);
+    memory.Begin();
+    {
+      Tracer::Span span( traceOpen );
+      if ( service.NextInTree() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    }
+    memory.End( memoryInput );
+
+    // update pointers in selectors, and schedule selectors using the variables they connected
+    for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) {
+      Chain & chain = chains.at(ichain);
+      service.SetActiveChain(ichain);
+      for ( unsigned int algo=0; algo<chain.selectors.size(); ++algo ) {      
+	memory.Begin();
+	Tracer::Span span( Tracer::AddName( chain.traces.at(algo) + "::BeginInputFile" , "selector" ) );
+	if ( chain.selectors.at(algo)->BeginInputFile() != GLOBAL::SUCCESS || chain.histograms.at(algo)->BeginInputFile() != GLOBAL::SUCCESS ) {
+	  log << Log::ERROR << "Couldn't update pointers!" << Log::endl();
+	  return GLOBAL::ERROR;
+	}
+	memory.End( chain.memory.at(algo) );
+	service.ProtectInputs( chain.selectors.at(algo)->GetOutputs() );
       }
+      if ( chain.sequence->Schedule() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    }
+    AllocationProfiler::SetContext(0);
+
+    // skip selectors with stored bitmaps, and read only entries passing them (and in sampled clusters)
+    const long nEventsTree = service.GetInTree()->GetEntries();
+    if ( passCache ) {
+      if ( passCache->NewInputFile( inFileNames.at(ifile) , treeName , nEventsTree ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+      for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) chains.at(ichain).sequence->SetSkipped( passCache->GetNSkipped(ichain) );
+      service.SetEntryList( passCache->GetEntryList() );
+    }
+    if ( sampler.IsActive() ) {
+      if ( sampler.Select( service.GetInTree() , inFileNames.at(ifile) , sampledEntries ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+      if ( passCache && passCache->GetEntryList() ) sampledEntries.Intersect( *passCache->GetEntryList() );
+      service.SetEntryList( &sampledEntries );
     }
         
     // loop over events
     int nEventsProcessed = 0;
-    const long nEventsTree = service.GetInTree()->GetEntries();
+    bool allProcessed = true;
     log << Log::INFO << "Looping over events... (" << nEventsTree << ")" << Log::endl();
-    for ( long event = 0; event < nEventsTree; ++event ) {
+    for ( long event = sampler.IsActive() ? sampler.FirstEntry() : service.NextEntry(0); event < nEventsTree;
+	  event = sampler.IsActive() ? sampler.NextEntry(event + 1) : service.NextEntry(event + 1) ) {
+
+      // stop when convergence criteria are met (checked before a new cluster is read)
+      if ( stopWhenConverged && nEventsSinceCheck >= convergenceInterval && sampler.IsNewCluster() ) {
+	nEventsSinceCheck = 0;
+	for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) {
+	  for ( unsigned int algo = 0; algo < chains.at(ichain).histograms.size(); ++algo ) chains.at(ichain).histograms.at(algo)->Flush();
+	}
+	if ( service.GetConvergence().IsMet() ) {
+	  log << Log::INFO << "Convergence criteria are met after " << nEventsTotal << " events - stopping" << Log::endl();
+	  converged = true;
+	  allProcessed = false;
+	  if ( sampler.IsActive() ) sampler.Stop( event );
+	  break;
+	}
+      }
                   
       // increment event count
-      if ((++nEventsProcessed) > nEventsMax) break;
+      if ((++nEventsProcessed) > nEventsMax) {
+	allProcessed = false;
+	if ( sampler.IsActive() ) sampler.Stop( event );
+	break;
+      }
+      ++nEventsTotal;
+      ++nEventsSinceCheck;
+
+      // sample memory every few events
+      memory.SetSampling( nEventsProcessed % memorySampleInterval == 0 );
 
       // print progress and remaining time estimate
       if( nEventsProcessed > 0 && nEventsProcessed % reportFrac == 0 ) {
@@ -153,27 +467,91 @@ int main(int argc, char** argv)
       }
 
       // get event
-      service.GetInTree()->GetEntry(event);
+      AllocationProfiler::SetContext( allocationsRead );
+      memory.Begin();
+      {
+	Tracer::Span span( traceRead );
+	if ( service.GetEntry(event) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+      }
+      service.SaveInputs();
+      memory.End( memoryInput );
+      AllocationProfiler::SetContext(0);
+
+      for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) {
+
+	// check previous chain only modified input variables declared as outputs, and undo its changes
+	if ( ichain > 0 ) {
+	  if ( service.CheckInputs() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+	  service.RestoreInputs();
+	}
+	Chain & chain = chains.at(ichain);
+	service.SetActiveChain(ichain);
 
-      // clear object store
-      service.ClearStore();
+	// skip chain if entry didn't pass the selectors it skips
+	if ( passCache && ! passCache->IsSelected(ichain,event) ) continue;
+
+	// clear object store
+	AllocationProfiler::SetContext( allocationsStore );
+	service.ClearStore();
+	AllocationProfiler::SetContext(0);
       
-      // execute analysis sequence
-      bool skipEvent = false;
-      for ( unsigned int algo = 0; algo < selectors.size(); ++algo ) {      
-	if ( selectors.at(algo)->ExecuteEvent() != GLOBAL::SUCCESS ) {
-	  skipEvent = true;
-	  break;
+	// execute analysis sequence
+	const GLOBAL::STATUS status = chain.sequence->ExecuteEvent();
+	if ( service.GetProducers().GetStatus() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+	if ( passCache ) passCache->Record( ichain , event , chain.sequence->GetNPassed() );
+
+	// stage histograms of selectors passed by the event
+	AllocationProfiler::SetContext( allocationsHistograms );
+	memory.Begin();
+	{
+	  Tracer::Span span( traceHistograms );
+	  for ( unsigned int algo = 0; algo < chain.sequence->GetNPassed(); ++algo ) {
+	    if ( chain.histograms.at(algo)->Stage() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+	  }
 	}
-      }
-      if (skipEvent) continue;
+	memory.End( memoryHistograms );
+	AllocationProfiler::SetContext(0);
+	if ( status != GLOBAL::SUCCESS ) continue;
       
-      // fill output tree
-      if ( ! fillOutputTree ) continue;
-      service.GetOutTree()->Fill();
+	// fill output tree
+	if ( ! chain.fillOutputTree ) continue;
+	AllocationProfiler::SetContext( allocationsOutput );
+	memory.Begin();
+	{
+	  Tracer::Span span( traceFill );
+	  if ( service.FillOutput() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+	}
+	memory.End( memoryOutput );
+	AllocationProfiler::SetContext(0);
+
+      }
+
+      // fill staged histograms
+      if ( nEventsProcessed % histogramBatchSize == 0 ) {
+	AllocationProfiler::SetContext( allocationsHistograms );
+	memory.Begin();
+	Tracer::Span span( traceHistograms );
+	for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) {
+	  for ( unsigned int algo = 0; algo < chains.at(ichain).histograms.size(); ++algo ) chains.at(ichain).histograms.at(algo)->Flush();
+	}
+	memory.End( memoryHistograms );
+	AllocationProfiler::SetContext(0);
+      }
       
     }
 
+    // write output of entries still in flight
+    memory.SetSampling(true);
+    memory.Begin();
+    {
+      Tracer::Span span( traceFinish );
+      if ( service.FinishInTree() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    }
+    memory.End( memoryOutput );
+
+    // store bitmaps of selectors that ran (not all entries were seen when sampling)
+    if ( passCache && passCache->EndInputFile( allProcessed && ! sampler.IsSubset() ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
     double duration  = (std::clock() - start)/static_cast<double>(CLOCKS_PER_SEC);    
     double frequency = static_cast<double>(nEventsProcessed) / duration;
     log << Log::INFO
@@ -183,37 +561,207 @@ int main(int argc, char** argv)
 	<< "  ---  remaining time :    0 sec"<< Log::endl(); 
     
     // release pointers in selectors
-    for ( unsigned int algo = 0; algo < selectors.size(); ++algo ) {      
-      if ( selectors.at(algo)->EndInputFile() != GLOBAL::SUCCESS ) {
-	log << Log::ERROR << "Couldn't release pointers!" << Log::endl();
-	return 0;
+    for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) {
+      for ( unsigned int algo = 0; algo < chains.at(ichain).selectors.size(); ++algo ) {      
+	memory.Begin();
+	Tracer::Span span( Tracer::AddName( chains.at(ichain).traces.at(algo) + "::EndInputFile" , "selector" ) );
+	if ( chains.at(ichain).selectors.at(algo)->EndInputFile() != GLOBAL::SUCCESS ) {
+	  log << Log::ERROR << "Couldn't release pointers!" << Log::endl();
+	  return GLOBAL::ERROR;
+	}
+	memory.End( chains.at(ichain).memory.at(algo) );
       }
     }
 
+    if ( converged ) break;
+
   }
+  AllocationProfiler::Enable(false);
+  const double loopDuration = (std::clock() - start)/static_cast<double>(CLOCKS_PER_SEC);
 
 
-  // finalise selectors
-  for ( unsigned int algo = 0; algo < selectors.size(); ++algo ) {          
+  for ( unsigned int ichain = 0; ichain < chains.size(); ++ichain ) {
 
-    TDirectory* dir = static_cast<TDirectory *>(outFileHist->Get((selectors.back()->GetName()).c_str()));
-    dir->cd();
+    Chain & chain = chains.at(ichain);
+    service.SetActiveChain(ichain);
 
-    if ( selectors.at(algo)->Finalise() != GLOBAL::SUCCESS ) {
-      log << Log::ERROR << "Couldn't finalise selectors!" << Log::endl();
-      return 0;
+    // finalise selectors
+    for ( unsigned int algo = 0; algo < chain.selectors.size(); ++algo ) {          
+
+      chain.directories.at(algo)->cd();
+
+      // write histograms declared in card file
+      memory.Begin();
+      {
+	Tracer::Span span( traceHistograms );
+	chain.histograms.at(algo)->Write();
+	delete chain.histograms.at(algo);
+      }
+      memory.End( memoryHistograms );
+
+      memory.Begin();
+      {
+	Tracer::Span span( Tracer::AddName( chain.traces.at(algo) + "::Finalise" , "selector" ) );
+	if ( chain.selectors.at(algo)->Finalise() != GLOBAL::SUCCESS ) {
+	  log << Log::ERROR << "Couldn't finalise selectors!" << Log::endl();
+	  return GLOBAL::ERROR;
+	}
+      }
+      memory.End( chain.memory.at(algo) );
+
+      // scale histograms to full input
+      if ( sampler.IsActive() ) sampler.Scale( chain.directories.at(algo) );
+
+      // mark histograms of selector skipped for some input files
+      if ( passCache ) passCache->Annotate( ichain , algo , chain.directories.at(algo) );
     }
-  }
-  
   
-  // save output
-  if ( fillOutputTree ) {
-    outFileNtup->Write();
-    outFileNtup->Close();
+    // report usage of derived quantities
+    if ( ! chain.name.empty() ) log << Log::INFO << "Chain \"" << chain.name << "\" done" << Log::endl();
+    service.GetProducers().Report();
+
+    // save output
+    if ( chain.fillOutputTree ) {
+      memory.Begin();
+      Tracer::Span span( traceWrite );
+      if ( chain.outFileNtup ) {
+	chain.outFileNtup->Write();
+	chain.outFileNtup->Close();
+      }
+      if ( service.CloseOutput() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+      memory.End( memoryOutput );
+    }
+    delete chain.sequence;
+
+    // delete selectors and output file (Analyse runs once per input file in incremental mode)
+    for ( unsigned int algo = 0; algo < chain.selectors.size(); ++algo ) delete chain.selectors.at(algo);
+    chain.selectors.clear();
+    delete chain.outFileNtup;
+    chain.outFileNtup = 0;
+
   }
-  outFileHist->Write();
-  outFileHist->Close();
-  
+
+  // report time spent in pipeline stages, and memory used by selectors and I/O
+  if ( service.GetPipeline() ) service.GetPipeline()->Report();
+  memory.Report();
+  if ( profileAllocations ) AllocationProfiler::Report( nEventsTotal , log.GetLevel() );
+  if ( sampler.IsActive() ) {
+    sampler.Report( loopDuration );
+    sampler.Annotate( outFileHist );
+  }
+  delete passCache;
+
+  // save histograms
+  {
+    Tracer::Span span( traceWrite );
+    outFileHist->Write();
+    outFileHist->Close();
+    delete outFileHist;
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+// process input files without partial outputs in cache, and merge partial outputs of all input files.
+// Analyse() runs once per input file, so Finalise() of the selectors also runs once per input file and
+// the histograms it writes are summed by the merger - histograms normalised in Finalise() (e.g. divided
+// by the number of events, or fitted) are wrong after merging, and must be normalised after the merge
+GLOBAL::STATUS AnalyseIncrementally(const Store * config, Log & log)
+{
+
+  // partial outputs are merged as ROOT files
+  std::vector<std::string> outputFormats(1,"root");
+  config->getif<std::vector<std::string> >( "outputFormats" , outputFormats );
+  if ( outputFormats.size() != 1 || outputFormats.at(0) != "root" ) {
+    log << Log::ERROR << "Incremental processing is only possible with root output" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  std::vector<std::string> inFileNames;
+  config->getif("inputFileNames",inFileNames);
+  if (inFileNames.size() == 0) {
+    log << Log::endl() << Log::ERROR << "No input files specified!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  std::string cacheDirectory = "partials";
+  config->getif<std::string>( "incrementalCacheDirectory" , cacheDirectory );
+  IncrementalCache cache( cacheDirectory , *config , log.GetLevel() );
+
+  // process new or changed input files one by one (thread placement and timeline are set up once)
+  StartProcess( config , log );
+  unsigned int nProcessed = 0;
+  for (unsigned int ifile = 0; ifile < inFileNames.size(); ++ifile) {
+    const std::string & fileName = inFileNames.at(ifile);
+    if ( cache.IsCached( fileName ) ) continue;
+    log << Log::INFO << "Processing \"" << fileName << "\" into cache" << Log::endl();
+    Store * fileConfig = cache.CreateConfig( fileName );
+    const GLOBAL::STATUS status = Analyse( fileConfig , log );
+    delete fileConfig;
+    if ( status != GLOBAL::SUCCESS || cache.Commit( fileName ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    ++nProcessed;
+  }
+  if ( FinishProcess( config , log ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  log << Log::INFO << "Processed " << nProcessed << " of " << inFileNames.size() << " input files, the others were taken from cache" << Log::endl();
+
+  // merge histograms
+  OutputMerger merger( std::thread::hardware_concurrency() , log.GetLevel() );
+  std::string histFilePath = "histograms.root";
+  config->getif<std::string>( "outputHistogramFileName" , histFilePath );
+  std::vector<std::string> partials;
+  for (unsigned int ifile = 0; ifile < inFileNames.size(); ++ifile) partials.push_back( cache.GetHistogramFileName( inFileNames.at(ifile) ) );
+  if ( merger.Merge( histFilePath , partials ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  // merge output trees of chains
+  bool fillOutputTree = true;
+  std::string ntupFilePath = "ntuple.root";
+  std::vector<std::string> chainNames;
+  config->getif<bool>( "fillOutputTree" , fillOutputTree );
+  config->getif<std::string>( "outputNtupleFileName" , ntupFilePath );
+  config->getif<std::vector<std::string> >( "chains" , chainNames );
+  if ( chainNames.empty() ) chainNames.push_back("");
+  for (unsigned int ichain = 0; ichain < chainNames.size(); ++ichain) {
+    const std::string & chain = chainNames.at(ichain);
+    const std::string prefix = chain.empty() ? "" : chain + "::";
+    bool chainFillOutputTree = fillOutputTree;
+    std::string chainNtupFilePath = ChainFileName( ntupFilePath , chain );
+    config->getif<bool>( prefix + "fillOutputTree" , chainFillOutputTree );
+    config->getif<std::string>( prefix + "outputNtupleFileName" , chainNtupFilePath );
+    if ( ! chainFillOutputTree ) continue;
+    partials.clear();
+    for (unsigned int ifile = 0; ifile < inFileNames.size(); ++ifile) partials.push_back( cache.GetNtupleFileName( inFileNames.at(ifile) , chain ) );
+    if ( merger.Merge( chainNtupFilePath , partials ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+int main(int argc, char** argv) 
+{
+
+
+  // declare logger
+  Log log("AnalysisManager");
+  log << Log::INFO << "Starting program" << Log::endl();
+
+
+  // read argument/steerfile
+  if ( argc != 2 || strcmp(argv[1],"--help") == 0 || strcmp(argv[1],"-h") == 0 ) return Usage( log );
+  const Store * config = Store::createStore( argv[1] ); 
+  if ( ! config ) return 0;
+
+
+  // run analysis (over all input files, or incrementally over new or changed input files)
+  bool useIncrementalCache = false;
+  config->getif<bool>( "useIncrementalCache" , useIncrementalCache );
+  if ( useIncrementalCache ) AnalyseIncrementally( config , log );
+  else {
+    StartProcess( config , log );
+    if ( Analyse( config , log ) == GLOBAL::SUCCESS ) FinishProcess( config , log );
+  }
+
   log << Log::INFO << "Leaving program" << Log::endl();
 
   return 0;
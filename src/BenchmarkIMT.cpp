@@ -0,0 +1,267 @@
+// Standard Template Library includes
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdio>
+
+// POSIX includes
+#include <unistd.h>
+#include <sys/wait.h>
+
+// ROOT includes
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+// Analysis includes
+#include "Log.h"
+
+
+// Throughput of reading all branches of a tree (e.g. ExampleTree.root from bin/CreateExampleTree)
+// against the size of ROOT's implicit multi-threading pool (card file: useImplicitMT,
+// implicitMTPoolSize). Each pool size is measured in its own process, as the pool can't be resized.
+// The decoded values of the branches are hashed in entry order, to check that the results don't
+// change (leaves of simple types and arrays, vectors and vectors of vectors of numbers - branches of
+// other types are reported, and not checked).
+
+
+int Usage(Log & log) {
+
+  log << Log::INFO << "Usage :"                                                                   << Log::endl();
+  log << Log::INFO << "   bin/BenchmarkIMT [file.root] [treeName] [maxPoolSize] [nEntries]"        << Log::endl();
+  log << Log::INFO << "This message :"                                                            << Log::endl();
+  log << Log::INFO << "   bin/BenchmarkIMT --help"                                                << Log::endl();
+
+  return 1;
+
+}
+
+
+// result of reading the tree
+struct Result {
+  double             seconds;
+  long               nEntries;
+  long long          bytes;
+  unsigned long long hash;
+  int                nUnchecked;
+};
+
+
+// add bytes to hash (FNV-1a)
+void HashBytes(unsigned long long & hash, const void * data, std::size_t n)
+{
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < n; ++i) hash = ( hash ^ bytes[i] ) * 1099511628211ULL;
+}
+
+
+// decoded values of a branch, hashed after each entry
+class Content {
+public:
+  virtual ~Content() {}
+  virtual void Hash(unsigned long long & hash) const = 0;
+};
+
+// leaf of simple type, or array of simple type (values in the leaf's own buffer)
+class LeafContent : public Content {
+public:
+  LeafContent(TLeaf * leaf) : m_leaf(leaf) {}
+  void Hash(unsigned long long & hash) const { HashBytes( hash , m_leaf->GetValuePointer() , m_leaf->GetLen() * m_leaf->GetLenType() ); }
+private:
+  TLeaf * m_leaf;
+};
+
+// vector of numbers
+template <class T>
+class VectorContent : public Content {
+public:
+  VectorContent(TTree * tree, const char * name) : m_values(0) { tree->SetBranchAddress(name,&m_values); }
+  ~VectorContent() { delete m_values; }
+  void Hash(unsigned long long & hash) const
+  {
+    const std::size_t n = m_values->size();
+    HashBytes( hash , &n , sizeof(n) );
+    HashBytes( hash , m_values->data() , n * sizeof(T) );
+  }
+private:
+  std::vector<T> * m_values;
+};
+
+// vector of vectors of numbers
+template <class T>
+class NestedContent : public Content {
+public:
+  NestedContent(TTree * tree, const char * name) : m_values(0) { tree->SetBranchAddress(name,&m_values); }
+  ~NestedContent() { delete m_values; }
+  void Hash(unsigned long long & hash) const
+  {
+    const std::size_t n = m_values->size();
+    HashBytes( hash , &n , sizeof(n) );
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::size_t m = (*m_values)[i].size();
+      HashBytes( hash , &m , sizeof(m) );
+      HashBytes( hash , (*m_values)[i].data() , m * sizeof(T) );
+    }
+  }
+private:
+  std::vector<std::vector<T> > * m_values;
+};
+
+
+// bind branch to hashed content (0 if the type of the branch is not supported)
+void AddContent(TTree * tree, TBranch * branch, std::vector<Content *> & contents)
+{
+
+  const std::string className = branch->GetClassName();
+  const char * name = branch->GetName();
+  if ( className.empty() ) {
+    TObjArray * leaves = branch->GetListOfLeaves();
+    for (Int_t i = 0; i < leaves->GetEntriesFast(); ++i) contents.push_back( new LeafContent( static_cast<TLeaf *>( leaves->UncheckedAt(i) ) ) );
+  }
+  else if ( className == "vector<float>"          ) contents.push_back( new VectorContent<float>       (tree,name) );
+  else if ( className == "vector<double>"         ) contents.push_back( new VectorContent<double>      (tree,name) );
+  else if ( className == "vector<int>"            ) contents.push_back( new VectorContent<int>         (tree,name) );
+  else if ( className == "vector<unsigned int>"   ) contents.push_back( new VectorContent<unsigned int>(tree,name) );
+  else if ( className == "vector<short>"          ) contents.push_back( new VectorContent<short>       (tree,name) );
+  else if ( className == "vector<char>"           ) contents.push_back( new VectorContent<char>        (tree,name) );
+  else if ( className == "vector<Long64_t>"       ) contents.push_back( new VectorContent<Long64_t>    (tree,name) );
+  else if ( className == "vector<vector<float> >" ) contents.push_back( new NestedContent<float>       (tree,name) );
+  else if ( className == "vector<vector<double> >") contents.push_back( new NestedContent<double>      (tree,name) );
+  else if ( className == "vector<vector<int> >"   ) contents.push_back( new NestedContent<int>         (tree,name) );
+  else contents.push_back(0);
+
+}
+
+
+// read entries with given pool size (0: implicit multi-threading disabled)
+bool Read(const std::string & fileName, const std::string & treeName, unsigned int poolSize, long nEntriesMax, Result & result)
+{
+
+  if ( poolSize > 0 ) ROOT::EnableImplicitMT(poolSize);
+  TFile * file = TFile::Open( fileName.c_str() );
+  TTree * tree = file ? static_cast<TTree *>( file->Get( treeName.c_str() ) ) : 0;
+  if ( ! tree ) return false;
+
+  // bind branches to hashed contents
+  std::vector<Content *> contents;
+  TObjArray * branches = tree->GetListOfBranches();
+  for (Int_t i = 0; i < branches->GetEntriesFast(); ++i) AddContent( tree , static_cast<TBranch *>( branches->UncheckedAt(i) ) , contents );
+  result.nUnchecked = 0;
+  for (unsigned int i = 0; i < contents.size(); ++i) result.nUnchecked += contents[i] ? 0 : 1;
+
+  const long nEntries = nEntriesMax >= 0 && nEntriesMax < tree->GetEntries() ? nEntriesMax : tree->GetEntries();
+  result.nEntries = nEntries;
+  result.bytes    = 0;
+  result.hash     = 14695981039346656037ULL;
+  bool ok = true;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long entry = 0; ok && entry < nEntries; ++entry) {
+    const int bytes = tree->GetEntry(entry);
+    ok = bytes >= 0;
+    result.bytes += bytes;
+    for (unsigned int i = 0; i < contents.size(); ++i) {
+      if ( contents[i] ) contents[i]->Hash(result.hash);
+    }
+  }
+  result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  file->Close();
+  for (unsigned int i = 0; i < contents.size(); ++i) delete contents[i];
+
+  return ok;
+
+}
+
+
+// read entries in child process
+bool Measure(const std::string & fileName, const std::string & treeName, unsigned int poolSize, long nEntriesMax, Result & result)
+{
+
+  int fds[2];
+  if ( pipe(fds) != 0 ) return false;
+  const pid_t pid = fork();
+  if ( pid < 0 ) return false;
+  if ( pid == 0 ) {
+    close(fds[0]);
+    const bool ok = Read(fileName, treeName, poolSize, nEntriesMax, result);
+    const ssize_t n = ok ? write(fds[1], &result, sizeof(result)) : 0;
+    _exit( n == static_cast<ssize_t>(sizeof(result)) ? 0 : 1 );
+  }
+  close(fds[1]);
+  const ssize_t n = read(fds[0], &result, sizeof(result));
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  return n == static_cast<ssize_t>(sizeof(result)) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+}
+
+
+int main(int argc, char** argv) 
+{
+
+  // declare logger
+  Log log("BenchmarkIMT");
+
+  // read arguments
+  const std::vector<std::string> args(argv + 1, argv + argc);
+  if ( args.size() > 4 || ( args.size() > 0 && ( args[0] == "--help" || args[0] == "-h" ) ) ) return Usage( log );
+  const std::string fileName   = args.size() > 0 ? args[0] : "ExampleTree.root";
+  const std::string treeName   = args.size() > 1 ? args[1] : "tree";
+  const unsigned int maxPool   = args.size() > 2 ? std::atoi(args[2].c_str()) : std::thread::hardware_concurrency();
+  const long nEntriesMax       = args.size() > 3 ? std::atol(args[3].c_str()) : -1;
+
+  // pool sizes - 0 (disabled), 1, 2, 4, ... and the largest
+  std::vector<unsigned int> poolSizes(1,0);
+  for (unsigned int n = 1; n < maxPool; n *= 2) poolSizes.push_back(n);
+  if ( maxPool > 0 ) poolSizes.push_back(maxPool);
+
+  // warm up file system cache
+  Result reference;
+  log << Log::INFO << "Reading \"" << treeName << "\" of \"" << fileName << "\" once to warm up the file system cache" << Log::endl();
+  if ( ! Measure(fileName, treeName, 0, nEntriesMax, reference) ) {
+    log << Log::ERROR << "Couldn't read tree \"" << treeName << "\" of file \"" << fileName << "\"" << Log::endl();
+    return 1;
+  }
+  if ( reference.nUnchecked > 0 ) {
+    log << Log::WARNING << reference.nUnchecked << " branches have types that are not supported - their values are not compared" << Log::endl();
+  }
+
+  // measure
+  log << Log::INFO << "  pool size    time [s]    entries/s      MB/s   speedup   same result" << Log::endl();
+  double baseline = 0.;
+  bool same = true;
+  for (unsigned int i = 0; i < poolSizes.size(); ++i) {
+    Result result;
+    if ( ! Measure(fileName, treeName, poolSizes[i], nEntriesMax, result) ) {
+      log << Log::ERROR << "Couldn't read tree with pool size " << poolSizes[i] << Log::endl();
+      return 1;
+    }
+    if ( i == 0 ) baseline = result.seconds;
+    const bool identical = result.nEntries == reference.nEntries && result.bytes == reference.bytes && result.hash == reference.hash;
+    same = same && identical;
+    std::ostringstream line;
+    line << std::setw(11) << ( poolSizes[i] ? std::to_string(poolSizes[i]) : std::string("off") ) << std::fixed
+	 << std::setprecision(3) << std::setw(12) << result.seconds
+	 << std::setprecision(0) << std::setw(13) << result.nEntries / result.seconds
+	 << std::setprecision(1) << std::setw(10) << result.bytes / result.seconds / 1e6
+	 << std::setprecision(2) << std::setw(10) << baseline / result.seconds
+	 << std::setw(14) << ( identical ? "yes" : "NO" );
+    log << Log::INFO << line.str() << Log::endl();
+  }
+
+  if ( ! same ) {
+    log << Log::ERROR << "Entries read with implicit multi-threading differ from those read without" << Log::endl();
+    return 1;
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,217 @@
+// Standard Template Library includes
+#include <algorithm>
+#include <sstream>
+
+// ROOT includes
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+// Analysis includes
+#include "BulkReader.h"
+
+
+namespace {
+
+  // type code (see ColumnFormat.h) of ROOT leaf type
+  char TypeCode(const std::string & type)
+  {
+    if ( type == "Bool_t"    ) return 'b';
+    if ( type == "Char_t"    ) return 'c';
+    if ( type == "UChar_t"   ) return 'h';
+    if ( type == "Short_t"   ) return 's';
+    if ( type == "UShort_t"  ) return 't';
+    if ( type == "Int_t"     ) return 'i';
+    if ( type == "UInt_t"    ) return 'j';
+    if ( type == "Float_t"   ) return 'f';
+    if ( type == "Long_t"    ) return 'l';
+    if ( type == "ULong_t"   ) return 'm';
+    if ( type == "Long64_t"  ) return 'x';
+    if ( type == "ULong64_t" ) return 'y';
+    if ( type == "Double_t"  ) return 'd';
+    return 0;
+  }
+
+}
+
+
+bool BulkBindingBase::Load(long entry, TBufferFile & buffer)
+{
+
+  // bulk reads start at the first entry of a basket - find basket holding entry
+  const Long64_t * basketEntry = m_branch->GetBasketEntry();
+  const int nBaskets = m_branch->GetWriteBasket();
+  const Long64_t * basket = std::upper_bound( basketEntry , basketEntry + nBaskets , static_cast<Long64_t>(entry) );
+  if ( basket == basketEntry ) return false;
+  const long first = *(basket - 1);
+
+  // decode all entries of basket (the branch is only enabled while it is read in bulk, so
+  // TTree::GetEntry() skips it)
+  m_branch->ResetBit( TBranch::kDoNotProcess );
+  const long n = m_branch->GetBulkRead().GetBulkEntries( first , buffer );
+  m_branch->SetBit( TBranch::kDoNotProcess );
+  if ( n <= 0 || entry >= first + n ) return false;
+
+  Store( buffer.GetCurrent() , n );
+  m_first = first;
+  m_n     = n;
+  ++m_nBaskets;
+
+  return true;
+
+}
+
+
+BulkReader::BulkReader(const Log::LEVEL & logLevel) :
+  m_tree(0),
+  m_prepared(false),
+  m_buffer(TBufferFile::kWrite, 32 * 1024),
+  m_nEntries(0),
+  m_nBaskets(0),
+  m_log("BulkReader")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+BulkReader::~BulkReader()
+{
+
+  Finish();
+  if ( m_nEntries > 0 ) m_log << Log::INFO << "Read " << m_nBaskets << " baskets in bulk, for " << m_nEntries << " entries" << Log::endl();
+
+}
+
+
+void BulkReader::NewInputFile(TTree * tree)
+{
+
+  Finish();
+  m_tree = tree;
+
+}
+
+
+void BulkReader::Finish()
+{
+
+  for (unsigned int i = 0; i < m_bulk.size(); ++i) m_nBaskets += m_bulk[i]->GetNBaskets();
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) delete m_bindings[i];
+  m_bindings.clear();
+  m_bulk.clear();
+  m_prepared = false;
+
+}
+
+
+void BulkReader::AddBinding(BulkBindingBase * binding)
+{
+
+  // the same branch may be connected again (e.g. by the event model and by a selector) - keep first binding
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    if ( m_bindings[i]->GetName() == binding->GetName() ) {
+      delete binding;
+      return;
+    }
+  }
+  m_bindings.push_back(binding);
+
+}
+
+
+GLOBAL::STATUS BulkReader::Prepare()
+{
+
+  m_prepared = true;
+  if ( ! m_tree ) {
+    m_log << Log::ERROR << "No input tree to read in bulk" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // choose branches, and exclude them from TTree::GetEntry()
+  std::ostringstream names;
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    BulkBindingBase & binding = *m_bindings[i];
+    TBranch * branch = m_tree->GetBranch( binding.GetName().c_str() );
+    std::string reason;
+    if ( ! branch || ! IsSupported(binding,branch,reason) ) {
+      m_log << Log::DEBUG << "Branch \"" << binding.GetName() << "\" is read entry by entry - " << reason << Log::endl();
+      continue;
+    }
+    binding.SetBranch(branch);
+    branch->SetBit( TBranch::kDoNotProcess );
+    m_bulk.push_back(&binding);
+    names << ( m_bulk.size() > 1 ? ", " : "" ) << binding.GetName();
+  }
+
+  m_log << Log::INFO << "Reading " << m_bulk.size() << " of " << m_bindings.size() << " scalar branches in bulk"
+	<< ( m_bulk.empty() ? "" : " (" + names.str() + ")" ) << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS BulkReader::Read(long entry)
+{
+
+  for (unsigned int i = 0; i < m_bulk.size(); ++i) {
+    if ( ! m_bulk[i]->Read(entry,m_buffer) ) {
+      m_log << Log::ERROR << "Couldn't read entry " << entry << " of branch \"" << m_bulk[i]->GetName() << "\" in bulk" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+  }
+  ++m_nEntries;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+const BulkBindingBase * BulkReader::GetBinding(const std::string & name) const
+{
+
+  for (unsigned int i = 0; i < m_bulk.size(); ++i) {
+    if ( m_bulk[i]->GetName() == name ) return m_bulk[i];
+  }
+
+  return 0;
+
+}
+
+
+bool BulkReader::IsSupported(const BulkBindingBase & binding, TBranch * branch, std::string & reason) const
+{
+
+  // a simple variable (vectors and objects are owned by ROOT)
+  if ( binding.GetType() == 0 ) {
+    reason = "variable is not a simple type";
+    return false;
+  }
+
+  // a single leaf holding one value per entry, of the type of the variable
+  if ( strlen(branch->GetClassName()) > 0 || branch->GetListOfLeaves()->GetEntriesFast() != 1 ) {
+    reason = "not a branch with a single leaf";
+    return false;
+  }
+  TLeaf * leaf = static_cast<TLeaf *>( branch->GetListOfLeaves()->At(0) );
+  if ( leaf->GetLeafCount() || leaf->GetLenStatic() != 1 ) {
+    reason = "leaf is an array";
+    return false;
+  }
+  if ( TypeCode( leaf->GetTypeName() ) != binding.GetType() ) {
+    reason = std::string("leaf type ") + leaf->GetTypeName() + " doesn't match type of variable";
+    return false;
+  }
+  if ( ! branch->GetBulkRead().SupportsBulkRead() ) {
+    reason = "ROOT can't read it in bulk";
+    return false;
+  }
+
+  return true;
+
+}
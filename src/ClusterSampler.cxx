@@ -0,0 +1,192 @@
+// Standard Template Library includes
+#include <sstream>
+#include <iomanip>
+#include <utility>
+#include <algorithm>
+
+// ROOT includes
+#include "TTree.h"
+#include "TDirectory.h"
+#include "TH1D.h"
+
+// Analysis includes
+#include "ClusterSampler.h"
+
+
+ClusterSampler::ClusterSampler(int prescale, double fraction, unsigned long seed, bool randomOrder, const Log::LEVEL & logLevel) :
+  m_prescale(prescale > 1 ? prescale : 1),
+  m_fraction(fraction < 1. ? fraction : 1.),
+  m_seed(seed),
+  m_randomOrder(randomOrder),
+  m_cluster(0),
+  m_entries(0),
+  m_treeEntries(0),
+  m_newCluster(false),
+  m_nClusters(0),
+  m_nClustersRead(0),
+  m_nEntries(0),
+  m_nEntriesRead(0),
+  m_log("ClusterSampler")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+GLOBAL::STATUS ClusterSampler::Select(TTree * tree, const std::string & fileName, PassBitmap & entries)
+{
+
+  if ( m_fraction <= 0. ) {
+    m_log << Log::ERROR << "sampleFraction must be positive" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  m_treeEntries = tree->GetEntries();
+  m_entries = &entries;
+  m_clusters.clear();
+  entries.Reset(m_treeEntries);
+
+  // loop over clusters of tree
+  long nClusters = 0, nEntriesSelected = 0;
+  TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+  for ( long first = clusters(); first < m_treeEntries; first = clusters(), ++nClusters ) {
+    long last = clusters.GetNextEntry();
+    if ( last > m_treeEntries || last <= first ) last = m_treeEntries;
+    if ( nClusters % m_prescale != 0 ) continue;
+    if ( m_fraction < 1. && ( Hash(fileName, first) >> 11 ) * ( 1. / 9007199254740992. ) >= m_fraction ) continue; // 53 bits to [0,1)
+    for (long entry = first; entry < last; ++entry) entries.Set(entry);
+    m_clusters.push_back( std::make_pair(first,last) );
+    nEntriesSelected += last - first;
+  }
+
+  // shuffle clusters (Fisher-Yates)
+  if ( m_randomOrder ) {
+    for (std::size_t i = m_clusters.size(); i > 1; --i) {
+      std::swap( m_clusters[i - 1] , m_clusters[ Hash(fileName, -static_cast<long>(i)) % i ] );
+    }
+  }
+
+  m_log << Log::DEBUG << "Selected " << m_clusters.size() << " of " << nClusters << " clusters (" << nEntriesSelected << " of "
+	<< m_treeEntries << " entries) of \"" << fileName << "\"" << Log::endl();
+
+  m_nClusters += nClusters;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+long ClusterSampler::FirstEntry()
+{
+
+  m_cluster = 0;
+  return m_clusters.empty() ? NextEntry(m_treeEntries) : NextEntry(m_clusters[0].first);
+
+}
+
+
+long ClusterSampler::NextEntry(long entry)
+{
+
+  m_newCluster = false;
+  while ( m_cluster < m_clusters.size() ) {
+
+    // next entry to read in current cluster
+    const std::pair<long,long> & cluster = m_clusters[m_cluster];
+    if ( entry == cluster.first ) m_newCluster = true;
+    entry = m_entries->FindNext(entry);
+    if ( entry < cluster.second ) return entry;
+
+    // cluster done, continue with next one
+    m_nEntriesRead += cluster.second - cluster.first;
+    ++m_nClustersRead;
+    if ( ++m_cluster < m_clusters.size() ) entry = m_clusters[m_cluster].first;
+
+  }
+
+  return m_treeEntries;
+
+}
+
+
+void ClusterSampler::Stop(long entry)
+{
+
+  if ( m_cluster >= m_clusters.size() ) return;
+
+  const std::pair<long,long> & cluster = m_clusters[m_cluster];
+  if ( entry > cluster.first ) m_nEntriesRead += std::min(entry,cluster.second) - cluster.first;
+  m_cluster = m_clusters.size();
+
+}
+
+
+double ClusterSampler::GetEffectiveFraction() const
+{
+
+  return m_nEntriesRead > 0 && m_nEntries > 0 ? static_cast<double>(m_nEntriesRead) / m_nEntries : 1.;
+
+}
+
+
+void ClusterSampler::Scale(TDirectory * dir) const
+{
+
+  const double fraction = GetEffectiveFraction();
+  if ( fraction == 1. ) return;
+
+  TIter next( dir->GetList() );
+  while ( TObject * object = next() ) {
+    if ( TH1 * hist = dynamic_cast<TH1 *>(object) ) hist->Scale( 1. / fraction );
+  }
+
+}
+
+
+void ClusterSampler::Annotate(TDirectory * dir) const
+{
+
+  TDirectory * current = TDirectory::CurrentDirectory();
+  dir->cd();
+  TH1D * hist = new TH1D( "sampling" , "entries read (bin 1) and entries of input (bin 2)" , 2 , 0. , 2. );
+  hist->SetBinContent( 1 , m_nEntriesRead );
+  hist->SetBinContent( 2 , m_nEntries );
+  if ( current ) current->cd();
+
+}
+
+
+void ClusterSampler::Report(double duration) const
+{
+
+  const double fraction = GetEffectiveFraction();
+  std::ostringstream summary;
+  summary << std::fixed << std::setprecision(4) << fraction << " (speedup " << std::setprecision(1) << 1. / fraction
+	  << "x, event loop " << std::setprecision(0) << duration << " sec, estimated " << duration / fraction << " sec for all entries)";
+
+  m_log << Log::INFO << "Read " << m_nClustersRead << " of " << m_nClusters << " clusters of the files opened, and " << m_nEntriesRead << " of "
+	<< m_nEntries << " entries of the input" << Log::endl();
+  m_log << Log::INFO << "Fraction of entries read : " << summary.str() << Log::endl();
+  if ( fraction < 1. ) m_log << Log::INFO << "Histograms are scaled by 1/" << fraction << " to the full input" << Log::endl();
+
+}
+
+
+unsigned long long ClusterSampler::Hash(const std::string & fileName, long firstEntry) const
+{
+
+  // hash of seed, file name and cluster (FNV-1a), mixed with splitmix64 finaliser
+  unsigned long long x = 14695981039346656037ULL ^ m_seed;
+  for (unsigned int i = 0; i < fileName.size(); ++i) {
+    x ^= static_cast<unsigned char>(fileName[i]);
+    x *= 1099511628211ULL;
+  }
+  x += 0x9e3779b97f4a7c15ULL * ( static_cast<unsigned long long>(firstEntry) + 1 );
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebULL;
+
+  return x ^ ( x >> 31 );
+
+}
@@ -0,0 +1,257 @@
+// Standard Template Library includes
+#include <cstdio>
+#include <cerrno>
+#include <sstream>
+#include <algorithm>
+
+// ROOT includes
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+// Analysis includes
+#include "ColumnCache.h"
+#include "ColumnBinding.h"
+#include "ViewBase.h"
+#include "Identity.h"
+
+
+ColumnCache::ColumnCache(const std::string & directory, const Log::LEVEL & logLevel) :
+  m_directory(directory),
+  m_tree(0),
+  m_entries(0),
+  m_prepared(false),
+  m_mode(OFF),
+  m_writer(logLevel),
+  m_log("ColumnCache")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+  // create cache directory
+  if ( mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST ) {
+    m_log << Log::WARNING << "Couldn't create directory \"" << m_directory << "\"" << Log::endl();
+  }
+
+}
+
+
+ColumnCache::~ColumnCache()
+{
+
+  Finish();
+
+}
+
+
+GLOBAL::STATUS ColumnCache::NewInputFile(TTree * tree, const std::string & fileName)
+{
+
+  GLOBAL::STATUS status = Finish();
+
+  m_tree     = tree;
+  m_fileName = fileName;
+  m_entries  = tree ? tree->GetEntries() : 0;
+
+  return status;
+
+}
+
+
+void ColumnCache::AddBinding(ColumnBindingBase * binding)
+{
+
+  m_bindings.push_back(binding);
+
+}
+
+
+GLOBAL::STATUS ColumnCache::Prepare()
+{
+
+  m_prepared = true;
+  m_mode     = OFF;
+
+  if ( ! m_tree || m_bindings.empty() ) return GLOBAL::SUCCESS;
+
+  // check that all connected variables can be cached
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    const ColumnBindingBase * binding = m_bindings.at(i);
+    TBranch * branch = m_tree->GetBranch(binding->GetName().c_str());
+    TLeaf * leaf = branch ? branch->GetLeaf(binding->GetName().c_str()) : 0;
+    bool isArray = ! binding->IsVector() && ( ! leaf || leaf->GetLeafCount() || leaf->GetLenStatic() > 1 );
+    if ( binding->GetType() == 0 || isArray ) {
+      m_log << Log::WARNING << "Variable \"" << binding->GetName() << "\" has a type that can't be cached - reading \"" 
+	    << m_fileName << "\" from input tree" << Log::endl();
+      return GLOBAL::SUCCESS;
+    }
+  }
+
+  // the cache file is identified by input file and set of variables
+  const std::string identity = Identity();
+  if ( identity.empty() ) {
+    m_log << Log::WARNING << "Couldn't determine identity of \"" << m_fileName << "\" - reading it from input tree" << Log::endl();
+    return GLOBAL::SUCCESS;
+  }
+  m_cacheName = m_directory + "/" + m_fileName.substr(m_fileName.find_last_of('/') + 1) + "." + IDENTITY::Hash(identity) + ".amcol";
+
+  // try to read existing cache
+  if ( m_reader.Open(m_cacheName) ) {
+    bool valid = m_reader.GetMetadata("identity") == identity && m_reader.GetEntries() == static_cast<uint64_t>(m_entries);
+    for (unsigned int i = 0; valid && i < m_bindings.size(); ++i) {
+      ColumnBindingBase * binding = m_bindings.at(i);
+      int column = m_reader.FindColumn(binding->GetName());
+      valid = column >= 0 && m_reader.GetColumn(column).type == binding->GetType() && m_reader.GetColumn(column).isVector == binding->IsVector();
+      binding->SetColumn(column);
+      if ( valid && binding->IsVector() ) m_vectorColumns[binding->GetName()] = column;
+    }
+    if ( valid ) {
+      m_mode = READ;
+      m_log << Log::INFO << "Reading \"" << m_fileName << "\" from column cache \"" << m_cacheName << "\"" << Log::endl();
+      return GLOBAL::SUCCESS;
+    }
+    m_log << Log::WARNING << "Column cache \"" << m_cacheName << "\" doesn't match input file - re-writing it" << Log::endl();
+    m_reader.Close();
+    m_vectorColumns.clear();
+  }
+
+  // write new cache
+  if ( m_writer.Open(m_cacheName + ".tmp") != GLOBAL::SUCCESS ) {
+    m_log << Log::WARNING << "Couldn't write column cache for \"" << m_fileName << "\" - reading it from input tree" << Log::endl();
+    return GLOBAL::SUCCESS;
+  }
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    ColumnBindingBase * binding = m_bindings.at(i);
+    binding->SetColumn( m_writer.AddColumn(binding->GetName(), binding->GetType(), binding->IsVector()) );
+  }
+  m_writer.SetMetadata("identity", identity);
+  m_mode = WRITE;
+  m_log << Log::INFO << "Writing column cache \"" << m_cacheName << "\" for \"" << m_fileName << "\"" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ColumnCache::Read(long entry)
+{
+
+  if ( entry < 0 || entry >= m_entries ) {
+    m_log << Log::ERROR << "Entry " << entry << " is out of range in column cache \"" << m_cacheName << "\"" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    if ( ! m_bindings[i]->IsSkipRead() ) m_bindings[i]->Read(m_reader, entry);
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ColumnCache::Write(long entry)
+{
+
+  // the cache can only be written for entries read in order
+  if ( static_cast<uint64_t>(entry) != m_writer.GetEntries() ) {
+    m_log << Log::WARNING << "Entries are not read in order - column cache for \"" << m_fileName << "\" will not be written" << Log::endl();
+    m_writer.Close();
+    std::remove( (m_cacheName + ".tmp").c_str() );
+    m_mode = OFF;
+    return GLOBAL::SUCCESS;
+  }
+
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) m_bindings[i]->Write(m_writer);
+
+  return m_writer.Fill();
+
+}
+
+
+bool ColumnCache::MapView(const std::string & name, long entry, ViewBase * view) const
+{
+
+  std::map<std::string,int>::const_iterator iter = m_vectorColumns.find(name);
+  if ( iter == m_vectorColumns.end() ) return false;
+
+  size_t n = 0;
+  const void * values = m_reader.GetValues(iter->second, entry, n);
+
+  return view->Map(m_reader.GetColumn(iter->second).type, values, n);
+
+}
+
+
+void ColumnCache::SkipRead(const std::string & name)
+{
+
+  if ( m_mode != READ || m_vectorColumns.find(name) == m_vectorColumns.end() ) return;
+
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    if ( m_bindings[i]->GetName() == name ) m_bindings[i]->SkipRead();
+  }
+  m_log << Log::DEBUG << "Variable \"" << name << "\" is only read through views - not copied from column cache" << Log::endl();
+
+}
+
+
+GLOBAL::STATUS ColumnCache::Finish()
+{
+
+  GLOBAL::STATUS status = GLOBAL::SUCCESS;
+
+  // commit cache file if all entries were written (otherwise discard it)
+  if ( m_mode == WRITE ) {
+    const std::string tmpName = m_cacheName + ".tmp";
+    const bool complete = m_writer.GetEntries() == static_cast<uint64_t>(m_entries);
+    if ( m_writer.Close() == GLOBAL::SUCCESS && complete && std::rename(tmpName.c_str(), m_cacheName.c_str()) == 0 ) {
+      m_log << Log::INFO << "Wrote column cache \"" << m_cacheName << "\"" << Log::endl();
+    }
+    else {
+      if ( complete ) {
+	m_log << Log::ERROR << "Couldn't write column cache \"" << m_cacheName << "\"" << Log::endl();
+	status = GLOBAL::ERROR;
+      }
+      else m_log << Log::INFO << "Not all entries were read - discarding column cache for \"" << m_fileName << "\"" << Log::endl();
+      std::remove(tmpName.c_str());
+    }
+  }
+  m_reader.Close();
+  m_vectorColumns.clear();
+
+  // forget connected variables
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) delete m_bindings[i];
+  m_bindings.clear();
+
+  m_mode     = OFF;
+  m_prepared = false;
+  m_tree     = 0;
+
+  return status;
+
+}
+
+
+std::string ColumnCache::Identity() const
+{
+
+  const std::string file = IDENTITY::File(m_fileName);
+  if ( file.empty() ) return "";
+
+  // sort variables, so the identity doesn't depend on the order they were connected in
+  std::vector<std::string> variables;
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    const ColumnBindingBase * binding = m_bindings.at(i);
+    variables.push_back( binding->GetName() + ":" + binding->GetType() + (binding->IsVector() ? "[]" : "") );
+  }
+  std::sort(variables.begin(), variables.end());
+
+  std::ostringstream identity;
+  identity << file << "tree=" << m_tree->GetName() << ";entries=" << m_entries << ";variables=";
+  for (unsigned int i = 0; i < variables.size(); ++i) identity << (i ? "," : "") << variables[i];
+
+  return identity.str();
+
+}
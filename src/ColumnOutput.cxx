@@ -0,0 +1,106 @@
+// Analysis includes
+#include "ColumnOutput.h"
+#include "ColumnBinding.h"
+
+
+ColumnOutput::ColumnOutput(const std::string & fileName, const std::string & treeName, const Log::LEVEL & logLevel) :
+  m_fileName(fileName),
+  m_treeName(treeName),
+  m_open(false),
+  m_closed(false),
+  m_writer(logLevel),
+  m_log("ColumnOutput")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+ColumnOutput::~ColumnOutput()
+{
+
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) delete m_bindings[i];
+  m_bindings.clear();
+
+}
+
+
+void ColumnOutput::AddBinding(ColumnBindingBase * binding)
+{
+
+  // variables in the input tree move to new memory for every input file - replace binding, keep column
+  std::map<std::string,unsigned int>::iterator iter = m_index.find(binding->GetName());
+  if ( iter != m_index.end() ) {
+    binding->SetColumn( m_bindings[iter->second]->GetColumn() );
+    delete m_bindings[iter->second];
+    m_bindings[iter->second] = binding;
+    return;
+  }
+
+  if ( m_open ) {
+    m_log << Log::ERROR << "Variable \"" << binding->GetName() << "\" declared after first entry was written - it will not be written to \"" 
+	  << m_fileName << "\"" << Log::endl();
+    delete binding;
+    return;
+  }
+
+  m_index[binding->GetName()] = m_bindings.size();
+  m_bindings.push_back(binding);
+
+}
+
+
+GLOBAL::STATUS ColumnOutput::Open()
+{
+
+  if ( m_writer.Open(m_fileName) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  m_writer.SetMetadata("tree", m_treeName);
+
+  // declare columns (variables of unsupported types are skipped)
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    ColumnBindingBase * binding = m_bindings[i];
+    binding->SetColumn( m_writer.AddColumn(binding->GetName(), binding->GetType(), binding->IsVector()) );
+    if ( binding->GetColumn() < 0 ) {
+      m_log << Log::WARNING << "Variable \"" << binding->GetName() << "\" has a type that can't be written to \"" << m_fileName << "\"" << Log::endl();
+    }
+  }
+  m_open = true;
+
+  m_log << Log::INFO << "Writing " << m_bindings.size() << " variables to \"" << m_fileName << "\"" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ColumnOutput::Fill()
+{
+
+  if ( ! m_open && Open() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  for (unsigned int i = 0; i < m_bindings.size(); ++i) {
+    if ( m_bindings[i]->GetColumn() >= 0 ) m_bindings[i]->Write(m_writer);
+  }
+
+  return m_writer.Fill();
+
+}
+
+
+GLOBAL::STATUS ColumnOutput::Close()
+{
+
+  if ( m_closed ) return GLOBAL::SUCCESS;
+  m_closed = true;
+
+  // write file even if no entries were filled
+  if ( ! m_open && Open() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  if ( m_writer.Close() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  m_log << Log::INFO << "Wrote " << m_writer.GetEntries() << " entries to \"" << m_fileName << "\"" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
@@ -0,0 +1,251 @@
+// Standard Template Library includes
+#include <cstring>
+
+// Analysis includes
+#include "ColumnWriter.h"
+#include "ColumnFormat.h"
+
+
+ColumnWriter::ColumnWriter(const Log::LEVEL & logLevel, unsigned long chunkSize) :
+  m_file(0),
+  m_position(0),
+  m_entries(0),
+  m_chunkEntries(0),
+  m_chunkSize(chunkSize > 0 ? chunkSize : 1),
+  m_log("ColumnWriter")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+ColumnWriter::~ColumnWriter()
+{
+
+  if ( m_file ) std::fclose(m_file);
+
+}
+
+
+GLOBAL::STATUS ColumnWriter::Open(const std::string & fileName)
+{
+
+  if ( m_file ) {
+    m_log << Log::ERROR << "File \"" << m_fileName << "\" is already open!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // the format is little-endian, and values are written in host byte order
+  const uint16_t one = 1;
+  if ( *reinterpret_cast<const char *>(&one) != 1 ) {
+    m_log << Log::ERROR << "Columnar files can only be written on little-endian hosts!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  m_file = std::fopen(fileName.c_str(), "wb");
+  if ( ! m_file ) {
+    m_log << Log::ERROR << "Couldn't open file \"" << fileName << "\"" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  m_fileName     = fileName;
+  m_position     = 0;
+  m_entries      = 0;
+  m_chunkEntries = 0;
+  m_chunks.clear();
+
+  // write header
+  uint64_t offset = 0;
+  const uint32_t version  = COLUMNFORMAT::VERSION;
+  const uint32_t reserved = 0;
+  if ( ! ( WriteBytes(COLUMNFORMAT::MAGIC, 8, false, offset) &&
+	   WriteBytes(&version, sizeof(version), false, offset) &&
+	   WriteBytes(&reserved, sizeof(reserved), false, offset) ) ) return GLOBAL::ERROR;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+int ColumnWriter::AddColumn(const std::string & name, char type, bool isVector)
+{
+
+  if ( m_entries > 0 || m_chunkEntries > 0 ) {
+    m_log << Log::ERROR << "Can't add column \"" << name << "\" after entries have been filled!" << Log::endl();
+    return -1;
+  }
+
+  if ( COLUMNFORMAT::ElementSize(type) == 0 ) {
+    m_log << Log::WARNING << "Column \"" << name << "\" has unsupported type \"" << type << "\"" << Log::endl();
+    return -1;
+  }
+
+  ColumnBuffer column;
+  column.name     = name;
+  column.type     = type;
+  column.isVector = isVector;
+  column.size     = COLUMNFORMAT::ElementSize(type);
+  if ( isVector ) column.offsets.push_back(0);
+  m_columns.push_back(column);
+
+  m_log << Log::DEBUG << "Added " << (isVector ? "vector" : "scalar") << " column \"" << name << "\" with type \"" << type << "\"" << Log::endl();
+
+  return m_columns.size() - 1;
+
+}
+
+
+void ColumnWriter::Write(unsigned int column, const void * data, size_t n)
+{
+
+  ColumnBuffer & buffer = m_columns[column];
+  const char * bytes = static_cast<const char *>(data);
+
+  // scalar columns hold exactly one value per entry - overwrite if already set
+  if ( ! buffer.isVector ) {
+    buffer.values.resize(m_chunkEntries * buffer.size);
+    n = 1;
+  }
+
+  buffer.values.insert(buffer.values.end(), bytes, bytes + n*buffer.size);
+
+}
+
+
+GLOBAL::STATUS ColumnWriter::Fill()
+{
+
+  // close entry in all columns
+  for (unsigned int i = 0; i < m_columns.size(); ++i) {
+    ColumnBuffer & buffer = m_columns[i];
+    if ( buffer.isVector ) buffer.offsets.push_back(buffer.values.size() / buffer.size);
+    else buffer.values.resize((m_chunkEntries + 1) * buffer.size, 0);
+  }
+  ++m_chunkEntries;
+
+  // write chunk when full
+  if ( m_chunkEntries >= m_chunkSize ) return FlushChunk();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ColumnWriter::FlushChunk()
+{
+
+  if ( m_chunkEntries == 0 ) return GLOBAL::SUCCESS;
+
+  ChunkInfo chunk;
+  chunk.firstEntry = m_entries;
+  chunk.nEntries   = m_chunkEntries;
+  chunk.valuesOffset.resize(m_columns.size(), 0);
+  chunk.offsetsOffset.resize(m_columns.size(), 0);
+
+  for (unsigned int i = 0; i < m_columns.size(); ++i) {
+    ColumnBuffer & buffer = m_columns[i];
+    if ( buffer.isVector ) {
+      if ( ! WriteBytes(buffer.offsets.data(), buffer.offsets.size()*sizeof(uint64_t), true, chunk.offsetsOffset[i]) ) return GLOBAL::ERROR;
+      buffer.offsets.resize(1);
+    }
+    if ( ! WriteBytes(buffer.values.data(), buffer.values.size(), true, chunk.valuesOffset[i]) ) return GLOBAL::ERROR;
+    buffer.values.clear();
+  }
+
+  m_chunks.push_back(chunk);
+  m_entries += m_chunkEntries;
+  m_chunkEntries = 0;
+
+  m_log << Log::DEBUG << "Wrote chunk " << m_chunks.size() << " with " << chunk.nEntries << " entries to \"" << m_fileName << "\"" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ColumnWriter::Close()
+{
+
+  if ( ! m_file ) {
+    m_log << Log::ERROR << "No file open!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // write remaining entries
+  if ( FlushChunk() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  // write footer
+  bool ok = true;
+  uint64_t footerOffset = 0, offset = 0;
+  const uint32_t nColumns = m_columns.size();
+  ok = ok && WriteBytes(&nColumns, sizeof(nColumns), true, footerOffset);
+  for (unsigned int i = 0; ok && i < m_columns.size(); ++i) {
+    const uint32_t length   = m_columns[i].name.size();
+    const uint8_t  isVector = m_columns[i].isVector;
+    const uint16_t reserved = 0;
+    ok = WriteBytes(&length, sizeof(length), false, offset) && WriteBytes(m_columns[i].name.data(), length, false, offset) &&
+      WriteBytes(&m_columns[i].type, 1, false, offset) && WriteBytes(&isVector, 1, false, offset) && WriteBytes(&reserved, 2, false, offset);
+  }
+
+  const uint32_t nMetadata = m_metadata.size();
+  ok = ok && WriteBytes(&nMetadata, sizeof(nMetadata), false, offset);
+  std::map<std::string,std::string>::const_iterator iter = m_metadata.begin();
+  for ( ; ok && iter != m_metadata.end(); ++iter) {
+    const uint32_t keyLength   = iter->first.size();
+    const uint32_t valueLength = iter->second.size();
+    ok = WriteBytes(&keyLength, sizeof(keyLength), false, offset) && WriteBytes(iter->first.data(), keyLength, false, offset) &&
+      WriteBytes(&valueLength, sizeof(valueLength), false, offset) && WriteBytes(iter->second.data(), valueLength, false, offset);
+  }
+
+  const uint32_t nChunks = m_chunks.size();
+  ok = ok && WriteBytes(&nChunks, sizeof(nChunks), false, offset);
+  for (unsigned int i = 0; ok && i < m_chunks.size(); ++i) {
+    ok = WriteBytes(&m_chunks[i].firstEntry, sizeof(uint64_t), false, offset) && WriteBytes(&m_chunks[i].nEntries, sizeof(uint64_t), false, offset);
+    for (unsigned int col = 0; ok && col < m_columns.size(); ++col) {
+      ok = WriteBytes(&m_chunks[i].valuesOffset[col], sizeof(uint64_t), false, offset) && WriteBytes(&m_chunks[i].offsetsOffset[col], sizeof(uint64_t), false, offset);
+    }
+  }
+
+  // write trailer
+  ok = ok && WriteBytes(&footerOffset, sizeof(footerOffset), false, offset) && WriteBytes(COLUMNFORMAT::TRAILER, 8, false, offset);
+
+  ok = ( std::fclose(m_file) == 0 ) && ok;
+  m_file = 0;
+
+  if ( ! ok ) {
+    m_log << Log::ERROR << "Couldn't write footer to \"" << m_fileName << "\"" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  m_log << Log::DEBUG << "Closed \"" << m_fileName << "\" with " << m_entries << " entries in " << m_chunks.size() << " chunks" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+bool ColumnWriter::WriteBytes(const void * data, size_t size, bool align, uint64_t & offset)
+{
+
+  // pad to alignment
+  if ( align ) {
+    static const char zeros[COLUMNFORMAT::ALIGNMENT] = { 0 };
+    const size_t padding = COLUMNFORMAT::Padding(m_position);
+    if ( padding > 0 && std::fwrite(zeros, 1, padding, m_file) != padding ) {
+      m_log << Log::ERROR << "Couldn't write to \"" << m_fileName << "\"" << Log::endl();
+      return false;
+    }
+    m_position += padding;
+  }
+
+  offset = m_position;
+  if ( size > 0 && std::fwrite(data, 1, size, m_file) != size ) {
+    m_log << Log::ERROR << "Couldn't write to \"" << m_fileName << "\"" << Log::endl();
+    return false;
+  }
+  m_position += size;
+
+  return true;
+
+}
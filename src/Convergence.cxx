@@ -0,0 +1,76 @@
+// Standard Template Library includes
+#include <cmath>
+
+// ROOT includes
+#include "TH1.h"
+
+// Analysis includes
+#include "Convergence.h"
+#include "MultiHist.h"
+
+
+Convergence::Convergence(const Log::LEVEL & logLevel) :
+  m_log("Convergence")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+void Convergence::Add(const std::string & name, const TH1 * hist, double target, int bin)
+{
+
+  Criterion criterion;
+  criterion.name     = bin < 0 ? name : name + " (bin " + std::to_string(bin) + ")";
+  criterion.target   = target;
+  criterion.evaluate = [hist,bin](double & value, double & error2) {
+    double error = 0.;
+    if ( bin < 0 ) value = hist->IntegralAndError( 1 , hist->GetNbinsX() , error );
+    else {
+      value = hist->GetBinContent(bin);
+      error = hist->GetBinError(bin);
+    }
+    error2 = error * error;
+  };
+  m_criteria.push_back(criterion);
+
+}
+
+
+void Convergence::Add(const std::string & name, const MultiHist * hist, double target, int bin, unsigned int variation)
+{
+
+  Criterion criterion;
+  criterion.name     = bin < 0 ? name : name + " (bin " + std::to_string(bin) + ")";
+  criterion.target   = target;
+  criterion.evaluate = [hist,bin,variation](double & value, double & error2) {
+    const unsigned int first = bin < 0 ? 1 : bin;
+    const unsigned int last  = bin < 0 ? hist->GetNBins() : bin;
+    value = error2 = 0.;
+    for (unsigned int b = first; b <= last; ++b) {
+      value  += hist->GetBinContent(b,variation);
+      error2 += hist->GetBinSumw2(b,variation);
+    }
+  };
+  m_criteria.push_back(criterion);
+
+}
+
+
+bool Convergence::IsMet() const
+{
+
+  bool met = ! m_criteria.empty();
+  for (unsigned int i = 0; i < m_criteria.size(); ++i) {
+    double value = 0., error2 = 0.;
+    m_criteria[i].evaluate(value,error2);
+    const double relative = value != 0. ? std::sqrt(error2) / std::fabs(value) : 1.;
+    m_log << Log::DEBUG << "Relative error of \"" << m_criteria[i].name << "\" is " << relative << " (target " << m_criteria[i].target << ")" << Log::endl();
+    if ( value == 0. || relative > m_criteria[i].target ) met = false;
+  }
+
+  return met;
+
+}
@@ -0,0 +1,90 @@
+// Standard Template Library includes
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <stdint.h>
+
+// Analysis includes
+#include "ColumnReader.h"
+
+
+// Standalone reader for columnar files (see ColumnFormat.h) - only depends on ColumnReader.h.
+// Prints the file layout, and the values of the first entries.
+
+
+template <class T>
+void PrintValues(const ColumnReader & reader, unsigned int column, uint64_t entry)
+{
+
+  size_t n = 0;
+  const T * values = reader.Get<T>(column, entry, n);
+  if ( reader.GetColumn(column).isVector ) std::cout << "[";
+  for (size_t i = 0; i < n; ++i) std::cout << (i ? " " : "") << +values[i];
+  if ( reader.GetColumn(column).isVector ) std::cout << "]";
+
+}
+
+
+void PrintValues(const ColumnReader & reader, unsigned int column, uint64_t entry)
+{
+
+  switch ( reader.GetColumn(column).type ) {
+  case 'b': PrintValues<bool>              (reader,column,entry); break;
+  case 'c': PrintValues<char>              (reader,column,entry); break;
+  case 'h': PrintValues<unsigned char>     (reader,column,entry); break;
+  case 's': PrintValues<short>             (reader,column,entry); break;
+  case 't': PrintValues<unsigned short>    (reader,column,entry); break;
+  case 'i': PrintValues<int>               (reader,column,entry); break;
+  case 'j': PrintValues<unsigned int>      (reader,column,entry); break;
+  case 'f': PrintValues<float>             (reader,column,entry); break;
+  case 'l': PrintValues<long>              (reader,column,entry); break;
+  case 'm': PrintValues<unsigned long>     (reader,column,entry); break;
+  case 'x': PrintValues<long long>         (reader,column,entry); break;
+  case 'y': PrintValues<unsigned long long>(reader,column,entry); break;
+  case 'd': PrintValues<double>            (reader,column,entry); break;
+  }
+
+}
+
+
+int main(int argc, char** argv) 
+{
+
+  if ( argc < 2 || argc > 3 ) {
+    std::cout << "Usage :" << std::endl;
+    std::cout << "   bin/DumpColumnar file.amcol [nEntries]" << std::endl;
+    return 1;
+  }
+
+  ColumnReader reader;
+  if ( ! reader.Open(argv[1]) ) {
+    std::cerr << reader.GetError() << std::endl;
+    return 1;
+  }
+  const uint64_t nPrint = argc == 3 ? std::strtoul(argv[2],0,10) : 10;
+
+  // layout
+  std::cout << "File     : " << argv[1] << std::endl;
+  std::cout << "Entries  : " << reader.GetEntries() << std::endl;
+  std::cout << "Chunks   : " << reader.GetNChunks() << std::endl;
+  std::map<std::string,std::string>::const_iterator iter = reader.GetMetadata().begin();
+  for ( ; iter != reader.GetMetadata().end(); ++iter) std::cout << "Metadata : " << iter->first << " = " << iter->second << std::endl;
+  for (unsigned int col = 0; col < reader.GetNColumns(); ++col) {
+    const ColumnReader::Column & column = reader.GetColumn(col);
+    std::cout << "Column   : " << std::setw(30) << std::left << column.name << " type = " << column.type << (column.isVector ? "[]" : "") << std::endl;
+  }
+
+  // values
+  for (uint64_t entry = 0; entry < reader.GetEntries() && entry < nPrint; ++entry) {
+    std::cout << "Entry " << entry << std::endl;
+    for (unsigned int col = 0; col < reader.GetNColumns(); ++col) {
+      std::cout << "   " << std::setw(30) << std::left << reader.GetColumn(col).name << " = ";
+      PrintValues(reader, col, entry);
+      std::cout << std::endl;
+    }
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,82 @@
+// Standard Template Library includes
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstring>
+
+// ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+
+// Prints the schema of an input tree in the format of cards/eventSchema, from which the typed
+// event model inc/Event.h is generated (see Service::GetEvent()).
+
+
+// C++ name of ROOT type
+std::string TypeName(const std::string & type)
+{
+
+  if ( type == "Bool_t"    ) return "bool";
+  if ( type == "Char_t"    ) return "char";
+  if ( type == "UChar_t"   ) return "unsigned char";
+  if ( type == "Short_t"   ) return "short";
+  if ( type == "UShort_t"  ) return "unsigned short";
+  if ( type == "Int_t"     ) return "int";
+  if ( type == "UInt_t"    ) return "unsigned int";
+  if ( type == "Float_t"   ) return "float";
+  if ( type == "Double_t"  ) return "double";
+  if ( type == "Long_t"    ) return "long";
+  if ( type == "ULong_t"   ) return "unsigned long";
+  if ( type == "Long64_t"  ) return "long long";
+  if ( type == "ULong64_t" ) return "unsigned long long";
+
+  return type;
+
+}
+
+
+int main(int argc, char** argv) 
+{
+
+  if ( argc < 2 || argc > 3 ) {
+    std::cout << "Usage :" << std::endl;
+    std::cout << "   bin/DumpSchema file.root [treeName] > cards/eventSchema" << std::endl;
+    return 1;
+  }
+
+  const std::string treeName = argc == 3 ? argv[2] : "tree";
+  TFile * file = TFile::Open(argv[1]);
+  TTree * tree = file ? static_cast<TTree *>( file->Get( treeName.c_str() ) ) : 0;
+  if ( ! tree ) {
+    std::cerr << "Couldn't get tree \"" << treeName << "\" in file \"" << argv[1] << "\"" << std::endl;
+    return 1;
+  }
+
+  std::cout << "# Schema of tree \"" << treeName << "\" in file \"" << argv[1] << "\"" << std::endl;
+
+  // top-level branches - scalars and objects (e.g. vectors) become members of the event
+  TObjArray * branches = tree->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+    TBranch * branch = static_cast<TBranch *>( branches->At(i) );
+    std::string type = branch->GetClassName();
+    if ( type.empty() ) {
+      TLeaf * leaf = branch->GetListOfLeaves()->GetEntriesFast() == 1 ? static_cast<TLeaf *>( branch->GetListOfLeaves()->At(0) ) : 0;
+      if ( ! leaf || leaf->GetLeafCount() || leaf->GetLenStatic() > 1 ) {
+	std::cout << "# skipped " << branch->GetName() << " (array or multi-leaf branch - use a read-only view)" << std::endl;
+	continue;
+      }
+      type = TypeName( leaf->GetTypeName() );
+    }
+    std::cout << std::setw(30) << std::left << type << " " << branch->GetName() << std::endl;
+  }
+
+  file->Close();
+  delete file;
+
+  return 0;
+
+}
@@ -0,0 +1,711 @@
+// Standard Template Library includes
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+// ROOT includes
+#include "TROOT.h"
+#include "TFile.h"
+#include "TMemFile.h"
+#include "TTree.h"
+#include "TList.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+// Analysis includes
+#include "EventPipeline.h"
+#include "SlotBinding.h"
+#include "ColumnOutput.h"
+#include "AllocationProfiler.h"
+#include "Tracer.h"
+#include "ThreadPlacement.h"
+
+
+namespace {
+
+  // wall-clock time in seconds
+  double Now()
+  {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+  }
+
+}
+
+
+EventPipeline::EventPipeline(unsigned int depth, unsigned int batchSize, const Log::LEVEL & logLevel) :
+  m_depth(depth > 0 ? depth : 1),
+  m_batchSize(batchSize > 0 ? batchSize : 1),
+  m_cacheSize(0),
+  m_prepared(false),
+  m_running(false),
+  m_file(0),
+  m_tree(0),
+  m_entries(0),
+  m_entryList(0),
+  m_readerDone(false),
+  m_readerError(false),
+  m_abort(false),
+  m_nWriters(1),
+  m_blockSize(10000),
+  m_blockBatches(1),
+  m_keepOrder(true),
+  m_parallel(false),
+  m_finishing(false),
+  m_writerError(false),
+  m_inFree(m_depth),
+  m_inFull(m_depth),
+  m_nextEntry(0),
+  m_inBatch(-1),
+  m_inPos(0),
+  m_outBatch(-1),
+  m_outWriter(0),
+  m_outBlockBatches(0),
+  m_hasEntry(false),
+  m_startTime(0.),
+  m_log("EventPipeline")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+  // reader and writer threads use ROOT next to the main thread
+  ROOT::EnableThreadSafety();
+
+  m_writers.push_back( new Writer(m_depth) );
+  for (unsigned int i = 0; i < 4; ++i) {
+    m_stages[i].busy       = 0.;
+    m_stages[i].waitInput  = 0.;
+    m_stages[i].waitOutput = 0.;
+    m_stages[i].batches    = 0;
+    m_stages[i].occupancy  = 0.;
+  }
+
+}
+
+
+EventPipeline::~EventPipeline()
+{
+
+  Stop();
+
+  for (unsigned int i = 0; i < m_inputs.size(); ++i) delete m_inputs[i];
+  for (unsigned int chain = 0; chain < m_outputs.size(); ++chain) {
+    for (unsigned int i = 0; i < m_outputs[chain].bindings.size(); ++i) delete m_outputs[chain].bindings[i];
+  }
+  for (unsigned int i = 0; i < m_writers.size(); ++i) delete m_writers[i];
+
+}
+
+
+void EventPipeline::SetWriters(unsigned int nWriters, unsigned int blockSize, bool keepOrder)
+{
+
+  if ( m_running || ! m_outputs.empty() ) {
+    m_log << Log::ERROR << "Writers must be set before output variables are declared" << Log::endl();
+    return;
+  }
+  for (unsigned int i = 0; i < m_writers.size(); ++i) delete m_writers[i];
+  m_writers.clear();
+  for (unsigned int i = 0; i < std::max(nWriters,1u); ++i) m_writers.push_back( new Writer(m_depth) );
+  m_blockSize = blockSize > 0 ? blockSize : 1;
+  m_keepOrder = keepOrder;
+
+}
+
+
+void EventPipeline::AddInput(SlotBindingBase * binding)
+{
+
+  if ( m_running ) {
+    m_log << Log::ERROR << "Variable \"" << binding->GetName() << "\" connected while the pipeline is running - it will not be read!" << Log::endl();
+    delete binding;
+    return;
+  }
+  m_inputs.push_back(binding);
+
+}
+
+
+void EventPipeline::AddOutput(unsigned int chain, SlotBindingBase * binding)
+{
+
+  if ( m_running ) {
+    m_log << Log::ERROR << "Variable \"" << binding->GetName() << "\" declared while the pipeline is running - it will not be written!" << Log::endl();
+    delete binding;
+    return;
+  }
+  binding->SetNBacks(m_writers.size());
+  if ( chain >= m_outputs.size() ) {
+    Output output;
+    output.tree    = 0;
+    output.columns = 0;
+    m_outputs.resize(chain + 1, output);
+  }
+
+  // replace variable with same name (re-bound to new memory)
+  Output & output = m_outputs[chain];
+  std::map<std::string,unsigned int>::iterator iter = output.index.find(binding->GetName());
+  if ( iter != output.index.end() ) {
+    delete output.bindings[iter->second];
+    output.bindings[iter->second] = binding;
+    return;
+  }
+  output.index[binding->GetName()] = output.bindings.size();
+  output.bindings.push_back(binding);
+
+}
+
+
+GLOBAL::STATUS EventPipeline::Start(TTree * inTree, const std::string & fileName,
+				    const std::vector<TTree *> & outTrees, const std::vector<ColumnOutput *> & columnOutputs,
+				    const PassBitmap * entryList)
+{
+
+  m_prepared = true;
+
+  // check that all connected variables can be copied to slots
+  for (unsigned int i = 0; i < m_inputs.size(); ++i) {
+    const std::string & name = m_inputs[i]->GetName();
+    TBranch * branch = inTree->GetBranch(name.c_str());
+    TLeaf * leaf = branch ? branch->GetLeaf(name.c_str()) : 0;
+    bool isObject = branch && std::strlen(branch->GetClassName()) > 0;
+    if ( ! isObject && ( ! leaf || leaf->GetLeafCount() || leaf->GetLenStatic() > 1 ) ) {
+      m_log << Log::WARNING << "Variable \"" << name << "\" can't be copied between threads - reading \""
+	    << fileName << "\" without pipeline" << Log::endl();
+      return GLOBAL::SUCCESS;
+    }
+  }
+
+  // reader has its own copy of the input tree, connected to the back of the variables
+  m_file = new TFile(fileName.c_str(),"read");
+  m_tree = m_file->IsOpen() ? static_cast<TTree *>( m_file->Get(inTree->GetName()) ) : 0;
+  if ( ! m_tree ) {
+    m_log << Log::ERROR << "Couldn't open tree \"" << inTree->GetName() << "\" in file \"" << fileName << "\" for reader thread" << Log::endl();
+    delete m_file;
+    m_file = 0;
+    return GLOBAL::ERROR;
+  }
+  m_tree->SetBranchStatus("*",0);
+  if ( m_cacheSize > 0 ) m_tree->SetCacheSize(m_cacheSize);
+  for (unsigned int i = 0; i < m_inputs.size(); ++i) {
+    const char * name = m_inputs[i]->GetName().c_str();
+    m_tree->SetBranchStatus(name,1);
+    m_tree->SetBranchAddress(name,m_inputs[i]->GetBackAddress(0));
+    m_tree->AddBranchToCache(name,true);
+  }
+  m_entries   = m_tree->GetEntries();
+  m_entryList = entryList;
+
+  // output trees and columnar outputs of chains
+  bool hasTrees = false, hasColumns = false;
+  for (unsigned int chain = 0; chain < m_outputs.size(); ++chain) {
+    m_outputs[chain].tree    = chain < outTrees.size()      ? outTrees[chain]      : 0;
+    m_outputs[chain].columns = chain < columnOutputs.size() ? columnOutputs[chain] : 0;
+    hasTrees   = hasTrees   || m_outputs[chain].tree;
+    hasColumns = hasColumns || m_outputs[chain].columns;
+  }
+  m_parallel = m_writers.size() > 1 && hasTrees && ! hasColumns;
+  m_nWriters = m_parallel ? m_writers.size() : 1;
+  m_blockBatches = ( m_blockSize + m_batchSize - 1 ) / m_batchSize;
+  if ( m_writers.size() > 1 && hasColumns ) m_log << Log::WARNING << "Columnar output needs a single writer - writing \"" << fileName << "\" with one writer" << Log::endl();
+
+  // allocate slots and batches (each writer has its own output batches)
+  const unsigned int nSlots = m_depth * m_batchSize;
+  for (unsigned int i = 0; i < m_inputs.size(); ++i) m_inputs[i]->Resize(nSlots);
+  for (unsigned int chain = 0; chain < m_outputs.size(); ++chain) {
+    for (unsigned int i = 0; i < m_outputs[chain].bindings.size(); ++i) m_outputs[chain].bindings[i]->Resize(nSlots * m_nWriters);
+  }
+  m_inBatches.assign(m_depth, InputBatch());
+  m_outBatches.assign(m_depth * m_nWriters, OutputBatch());
+  unsigned int batch = 0;
+  while ( m_inFull.Pop(batch) || m_inFree.Pop(batch) ) {}
+  for (unsigned int i = 0; i < m_depth; ++i) m_inFree.Push(i);
+  for (unsigned int w = 0; w < m_writers.size(); ++w) {
+    Writer & writer = *m_writers[w];
+    std::vector<char> * block = 0;
+    while ( writer.full.Pop(batch) || writer.free.Pop(batch) ) {}
+    while ( writer.blocks.Pop(block) ) delete block;
+    for (unsigned int i = w * m_depth; w < m_nWriters && i < (w + 1) * m_depth; ++i) {
+      m_outBatches[i].passed.assign(m_batchSize * m_outputs.size(), 0);
+      writer.free.Push(i);
+    }
+  }
+
+  // writer fills output from its own copy of the output variables - with several writers, into
+  // its own copies of the output trees in memory
+  if ( m_parallel ) {
+    TDirectory * current = TDirectory::CurrentDirectory();
+    for (unsigned int w = 0; w < m_nWriters; ++w) {
+      Writer & writer = *m_writers[w];
+      std::ostringstream name;
+      name << "EventPipeline_writer" << w << ".root";
+      writer.file = new TMemFile( name.str().c_str() , "recreate" );
+      writer.trees.assign( m_outputs.size() , static_cast<TTree *>(0) );
+      for (unsigned int chain = 0; chain < m_outputs.size(); ++chain) {
+	const Output & output = m_outputs[chain];
+	if ( ! output.tree ) continue;
+	if ( output.tree->GetCurrentFile() ) writer.file->SetCompressionSettings( output.tree->GetCurrentFile()->GetCompressionSettings() );
+	TTree * tree = output.tree->CloneTree(0);
+
+	// detach copy from output tree, so changes of the output tree's branch addresses don't reach the writer
+	if ( output.tree->GetListOfClones() ) output.tree->GetListOfClones()->Remove(tree);
+	tree->SetName( ("chain" + std::to_string(chain)).c_str() );
+	tree->SetDirectory( writer.file );
+	for (unsigned int i = 0; i < output.bindings.size(); ++i) {
+	  TBranch * branch = tree->GetBranch(output.bindings[i]->GetName().c_str());
+	  if ( branch ) branch->SetAddress(output.bindings[i]->GetBackAddress(w));
+	}
+	writer.trees[chain] = tree;
+      }
+    }
+    if ( current ) current->cd();
+  }
+  else SwitchOutput(true);
+
+  // start threads
+  m_nextEntry = NextEntry(0);
+  m_inBatch   = -1;
+  m_inPos     = 0;
+  m_outBatch  = -1;
+  m_outWriter = 0;
+  m_outBlockBatches = 0;
+  m_hasEntry  = false;
+  m_readerDone  = false;
+  m_readerError = false;
+  m_abort       = false;
+  m_finishing   = false;
+  m_writerError = false;
+  m_startTime = Now();
+  m_reader = std::thread(&EventPipeline::Read,this);
+  for (unsigned int w = 0; w < m_nWriters; ++w) {
+    m_writers[w]->nEntries = 0;
+    m_writers[w]->finished = false;
+    m_writers[w]->thread   = std::thread(&EventPipeline::Write,this,w);
+  }
+  if ( m_parallel ) m_sink = std::thread(&EventPipeline::Sink,this);
+  m_running = true;
+
+  m_log << Log::INFO << "Reading \"" << fileName << "\" with pipeline (" << m_depth << " batches of " << m_batchSize << " entries";
+  if ( m_parallel ) m_log << ", " << m_nWriters << " writers with blocks of " << m_blockBatches * m_batchSize << " entries" << ( m_keepOrder ? " in order" : "" );
+  m_log << ")" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS EventPipeline::Next(long entry)
+{
+
+  if ( entry != m_nextEntry ) {
+    m_log << Log::ERROR << "Entries must be read in order with the pipeline (expected " << m_nextEntry << ", got " << entry << ")" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // output of previous entry is complete
+  if ( m_hasEntry && ++m_outBatches[m_outBatch].n == m_batchSize ) FlushOutput();
+  m_hasEntry = false;
+
+  // take next batch from reader once the current one is used up
+  if ( m_inBatch < 0 || m_inPos == m_inBatches[m_inBatch].n ) {
+    if ( m_inBatch >= 0 ) m_inFree.Push(m_inBatch);
+    m_inBatch = -1;
+    m_stages[1].occupancy += m_inFull.Size();
+    unsigned int batch = 0;
+    if ( ! Wait(m_inFull,batch,m_readerDone,m_stages[1].waitInput) ) {
+      if ( m_readerError ) m_log << Log::ERROR << "Couldn't read entry " << entry << " from input tree" << Log::endl();
+      else                 m_log << Log::ERROR << "Entry " << entry << " is beyond the end of the input tree" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+    m_inBatch = batch;
+    m_inPos   = 0;
+    ++m_stages[1].batches;
+  }
+
+  // take free output batch from writer of current block
+  if ( m_outBatch < 0 ) {
+    unsigned int batch = 0;
+    if ( ! Wait(m_writers[m_outWriter]->free,batch,m_abort,m_stages[1].waitOutput) ) {
+      m_log << Log::ERROR << "Pipeline was aborted while waiting for a free output batch (entry " << entry << ")" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+    m_outBatch = batch;
+    m_outBatches[batch].n = 0;
+  }
+  OutputBatch & output = m_outBatches[m_outBatch];
+  std::fill(output.passed.begin() + output.n * m_outputs.size(), output.passed.begin() + (output.n + 1) * m_outputs.size(), 0);
+
+  // move entry to selectors' variables
+  const unsigned int slot = m_inBatch * m_batchSize + m_inPos;
+  for (unsigned int i = 0; i < m_inputs.size(); ++i) m_inputs[i]->SlotToFront(slot);
+  ++m_inPos;
+  m_nextEntry = NextEntry(m_nextEntry + 1);
+  m_hasEntry = true;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void EventPipeline::Fill(unsigned int chain)
+{
+
+  if ( ! m_hasEntry || chain >= m_outputs.size() ) return;
+
+  // copy output of chain to slot of current entry
+  OutputBatch & output = m_outBatches[m_outBatch];
+  const unsigned int slot = m_outBatch * m_batchSize + output.n;
+  output.passed[output.n * m_outputs.size() + chain] = 1;
+  const std::vector<SlotBindingBase *> & bindings = m_outputs[chain].bindings;
+  for (unsigned int i = 0; i < bindings.size(); ++i) bindings[i]->FrontToSlot(slot);
+
+}
+
+
+GLOBAL::STATUS EventPipeline::Stop()
+{
+
+  m_prepared = false;
+  if ( ! m_running ) {
+    for (unsigned int i = 0; i < m_inputs.size(); ++i) delete m_inputs[i];
+    m_inputs.clear();
+    return GLOBAL::SUCCESS;
+  }
+
+  // hand remaining output to writer, and stop reader (it may be ahead of the last entry used)
+  if ( m_hasEntry ) ++m_outBatches[m_outBatch].n;
+  m_hasEntry = false;
+  if ( m_outBatch >= 0 && m_outBatches[m_outBatch].n > 0 ) FlushOutput();
+  m_finishing = true;
+  m_abort     = true;
+  m_reader.join();
+  for (unsigned int w = 0; w < m_nWriters; ++w) m_writers[w]->thread.join();
+  if ( m_parallel ) m_sink.join();
+  m_running = false;
+
+  // execute stage was busy whenever it wasn't waiting, write stage is averaged over writers
+  m_stages[1].busy += Now() - m_startTime - m_stages[1].waitInput - m_stages[1].waitOutput;
+  m_startTime = 0.;
+  for (unsigned int w = 0; w < m_nWriters; ++w) {
+    Stage & stage = m_writers[w]->stage;
+    m_stages[2].busy       += stage.busy       / m_nWriters;
+    m_stages[2].waitInput  += stage.waitInput  / m_nWriters;
+    m_stages[2].waitOutput += stage.waitOutput / m_nWriters;
+    m_stages[2].occupancy  += stage.occupancy;
+    m_stages[2].batches    += stage.batches;
+    stage = Stage();
+  }
+
+  // selectors see their own variables again (copies of output trees of writers are deleted)
+  if ( m_parallel ) {
+    for (unsigned int w = 0; w < m_nWriters; ++w) {
+      m_writers[w]->file->Close();
+      delete m_writers[w]->file;
+      m_writers[w]->file = 0;
+      m_writers[w]->trees.clear();
+    }
+  }
+  else SwitchOutput(false);
+
+  // forget input variables (re-connected for next input file)
+  for (unsigned int i = 0; i < m_inputs.size(); ++i) delete m_inputs[i];
+  m_inputs.clear();
+  m_tree = 0;
+  m_file->Close();
+  delete m_file;
+  m_file = 0;
+
+  if ( m_writerError ) {
+    m_log << Log::ERROR << "Couldn't fill output in writer thread" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void EventPipeline::Report() const
+{
+
+  if ( m_stages[1].batches == 0 ) return;
+
+  static const char * names[4] = { "read", "execute", "write", "sink" };
+  m_log << Log::INFO << "Pipeline statistics (" << m_depth << " batches of " << m_batchSize << " entries";
+  if ( m_writers.size() > 1 ) m_log << ", write stage averaged over " << m_writers.size() << " writers";
+  m_log << "):" << Log::endl();
+  std::ostringstream header;
+  header << std::setw(10) << std::left << "stage" << std::right << std::setw(12) << "busy [s]"
+	 << std::setw(20) << "wait input [s]" << std::setw(20) << "wait output [s]" << std::setw(24) << "input queue occupancy";
+  m_log << Log::INFO << header.str() << Log::endl();
+  unsigned int limiting = 0;
+  for (unsigned int i = 0; i < 4; ++i) {
+    const Stage & stage = m_stages[i];
+    if ( i == 3 && stage.batches == 0 ) continue;
+    std::ostringstream line;
+    line << std::setw(10) << std::left << names[i] << std::right << std::fixed << std::setprecision(2)
+	 << std::setw(12) << stage.busy << std::setw(20) << stage.waitInput << std::setw(20) << stage.waitOutput;
+    if ( i > 0 ) line << std::setw(16) << std::setprecision(1) << ( stage.batches ? stage.occupancy / stage.batches : 0. ) << " / " << m_depth;
+    m_log << Log::INFO << line.str() << Log::endl();
+    if ( stage.busy > m_stages[limiting].busy ) limiting = i;
+  }
+  m_log << Log::INFO << "Throughput is limited by the " << names[limiting] << " stage" << Log::endl();
+
+}
+
+
+void EventPipeline::Read()
+{
+
+  ThreadPlacement::Apply( ThreadPlacement::READER , 0 );
+  AllocationProfiler::Scope scope( AllocationProfiler::AddContext("pipeline reader") );
+  Tracer::SetThreadName( "pipeline reader" );
+  const unsigned int traceName = Tracer::AddName( "pipeline: read batch" );
+  Stage & stage = m_stages[0];
+  long entry = NextEntry(0);
+  while ( entry < m_entries && ! m_abort ) {
+
+    // wait for free batch (back-pressure from execute stage)
+    unsigned int batch = 0;
+    if ( ! Wait(m_inFree,batch,m_abort,stage.waitOutput) ) break;
+
+    // read entries into slots of batch
+    const double start = Now();
+    Tracer::Span span( traceName );
+    InputBatch & input = m_inBatches[batch];
+    input.first = entry;
+    input.n     = 0;
+    for ( ; input.n < m_batchSize && entry < m_entries; ++input.n, entry = NextEntry(entry + 1)) {
+      if ( m_tree->GetEntry(entry) < 0 ) {
+	m_readerError = true;
+	break;
+      }
+      for (unsigned int i = 0; i < m_inputs.size(); ++i) m_inputs[i]->BackToSlot(batch * m_batchSize + input.n);
+    }
+    stage.busy += Now() - start;
+    ++stage.batches;
+
+    // hand batch to execute stage (never full - there are only as many batches as queue slots)
+    if ( m_readerError ) break;
+    m_inFull.Push(batch);
+
+  }
+  m_readerDone = true;
+
+}
+
+
+void EventPipeline::Write(unsigned int index)
+{
+
+  ThreadPlacement::Apply( ThreadPlacement::WRITER , index );
+  AllocationProfiler::Scope scope( AllocationProfiler::AddContext("pipeline writer") );
+  Tracer::SetThreadName( "pipeline writer " + std::to_string(index) );
+  const unsigned int traceName = Tracer::AddName( "pipeline: fill batch" );
+  Writer & writer = *m_writers[index];
+  Stage & stage = writer.stage;
+  unsigned int batch = 0, nBatches = 0;
+  while ( true ) {
+
+    // wait for batch from execute stage
+    stage.occupancy += writer.full.Size();
+    if ( ! Wait(writer.full,batch,m_finishing,stage.waitInput) ) break;
+    ++stage.batches;
+
+    // fill entries of batch for each chain they passed (into the writer's copy of the output tree
+    // with several writers)
+    const double start = Now();
+    {
+      Tracer::Span span( traceName );
+      const OutputBatch & output = m_outBatches[batch];
+      for (unsigned int n = 0; n < output.n && ! m_writerError; ++n) {
+	for (unsigned int chain = 0; chain < m_outputs.size(); ++chain) {
+	  if ( ! output.passed[n * m_outputs.size() + chain] ) continue;
+	  const Output & out = m_outputs[chain];
+	  TTree * tree = m_parallel ? writer.trees[chain] : out.tree;
+	  for (unsigned int i = 0; i < out.bindings.size(); ++i) out.bindings[i]->SlotToBack(batch * m_batchSize + n, index);
+	  if ( tree        && tree->Fill() < 0 )                       m_writerError = true;
+	  if ( out.columns && out.columns->Fill() != GLOBAL::SUCCESS ) m_writerError = true;
+	  ++writer.nEntries;
+	}
+      }
+    }
+    stage.busy += Now() - start;
+
+    // return batch to execute stage
+    writer.free.Push(batch);
+
+    // hand finished block to sink
+    if ( m_parallel && ++nBatches == m_blockBatches ) {
+      FinishBlock(writer);
+      nBatches = 0;
+    }
+
+  }
+  if ( m_parallel && nBatches > 0 ) FinishBlock(writer);
+  writer.finished = true;
+
+}
+
+
+void EventPipeline::FinishBlock(Writer & writer)
+{
+
+  // write remaining baskets and trees to file in memory, serialise it and reset the trees
+  const double start = Now();
+  std::vector<char> * block = 0;
+  if ( writer.nEntries > 0 ) {
+    Tracer::Span span( Tracer::AddName( "pipeline: write block" ) );
+    if ( writer.file->Write() < 0 ) m_writerError = true;
+    block = new std::vector<char>( writer.file->GetSize() );
+    writer.file->CopyTo( block->data() , block->size() );
+    writer.file->ResetAfterMerge(0);
+  }
+  writer.nEntries = 0;
+  writer.stage.busy += Now() - start;
+
+  // hand block to sink (empty blocks too, so the sink can keep the order)
+  const double wait = Now();
+  unsigned int attempt = 0;
+  while ( ! writer.blocks.Push(block) ) {
+    if ( ++attempt < 64 ) std::this_thread::yield();
+    else std::this_thread::sleep_for( std::chrono::microseconds(20) );
+  }
+  writer.stage.waitOutput += Now() - wait;
+
+}
+
+
+void EventPipeline::Sink()
+{
+
+  ThreadPlacement::Apply( ThreadPlacement::SINK , 0 );
+  AllocationProfiler::Scope scope( AllocationProfiler::AddContext("pipeline sink") );
+  Tracer::SetThreadName( "pipeline sink" );
+  const unsigned int traceName = Tracer::AddName( "pipeline: merge block" );
+  Stage & stage = m_stages[3];
+  unsigned int next = 0;
+  while ( true ) {
+
+    // take next block in order (blocks are handed to writers in turn), or a block of any writer
+    std::vector<char> * block = 0;
+    bool found = false;
+    if ( m_keepOrder ) {
+      Writer & writer = *m_writers[next];
+      stage.occupancy += writer.blocks.Size();
+      found = Wait(writer.blocks,block,writer.finished,stage.waitInput);
+      next = ( next + 1 ) % m_nWriters;
+    }
+    else {
+      const double start = Now();
+      unsigned int attempt = 0;
+      while ( true ) {
+	bool finished = true;
+	for (unsigned int w = 0; w < m_nWriters; ++w) finished = finished && m_writers[w]->finished;
+	for (unsigned int w = 0; w < m_nWriters && ! found; ++w) found = m_writers[w]->blocks.Pop(block);
+	if ( found || finished ) break;
+	if ( ++attempt < 64 ) std::this_thread::yield();
+	else std::this_thread::sleep_for( std::chrono::microseconds(20) );
+      }
+      stage.waitInput += Now() - start;
+    }
+    if ( ! found ) break;
+    ++stage.batches;
+
+    // copy baskets into output trees
+    const double start = Now();
+    {
+      Tracer::Span span( traceName );
+      if ( block && ! MergeBlock(*block) ) m_writerError = true;
+      delete block;
+    }
+    stage.busy += Now() - start;
+
+  }
+
+}
+
+
+bool EventPipeline::MergeBlock(const std::vector<char> & block)
+{
+
+  TMemFile file( "EventPipeline_block.root" , const_cast<char *>(block.data()) , block.size() , "read" );
+  bool ok = file.IsOpen();
+  for (unsigned int chain = 0; ok && chain < m_outputs.size(); ++chain) {
+    if ( ! m_outputs[chain].tree ) continue;
+    TTree * tree = static_cast<TTree *>( file.Get( ("chain" + std::to_string(chain)).c_str() ) );
+    if ( ! tree || m_outputs[chain].tree->CopyEntries(tree,-1,"fast") < 0 ) ok = false;
+  }
+  file.Close();
+
+  return ok;
+
+}
+
+
+template <class T>
+bool EventPipeline::Wait(SpscQueue<T> & queue, T & value, const std::atomic<bool> & flag, double & seconds) const
+{
+
+  if ( queue.Pop(value) ) return true;
+
+  // spin briefly, then back off to short sleeps
+  const double start = Now();
+  unsigned int attempt = 0;
+  while ( ! queue.Pop(value) ) {
+    if ( flag ) {
+      bool ok = queue.Pop(value);
+      seconds += Now() - start;
+      return ok;
+    }
+    if ( ++attempt < 64 ) std::this_thread::yield();
+    else std::this_thread::sleep_for( std::chrono::microseconds(20) );
+  }
+  seconds += Now() - start;
+
+  return true;
+
+}
+
+
+void EventPipeline::FlushOutput()
+{
+
+  m_writers[m_outWriter]->full.Push(m_outBatch);
+  m_outBatch = -1;
+
+  // next block goes to next writer
+  if ( ++m_outBlockBatches == m_blockBatches ) {
+    m_outBlockBatches = 0;
+    m_outWriter = ( m_outWriter + 1 ) % m_nWriters;
+  }
+
+}
+
+
+void EventPipeline::SwitchOutput(bool toWriter)
+{
+
+  for (unsigned int chain = 0; chain < m_outputs.size(); ++chain) {
+    Output & output = m_outputs[chain];
+    if ( toWriter ) output.addresses.assign(output.bindings.size(), static_cast<void *>(0));
+    for (unsigned int i = 0; i < output.bindings.size(); ++i) {
+      SlotBindingBase * binding = output.bindings[i];
+
+      // output tree shares memory with the variables - point branch to writer's copy, or restore it
+      TBranch * branch = output.tree ? output.tree->GetBranch(binding->GetName().c_str()) : 0;
+      if ( branch && toWriter ) {
+	output.addresses[i] = branch->GetAddress();
+	branch->SetAddress(binding->GetBackAddress(0));
+      }
+      else if ( branch && output.addresses[i] ) branch->SetAddress(output.addresses[i]);
+
+      // columnar output
+      if ( output.columns ) output.columns->AddBinding(binding->NewColumnBinding(toWriter));
+
+    }
+  }
+
+}
@@ -0,0 +1,685 @@
+// Standard Template Library includes
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+// Analysis includes
+#include "Expression.h"
+
+
+namespace {
+
+  // element-wise operations
+  struct Negate       { double operator()(double x) const { return -x;           } };
+  struct Not          { double operator()(double x) const { return x == 0.;      } };
+  struct Abs          { double operator()(double x) const { return std::fabs(x); } };
+  struct Sqrt         { double operator()(double x) const { return std::sqrt(x); } };
+  struct Exp          { double operator()(double x) const { return std::exp(x);  } };
+  struct Logarithm    { double operator()(double x) const { return std::log(x);  } };
+  struct Plus         { double operator()(double x, double y) const { return x + y;               } };
+  struct Minus        { double operator()(double x, double y) const { return x - y;               } };
+  struct Times        { double operator()(double x, double y) const { return x * y;               } };
+  struct Divide       { double operator()(double x, double y) const { return x / y;               } };
+  struct Less         { double operator()(double x, double y) const { return x < y;               } };
+  struct LessEqual    { double operator()(double x, double y) const { return x <= y;              } };
+  struct Greater      { double operator()(double x, double y) const { return x > y;               } };
+  struct GreaterEqual { double operator()(double x, double y) const { return x >= y;              } };
+  struct Equal        { double operator()(double x, double y) const { return x == y;              } };
+  struct NotEqual     { double operator()(double x, double y) const { return x != y;              } };
+  struct And          { double operator()(double x, double y) const { return (x != 0.) & (y != 0.); } };
+  struct Or           { double operator()(double x, double y) const { return (x != 0.) | (y != 0.); } };
+
+  // accumulations (accumulated value, element)
+  struct Count        { double operator()(double s, double x) const { return s + (x != 0.);      } };
+  struct Minimum      { double operator()(double s, double x) const { return x < s ? x : s;      } };
+  struct Maximum      { double operator()(double s, double x) const { return x > s ? x : s;      } };
+
+  // names of operations (same order as Expression::OP)
+  const char * OpNames[] = {
+    "LOAD", "NEG", "NOT", "ABS", "SQRT", "EXP", "LOG",
+    "ADD", "SUB", "MUL", "DIV", "LT", "LE", "GT", "GE", "EQ", "NE", "AND", "OR",
+    "SIZE", "COUNT", "SUM", "MIN", "MAX", "ANY", "ALL", "INDEX"
+  };
+
+}
+
+
+Expression::Expression(const std::string & name, const std::string & text, const Log::LEVEL & logLevel) :
+  m_text(text),
+  m_compiled(false),
+  m_pos(0),
+  m_root(-1),
+  m_log(name)
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+  m_result.isConst  = true;
+  m_result.isVector = false;
+  m_result.reg      = -1;
+  m_result.value    = 0.;
+
+}
+
+
+GLOBAL::STATUS Expression::Parse()
+{
+
+  m_nodes.clear();
+  m_variables.clear();
+  if ( ! Tokenize() ) return GLOBAL::ERROR;
+
+  m_pos  = 0;
+  m_root = ParseOr();
+  if ( m_root < 0 ) return GLOBAL::ERROR;
+  if ( m_pos < m_tokens.size() ) {
+    Error("unexpected \"" + m_tokens[m_pos] + "\"");
+    return GLOBAL::ERROR;
+  }
+
+  m_log << Log::DEBUG << "Parsed \"" << m_text << "\" (" << m_nodes.size() << " nodes, " << m_variables.size() << " variables)" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+bool Expression::Tokenize()
+{
+
+  m_tokens.clear();
+  const std::string & s = m_text;
+  std::string::size_type i = 0;
+  while ( i < s.size() ) {
+
+    const char c = s[i];
+    std::string::size_type j = i + 1;
+    if ( std::isspace(c) ) {
+      ++i;
+      continue;
+    }
+    else if ( std::isdigit(c) || ( c == '.' && i + 1 < s.size() && std::isdigit(s[i+1]) ) ) {
+      // number, with optional exponent
+      while ( j < s.size() && ( std::isdigit(s[j]) || s[j] == '.' ) ) ++j;
+      if ( j < s.size() && ( s[j] == 'e' || s[j] == 'E' ) ) {
+	std::string::size_type k = j + 1;
+	if ( k < s.size() && ( s[k] == '+' || s[k] == '-' ) ) ++k;
+	if ( k < s.size() && std::isdigit(s[k]) ) {
+	  j = k;
+	  while ( j < s.size() && std::isdigit(s[j]) ) ++j;
+	}
+      }
+    }
+    else if ( std::isalpha(c) || c == '_' ) {
+      // variable or function (branch names may contain dots)
+      while ( j < s.size() && ( std::isalnum(s[j]) || s[j] == '_' || s[j] == '.' ) ) ++j;
+    }
+    else if ( s.compare(i,2,"&&") == 0 || s.compare(i,2,"||") == 0 || s.compare(i,2,"<=") == 0 ||
+	      s.compare(i,2,">=") == 0 || s.compare(i,2,"==") == 0 || s.compare(i,2,"!=") == 0 ) {
+      j = i + 2;
+    }
+    else if ( std::string("+-*/<>!()[]").find(c) == std::string::npos ) {
+      m_log << Log::ERROR << "Unexpected character '" << c << "' at position " << i << " in \"" << m_text << "\"" << Log::endl();
+      return false;
+    }
+
+    m_tokens.push_back(s.substr(i,j-i));
+    i = j;
+
+  }
+
+  return true;
+
+}
+
+
+bool Expression::Accept(const std::string & token)
+{
+
+  if ( m_pos < m_tokens.size() && m_tokens[m_pos] == token ) {
+    ++m_pos;
+    return true;
+  }
+
+  return false;
+
+}
+
+
+int Expression::AddNode(KIND kind, OP op, int a, int b)
+{
+
+  Node node;
+  node.kind  = kind;
+  node.op    = op;
+  node.value = 0.;
+  if ( a >= 0 ) node.args.push_back(a);
+  if ( b >= 0 ) node.args.push_back(b);
+  m_nodes.push_back(node);
+
+  return m_nodes.size() - 1;
+
+}
+
+
+int Expression::Error(const std::string & message)
+{
+
+  m_log << Log::ERROR << "Couldn't parse \"" << m_text << "\" : " << message << Log::endl();
+
+  return -1;
+
+}
+
+
+int Expression::ParseOr()
+{
+
+  int node = ParseAnd();
+  while ( node >= 0 && Accept("||") ) {
+    const int right = ParseAnd();
+    node = right < 0 ? -1 : AddNode(BINARY,OR,node,right);
+  }
+
+  return node;
+
+}
+
+
+int Expression::ParseAnd()
+{
+
+  int node = ParseComparison();
+  while ( node >= 0 && Accept("&&") ) {
+    const int right = ParseComparison();
+    node = right < 0 ? -1 : AddNode(BINARY,AND,node,right);
+  }
+
+  return node;
+
+}
+
+
+int Expression::ParseComparison()
+{
+
+  static const char * tokens[] = { "<", "<=", ">", ">=", "==", "!=" };
+  static const OP     ops[]    = { LT , LE  , GT , GE  , EQ  , NE   };
+
+  int node = ParseSum();
+  bool found = true;
+  while ( node >= 0 && found ) {
+    found = false;
+    for (unsigned int i = 0; ! found && i < 6; ++i) {
+      if ( ! Accept(tokens[i]) ) continue;
+      const int right = ParseSum();
+      node = right < 0 ? -1 : AddNode(BINARY,ops[i],node,right);
+      found = true;
+    }
+  }
+
+  return node;
+
+}
+
+
+int Expression::ParseSum()
+{
+
+  int node = ParseProduct();
+  while ( node >= 0 ) {
+    OP op;
+    if      ( Accept("+") ) op = ADD;
+    else if ( Accept("-") ) op = SUB;
+    else break;
+    const int right = ParseProduct();
+    node = right < 0 ? -1 : AddNode(BINARY,op,node,right);
+  }
+
+  return node;
+
+}
+
+
+int Expression::ParseProduct()
+{
+
+  int node = ParseUnary();
+  while ( node >= 0 ) {
+    OP op;
+    if      ( Accept("*") ) op = MUL;
+    else if ( Accept("/") ) op = DIV;
+    else break;
+    const int right = ParseUnary();
+    node = right < 0 ? -1 : AddNode(BINARY,op,node,right);
+  }
+
+  return node;
+
+}
+
+
+int Expression::ParseUnary()
+{
+
+  OP op;
+  if      ( Accept("-") ) op = NEG;
+  else if ( Accept("!") ) op = NOT;
+  else if ( Accept("+") ) return ParseUnary();
+  else return ParsePostfix();
+
+  const int node = ParseUnary();
+
+  return node < 0 ? -1 : AddNode(UNARY,op,node);
+
+}
+
+
+int Expression::ParsePostfix()
+{
+
+  int node = ParsePrimary();
+  while ( node >= 0 && Accept("[") ) {
+    const int index = ParseOr();
+    if ( index < 0 ) return -1;
+    if ( ! Accept("]") ) return Error("expected \"]\"");
+    node = AddNode(ELEMENT,INDEX,node,index);
+  }
+
+  return node;
+
+}
+
+
+int Expression::ParsePrimary()
+{
+
+  if ( m_pos >= m_tokens.size() ) return Error("unexpected end of expression");
+  const std::string token = m_tokens[m_pos++];
+
+  // parenthesis
+  if ( token == "(" ) {
+    const int node = ParseOr();
+    if ( node < 0 ) return -1;
+    if ( ! Accept(")") ) return Error("expected \")\"");
+    return node;
+  }
+
+  // number
+  if ( std::isdigit(token[0]) || token[0] == '.' || token == "true" || token == "false" ) {
+    char * end = 0;
+    const double value = token == "true" ? 1. : token == "false" ? 0. : std::strtod(token.c_str(),&end);
+    if ( end && *end != '\0' ) return Error("invalid number \"" + token + "\"");
+    const int node = AddNode(NUMBER,LOAD);
+    m_nodes[node].value = value;
+    return node;
+  }
+
+  if ( ! ( std::isalpha(token[0]) || token[0] == '_' ) ) return Error("unexpected \"" + token + "\"");
+
+  // function
+  if ( Accept("(") ) {
+    static const char * names[] = { "abs", "sqrt", "exp", "log", "size", "count", "sum", "min", "max", "any", "all" };
+    static const OP     ops[]   = { ABS  , SQRT  , EXP  , LOGN , SIZE  , COUNT  , SUM  , MIN  , MAX  , ANY  , ALL   };
+    int func = -1;
+    for (unsigned int i = 0; i < 11; ++i) if ( token == names[i] ) func = i;
+    if ( func < 0 ) return Error("unknown function \"" + token + "\"");
+    const int arg = ParseOr();
+    if ( arg < 0 ) return -1;
+    if ( ! Accept(")") ) return Error("expected \")\" after argument of " + token + "()");
+    const int node = AddNode(CALL,ops[func],arg);
+    m_nodes[node].name = token;
+    return node;
+  }
+
+  // variable (value is index in list of variables)
+  unsigned int index = 0;
+  while ( index < m_variables.size() && m_variables[index] != token ) ++index;
+  if ( index == m_variables.size() ) m_variables.push_back(token);
+  const int node = AddNode(VARIABLE,LOAD);
+  m_nodes[node].name  = token;
+  m_nodes[node].value = index;
+
+  return node;
+
+}
+
+
+GLOBAL::STATUS Expression::Compile(const std::map<std::string,const ExpressionInput *> & inputs)
+{
+
+  if ( m_root < 0 ) {
+    m_log << Log::ERROR << "Can't compile \"" << m_text << "\" before it is parsed" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // find inputs
+  m_inputs.clear();
+  for (unsigned int i = 0; i < m_variables.size(); ++i) {
+    std::map<std::string,const ExpressionInput *>::const_iterator iter = inputs.find(m_variables[i]);
+    if ( iter == inputs.end() || ! iter->second ) {
+      m_log << Log::ERROR << "Variable \"" << m_variables[i] << "\" in \"" << m_text << "\" is not available" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+    m_inputs.push_back(iter->second);
+  }
+
+  // generate program
+  m_program.clear();
+  m_scalars.clear();
+  m_vectors.clear();
+  Operand none = { false, false, -1, 0. };
+  m_loads.assign(m_variables.size(),none);
+  m_compiled = Emit(m_root,m_result);
+  if ( ! m_compiled ) return GLOBAL::ERROR;
+
+  m_log << Log::DEBUG << "Compiled \"" << m_text << "\" : " << m_program.size() << " instructions, " << m_scalars.size()
+	<< " scalar and " << m_vectors.size() << " vector registers, " << (m_result.isVector ? "vector" : "scalar") << " result" << Log::endl();
+  if ( m_log.GetLevel() == Log::DEBUG ) Print();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+Expression::Operand Expression::Register(bool isVector)
+{
+
+  Operand operand = { false, isVector, 0, 0. };
+  if ( isVector ) {
+    operand.reg = m_vectors.size();
+    m_vectors.push_back(std::vector<double>());
+  }
+  else {
+    operand.reg = m_scalars.size();
+    m_scalars.push_back(0.);
+  }
+
+  return operand;
+
+}
+
+
+int Expression::ScalarRegister(const Operand & operand)
+{
+
+  // constants get a register holding their value
+  if ( ! operand.isConst ) return operand.reg;
+  m_scalars.push_back(operand.value);
+
+  return m_scalars.size() - 1;
+
+}
+
+
+bool Expression::CheckVector(const Node & node, const Operand & operand, bool isVector)
+{
+
+  if ( operand.isVector == isVector ) return true;
+  const std::string what = node.kind == ELEMENT ? "index of [] " : node.name + "() ";
+  m_log << Log::ERROR << "Couldn't compile \"" << m_text << "\" : " << what << "expects a " << (isVector ? "vector" : "scalar")
+	<< " argument" << Log::endl();
+
+  return false;
+
+}
+
+
+bool Expression::Emit(int index, Operand & result)
+{
+
+  const Node & node = m_nodes[index];
+
+  // constant
+  if ( node.kind == NUMBER ) {
+    Operand constant = { true, false, -1, node.value };
+    result = constant;
+    return true;
+  }
+
+  // variable (loaded once)
+  if ( node.kind == VARIABLE ) {
+    const unsigned int var = static_cast<unsigned int>(node.value);
+    if ( m_loads[var].reg < 0 ) {
+      m_loads[var] = Register(m_inputs[var]->IsVector());
+      Instruction ins = { LOAD, m_loads[var].isVector ? VS : SS, m_loads[var].reg, static_cast<int>(var), -1 };
+      m_program.push_back(ins);
+    }
+    result = m_loads[var];
+    return true;
+  }
+
+  // operands
+  Operand a, b;
+  if ( ! Emit(node.args[0],a) ) return false;
+  if ( node.args.size() > 1 && ! Emit(node.args[1],b) ) return false;
+
+  // reductions of vectors, and element of vector
+  if ( node.kind == ELEMENT || ( node.kind == CALL && node.op >= SIZE ) ) {
+    if ( ! CheckVector(node,a,true) ) return false;
+    if ( node.kind == ELEMENT && ! CheckVector(node,b,false) ) return false;
+    result = Register(false);
+    Instruction ins = { node.op, VS, result.reg, a.reg, node.kind == ELEMENT ? ScalarRegister(b) : -1 };
+    m_program.push_back(ins);
+    return true;
+  }
+
+  // element-wise operation of one operand
+  if ( node.args.size() == 1 ) {
+    if ( a.isConst ) {
+      Operand constant = { true, false, -1, Fold(node.op,a.value,0.) };
+      result = constant;
+      return true;
+    }
+    result = Register(a.isVector);
+    Instruction ins = { node.op, a.isVector ? VS : SS, result.reg, a.reg, -1 };
+    m_program.push_back(ins);
+    return true;
+  }
+
+  // element-wise operation of two operands
+  if ( a.isConst && b.isConst ) {
+    Operand constant = { true, false, -1, Fold(node.op,a.value,b.value) };
+    result = constant;
+    return true;
+  }
+  result = Register(a.isVector || b.isVector);
+  const SHAPE shape = static_cast<SHAPE>( (a.isVector ? VS : SS) | (b.isVector ? SV : SS) );
+  Instruction ins = { node.op, shape, result.reg, ScalarRegister(a), ScalarRegister(b) };
+  if ( a.isVector ) ins.a = a.reg;
+  if ( b.isVector ) ins.b = b.reg;
+  m_program.push_back(ins);
+
+  return true;
+
+}
+
+
+double Expression::Fold(OP op, double a, double b)
+{
+
+  switch ( op ) {
+  case NEG  : return Negate()(a);
+  case NOT  : return Not()(a);
+  case ABS  : return Abs()(a);
+  case SQRT : return Sqrt()(a);
+  case EXP  : return Exp()(a);
+  case LOGN : return Logarithm()(a);
+  case ADD  : return Plus()(a,b);
+  case SUB  : return Minus()(a,b);
+  case MUL  : return Times()(a,b);
+  case DIV  : return Divide()(a,b);
+  case LT   : return Less()(a,b);
+  case LE   : return LessEqual()(a,b);
+  case GT   : return Greater()(a,b);
+  case GE   : return GreaterEqual()(a,b);
+  case EQ   : return Equal()(a,b);
+  case NE   : return NotEqual()(a,b);
+  case AND  : return And()(a,b);
+  case OR   : return Or()(a,b);
+  default   : return std::numeric_limits<double>::quiet_NaN();
+  }
+
+}
+
+
+template <class F>
+void Expression::Unary(const Instruction & ins)
+{
+
+  const F f;
+  if ( ins.shape == SS ) {
+    m_scalars[ins.dst] = f(m_scalars[ins.a]);
+    return;
+  }
+
+  const std::vector<double> & x = m_vectors[ins.a];
+  std::vector<double> & out = m_vectors[ins.dst];
+  out.resize(x.size());
+  const double * px = x.data();
+  double * po = out.data();
+  for (std::size_t i = 0, n = x.size(); i < n; ++i) po[i] = f(px[i]);
+
+}
+
+
+template <class F>
+bool Expression::Binary(const Instruction & ins)
+{
+
+  const F f;
+  if ( ins.shape == SS ) {
+    m_scalars[ins.dst] = f(m_scalars[ins.a],m_scalars[ins.b]);
+    return true;
+  }
+
+  // size of result is given by the vector operand(s)
+  const std::vector<double> & vec = m_vectors[ins.shape == SV ? ins.b : ins.a];
+  if ( ins.shape == VV && m_vectors[ins.b].size() != vec.size() ) {
+    m_log << Log::ERROR << "Vectors of different size (" << vec.size() << " and " << m_vectors[ins.b].size() << ") in \""
+	  << m_text << "\"" << Log::endl();
+    return false;
+  }
+  const std::size_t n = vec.size();
+  std::vector<double> & out = m_vectors[ins.dst];
+  out.resize(n);
+  double * po = out.data();
+
+  if ( ins.shape == VV ) {
+    const double * px = m_vectors[ins.a].data();
+    const double * py = m_vectors[ins.b].data();
+    for (std::size_t i = 0; i < n; ++i) po[i] = f(px[i],py[i]);
+  }
+  else if ( ins.shape == VS ) {
+    const double * px = m_vectors[ins.a].data();
+    const double y = m_scalars[ins.b];
+    for (std::size_t i = 0; i < n; ++i) po[i] = f(px[i],y);
+  }
+  else {
+    const double x = m_scalars[ins.a];
+    const double * py = m_vectors[ins.b].data();
+    for (std::size_t i = 0; i < n; ++i) po[i] = f(x,py[i]);
+  }
+
+  return true;
+
+}
+
+
+template <class F>
+void Expression::Reduce(const Instruction & ins, double init)
+{
+
+  const F f;
+  const std::vector<double> & x = m_vectors[ins.a];
+  const double * px = x.data();
+  double s = init;
+  for (std::size_t i = 0, n = x.size(); i < n; ++i) s = f(s,px[i]);
+  m_scalars[ins.dst] = s;
+
+}
+
+
+GLOBAL::STATUS Expression::Evaluate()
+{
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+
+  bool ok = true;
+  for (std::vector<Instruction>::const_iterator ins = m_program.begin(); ok && ins != m_program.end(); ++ins) {
+
+    switch ( ins->op ) {
+    case LOAD :
+      if ( ins->shape == SS ) m_scalars[ins->dst] = m_inputs[ins->a]->Get();
+      else m_inputs[ins->a]->Load(m_vectors[ins->dst]);
+      break;
+    case NEG   : Unary<Negate>(*ins);            break;
+    case NOT   : Unary<Not>(*ins);               break;
+    case ABS   : Unary<Abs>(*ins);               break;
+    case SQRT  : Unary<Sqrt>(*ins);              break;
+    case EXP   : Unary<Exp>(*ins);               break;
+    case LOGN  : Unary<Logarithm>(*ins);         break;
+    case ADD   : ok = Binary<Plus>(*ins);        break;
+    case SUB   : ok = Binary<Minus>(*ins);       break;
+    case MUL   : ok = Binary<Times>(*ins);       break;
+    case DIV   : ok = Binary<Divide>(*ins);      break;
+    case LT    : ok = Binary<Less>(*ins);        break;
+    case LE    : ok = Binary<LessEqual>(*ins);   break;
+    case GT    : ok = Binary<Greater>(*ins);     break;
+    case GE    : ok = Binary<GreaterEqual>(*ins); break;
+    case EQ    : ok = Binary<Equal>(*ins);       break;
+    case NE    : ok = Binary<NotEqual>(*ins);    break;
+    case AND   : ok = Binary<And>(*ins);         break;
+    case OR    : ok = Binary<Or>(*ins);          break;
+    case SIZE  : m_scalars[ins->dst] = m_vectors[ins->a].size(); break;
+    case COUNT : Reduce<Count>(*ins,0.);         break;
+    case SUM   : Reduce<Plus>(*ins,0.);          break;
+    case ANY   : Reduce<Or>(*ins,0.);            break;
+    case ALL   : Reduce<And>(*ins,1.);           break;
+    case MIN   :
+      Reduce<Minimum>(*ins,inf);
+      if ( m_vectors[ins->a].empty() ) m_scalars[ins->dst] = nan;
+      break;
+    case MAX   :
+      Reduce<Maximum>(*ins,-inf);
+      if ( m_vectors[ins->a].empty() ) m_scalars[ins->dst] = nan;
+      break;
+    case INDEX : {
+      const std::vector<double> & vec = m_vectors[ins->a];
+      const double i = m_scalars[ins->b];
+      m_scalars[ins->dst] = i >= 0. && i < vec.size() ? vec[static_cast<std::size_t>(i)] : nan;
+      break;
+    }
+    }
+
+  }
+
+  return ok ? GLOBAL::SUCCESS : GLOBAL::ERROR;
+
+}
+
+
+void Expression::Print() const
+{
+
+  m_log << Log::INFO << "Program of \"" << m_text << "\" :" << Log::endl();
+  for (unsigned int i = 0; i < m_program.size(); ++i) {
+
+    const Instruction & ins = m_program[i];
+    const bool dstIsVector = ins.op < SIZE && ins.shape != SS;
+    std::ostringstream line;
+    line << std::setw(4) << i << "  " << (dstIsVector ? "v" : "s") << ins.dst << " = " << OpNames[ins.op] << " ";
+    if ( ins.op == LOAD ) line << m_variables[ins.a];
+    else {
+      line << ( ins.shape & VS ? "v" : "s" ) << ins.a;
+      if ( ins.b >= 0 ) line << ", " << ( ins.shape & SV ? "v" : "s" ) << ins.b;
+    }
+    m_log << Log::INFO << line.str() << Log::endl();
+
+  }
+
+}
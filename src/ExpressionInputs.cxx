@@ -0,0 +1,145 @@
+// Standard Template Library includes
+#include <string>
+#include <vector>
+
+// ROOT includes
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+// Analysis includes
+#include "ExpressionInputs.h"
+#include "SelectorBase.h"
+#include "Span.h"
+
+
+ExpressionInputs::~ExpressionInputs()
+{
+
+  std::map<std::string,ExpressionInput*>::iterator iter = m_inputs.begin();
+  for ( ; iter != m_inputs.end(); ++iter) delete iter->second;
+
+}
+
+
+void ExpressionInputs::SetDerived(const std::string & name, const float * addr)
+{
+
+  ExpressionInput *& input = m_inputs[name];
+  m_derived.insert(name);
+  if ( ! input ) input = new ScalarInput<float>();
+  static_cast<ScalarInput<float> *>(input)->Address() = addr;
+
+}
+
+
+void ExpressionInputs::SetDerived(const std::string & name, const std::vector<float> * addr)
+{
+
+  ExpressionInput *& input = m_inputs[name];
+  m_derived.insert(name);
+  if ( ! input ) input = new VectorInput<std::vector<float> >();
+  static_cast<VectorInput<std::vector<float> > *>(input)->Address() = addr;
+
+}
+
+
+template <class T>
+bool ExpressionInputs::ConnectScalar(SelectorBase & selector, const std::string & name, ExpressionInput *& input)
+{
+
+  if ( ! input ) input = new ScalarInput<T>();
+  ScalarInput<T> * scalar = dynamic_cast<ScalarInput<T> *>(input);
+  if ( ! scalar ) return false;
+  selector.GetVariable( name.c_str() , scalar->Address() );
+
+  return scalar->Address() != 0;
+
+}
+
+
+template <class C>
+bool ExpressionInputs::ConnectVector(SelectorBase & selector, const std::string & name, ExpressionInput *& input)
+{
+
+  if ( ! input ) input = new VectorInput<C>();
+  VectorInput<C> * vector = dynamic_cast<VectorInput<C> *>(input);
+  if ( ! vector ) return false;
+  selector.GetVariable( name.c_str() , vector->Address() );
+
+  return vector->Address() != 0;
+
+}
+
+
+GLOBAL::STATUS ExpressionInputs::Connect(SelectorBase & selector, Expression & expression)
+{
+
+  const Service & service = selector.GetService();
+  const std::vector<std::string> & variables = expression.GetVariables();
+  for (unsigned int i = 0; i < variables.size(); ++i) {
+
+    const std::string & name = variables[i];
+    if ( m_derived.count(name) ) continue;
+
+    // find variable - branch in input tree, or new variable in output tree (or buffer, if output is disabled)
+    TBranch * branch = service.GetInTree()->GetBranch(name.c_str());
+    const bool isInput = branch != 0;
+    if ( ! branch && service.HasOutput() ) branch = service.GetOutTree()->GetBranch(name.c_str());
+    TLeaf * leaf = branch ? branch->GetLeaf(name.c_str()) : 0;
+    std::string className = branch ? branch->GetClassName() : "";
+    std::string leafType  = leaf ? leaf->GetTypeName() : "";
+    if ( ! branch && ! service.HasOutput() ) {
+      if      ( service.HasBuffer<float>(name.c_str())                ) leafType  = "Float_t";
+      else if ( service.HasBuffer<double>(name.c_str())               ) leafType  = "Double_t";
+      else if ( service.HasBuffer<int>(name.c_str())                  ) leafType  = "Int_t";
+      else if ( service.HasBuffer<std::vector<float> >(name.c_str()) ) className = "vector<float>";
+    }
+    if ( className.empty() && leafType.empty() ) {
+      selector.log() << Log::ERROR << "Variable \"" << name << "\" is neither a branch in the input tree nor a new variable" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+
+    // vector<T> branches and array leaves of the input tree are connected to read-only views, the rest directly
+    const bool isArray = className.empty() && leaf && ( leaf->GetLeafCount() || leaf->GetLenStatic() > 1 );
+    ExpressionInput *& input = m_inputs[name];
+    bool ok = false;
+    if ( isInput && ( ! className.empty() || isArray ) ) {
+      if      ( className == "vector<float>"          || leafType == "Float_t"  ) ok = ConnectVector<Span<const float> >         (selector,name,input);
+      else if ( className == "vector<double>"         || leafType == "Double_t" ) ok = ConnectVector<Span<const double> >        (selector,name,input);
+      else if ( className == "vector<int>"            || leafType == "Int_t"    ) ok = ConnectVector<Span<const int> >           (selector,name,input);
+      else if ( className == "vector<unsigned int>"   || leafType == "UInt_t"   ) ok = ConnectVector<Span<const unsigned int> >  (selector,name,input);
+      else if ( className == "vector<short>"          || leafType == "Short_t"  ) ok = ConnectVector<Span<const short> >         (selector,name,input);
+      else if ( className == "vector<unsigned short>" || leafType == "UShort_t" ) ok = ConnectVector<Span<const unsigned short> >(selector,name,input);
+    }
+    else if ( ! className.empty() ) {
+      if      ( className == "vector<float>"          ) ok = ConnectVector<std::vector<float> > (selector,name,input);
+      else if ( className == "vector<double>"         ) ok = ConnectVector<std::vector<double> >(selector,name,input);
+      else if ( className == "vector<int>"            ) ok = ConnectVector<std::vector<int> >   (selector,name,input);
+    }
+    else if ( ! isArray ) {
+      if      ( leafType == "Float_t"   ) ok = ConnectScalar<Float_t>  (selector,name,input);
+      else if ( leafType == "Double_t"  ) ok = ConnectScalar<Double_t> (selector,name,input);
+      else if ( leafType == "Int_t"     ) ok = ConnectScalar<Int_t>    (selector,name,input);
+      else if ( leafType == "UInt_t"    ) ok = ConnectScalar<UInt_t>   (selector,name,input);
+      else if ( leafType == "Short_t"   ) ok = ConnectScalar<Short_t>  (selector,name,input);
+      else if ( leafType == "UShort_t"  ) ok = ConnectScalar<UShort_t> (selector,name,input);
+      else if ( leafType == "Long64_t"  ) ok = ConnectScalar<Long64_t> (selector,name,input);
+      else if ( leafType == "ULong64_t" ) ok = ConnectScalar<ULong64_t>(selector,name,input);
+      else if ( leafType == "Bool_t"    ) ok = ConnectScalar<Bool_t>   (selector,name,input);
+    }
+    if ( ! ok ) {
+      selector.log() << Log::ERROR << "Couldn't connect variable \"" << name << "\" of type \"" << ( className.empty() ? leafType : className )
+		     << "\" to expression" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+
+  }
+
+  // compile once - the inputs keep their type, and are re-pointed for each file
+  if ( expression.IsCompiled() ) return GLOBAL::SUCCESS;
+  std::map<std::string,const ExpressionInput *> inputs(m_inputs.begin(), m_inputs.end());
+
+  return expression.Compile(inputs);
+
+}
@@ -0,0 +1,142 @@
+
+// Standard Template Library includes
+#include <string>
+#include <cmath>
+
+// ROOT includes
+#include "TTree.h"
+
+// Analysis includes
+#include "ExpressionSelector.h"
+#include "Store.h"
+
+
+ExpressionSelector::ExpressionSelector(const std::string & name, const Store & config, Service & service) :
+  SelectorBase(name,config,service),
+  m_cut(0),
+  m_nEvents(0),
+  m_nPassed(0)
+{
+
+}
+
+
+ExpressionSelector::~ExpressionSelector()
+{
+
+  for (unsigned int i = 0; i < m_defines.size(); ++i) delete m_defines[i].expression;
+  delete m_cut;
+
+}
+
+
+GLOBAL::STATUS ExpressionSelector::Initialise()
+{
+
+  log() << Log::INFO << "Initialising..." << Log::endl();
+
+  // get expressions from steer file
+  const std::string prefix = GetName() + "::";
+  std::vector<std::string> defines;
+  m_config.getif<std::vector<std::string> >(prefix + "defines", defines);
+  for (unsigned int i = 0; i < defines.size(); ++i) {
+    Define define;
+    define.name       = defines[i];
+    define.expression = new Expression(prefix + defines[i], m_config.get<std::string>(prefix + defines[i]), log().GetLevel());
+    define.scalar     = 0;
+    define.vector     = 0;
+    m_defines.push_back(define);
+    if ( define.expression->Parse() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  }
+  std::string cut;
+  m_config.getif<std::string>(prefix + "cut", cut);
+  if ( ! cut.empty() ) {
+    m_cut = new Expression(prefix + "cut", cut, log().GetLevel());
+    if ( m_cut->Parse() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  }
+  else DeclareNoCut();
+
+  if ( m_defines.empty() && ! m_cut ) {
+    log() << Log::ERROR << "Neither " << prefix << "defines nor " << prefix << "cut given in card file" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ExpressionSelector::BeginInputFile()
+{
+
+  // connect variables to input and output trees, and declare derived variables
+  log() << Log::INFO << "Connecting variables" << Log::endl();
+  for (unsigned int i = 0; i < m_defines.size(); ++i) {
+
+    Define & define = m_defines[i];
+    if ( m_inputs.Connect(*this,*define.expression) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( GetService().GetInTree()->GetBranch(define.name.c_str()) ) {
+      log() << Log::ERROR << "Derived variable \"" << define.name << "\" already exists in input tree" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+
+    // derived variables are new variables, and inputs of the following expressions
+    if ( define.expression->IsVector() ) {
+      GetVariable( define.name.c_str() , define.vector , 1 );
+      if ( ! define.vector ) return GLOBAL::ERROR;
+      m_inputs.SetDerived( define.name , define.vector );
+    }
+    else {
+      GetVariable( define.name.c_str() , define.scalar , 1 );
+      if ( ! define.scalar ) return GLOBAL::ERROR;
+      m_inputs.SetDerived( define.name , define.scalar );
+    }
+
+  }
+  if ( m_cut && m_inputs.Connect(*this,*m_cut) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  if ( m_cut && m_cut->IsVector() ) {
+    log() << Log::ERROR << "Cut must be a scalar (use any(), all() or count() to reduce vectors)" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ExpressionSelector::ExecuteEvent()
+{
+
+  ++m_nEvents;
+
+  // compute derived variables
+  for (unsigned int i = 0; i < m_defines.size(); ++i) {
+    Define & define = m_defines[i];
+    if ( define.expression->Evaluate() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( define.vector ) define.vector->assign( define.expression->GetVector().begin() , define.expression->GetVector().end() );
+    else *define.scalar = define.expression->GetScalar();
+  }
+
+  // do selection
+  if ( m_cut ) {
+    if ( m_cut->Evaluate() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    const double pass = m_cut->GetScalar();
+    if ( pass == 0. || std::isnan(pass) ) return GLOBAL::SKIP;
+  }
+
+  // event passes selector
+  ++m_nPassed;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS ExpressionSelector::Finalise()
+{
+
+  log() << Log::INFO << "Finalising... (" << m_nPassed << " of " << m_nEvents << " events passed)" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
@@ -0,0 +1,185 @@
+// Standard Template Library includes
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+// Analysis includes
+#include "HistogramBook.h"
+#include "SelectorBase.h"
+#include "Store.h"
+
+
+HistogramBook::HistogramBook(SelectorBase & selector, const Store & config) :
+  m_selector(selector),
+  m_config(config)
+{
+
+}
+
+
+HistogramBook::~HistogramBook()
+{
+
+  for (unsigned int i = 0; i < m_histograms.size(); ++i) {
+    delete m_histograms[i].variable;
+    delete m_histograms[i].weight;
+    delete m_histograms[i].hist;
+  }
+
+}
+
+
+GLOBAL::STATUS HistogramBook::Book()
+{
+
+  std::vector<std::string> names;
+  m_config.getif<std::vector<std::string> >( m_selector.GetName() + "::histograms" , names );
+  for (unsigned int i = 0; i < names.size(); ++i) {
+
+    // get declaration from steer file
+    const std::string prefix = m_selector.GetName() + "::" + names[i] + "::";
+    std::string variable, weight, title = names[i];
+    std::vector<double> binning, edges;
+    Histogram hist;
+    hist.name = names[i];
+    m_config.getif<std::string>( prefix + "variable" , variable );
+    m_config.getif<std::string>( prefix + "weight"   , weight   );
+    m_config.getif<std::string>( prefix + "title"    , title    );
+    m_config.getif<std::vector<double> >( prefix + "binning" , binning );
+    m_config.getif<std::vector<double> >( prefix + "edges"   , edges   );
+
+    // check binning
+    if ( binning.size() == 3 && edges.empty() && binning[0] >= 1 && binning[2] > binning[1] ) {
+      hist.hist = new MultiHist( hist.name , title , static_cast<unsigned int>(binning[0]) , binning[1] , binning[2] );
+    }
+    else if ( binning.empty() && edges.size() >= 2 && std::adjacent_find(edges.begin(),edges.end(),std::greater_equal<double>()) == edges.end() ) {
+      hist.hist = new MultiHist( hist.name , title , edges );
+    }
+    else {
+      m_selector.log() << Log::ERROR << "Histogram \"" << hist.name << "\" needs either " << prefix << "binning (nBins low high) or "
+		       << prefix << "edges (increasing)" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+
+    // parse expressions
+    hist.variable = new Expression( prefix + "variable" , variable , m_selector.log().GetLevel() );
+    hist.weight   = weight.empty() ? 0 : new Expression( prefix + "weight" , weight , m_selector.log().GetLevel() );
+    m_histograms.push_back(hist);
+    if ( variable.empty() ) {
+      m_selector.log() << Log::ERROR << "Histogram \"" << hist.name << "\" needs " << prefix << "variable" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+    if ( hist.variable->Parse() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( hist.weight && hist.weight->Parse() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+    // criterion to stop the event loop early
+    double convergence = 0.;
+    int convergenceBin = -1;
+    m_config.getif<double>( prefix + "convergence"    , convergence    );
+    m_config.getif<int>   ( prefix + "convergenceBin" , convergenceBin );
+    if ( convergenceBin != -1 && ( convergenceBin < 0 || convergenceBin > static_cast<int>(hist.hist->GetNBins()) + 1 ) ) {
+      m_selector.log() << Log::ERROR << prefix << "convergenceBin = " << convergenceBin << " is out of range - must be between 0 (underflow) and "
+		       << hist.hist->GetNBins() + 1 << " (overflow), or -1 for the integral" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+    if ( convergence > 0. ) m_selector.AddConvergence( hist.name , hist.hist , convergence , convergenceBin );
+
+    m_selector.log() << Log::DEBUG << "Booked histogram \"" << hist.name << "\" of \"" << variable << "\" with " << hist.hist->GetNBins() << " bins" << Log::endl();
+
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS HistogramBook::BeginInputFile()
+{
+
+  for (unsigned int i = 0; i < m_histograms.size(); ++i) {
+    Histogram & hist = m_histograms[i];
+    if ( m_inputs.Connect( m_selector , *hist.variable ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( hist.weight && m_inputs.Connect( m_selector , *hist.weight ) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( hist.weight && hist.weight->IsVector() && ! hist.variable->IsVector() ) {
+      m_selector.log() << Log::ERROR << "Histogram \"" << hist.name << "\" has a vector weight for a scalar variable" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS HistogramBook::Stage()
+{
+
+  for (unsigned int i = 0; i < m_histograms.size(); ++i) {
+
+    Histogram & hist = m_histograms[i];
+    if ( hist.variable->Evaluate() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    if ( hist.weight && hist.weight->Evaluate() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    const double weight = hist.weight && ! hist.weight->IsVector() ? hist.weight->GetScalar() : 1.;
+
+    // scalar variable
+    if ( ! hist.variable->IsVector() ) {
+      const double value = hist.variable->GetScalar();
+      if ( std::isnan(value) ) continue;
+      hist.values.push_back(value);
+      hist.weights.push_back(weight);
+      continue;
+    }
+
+    // vector variable - one entry per element (NaN elements are dropped)
+    const std::vector<double> & values = hist.variable->GetVector();
+    const std::vector<double> * weights = hist.weight && hist.weight->IsVector() ? &hist.weight->GetVector() : 0;
+    if ( weights && weights->size() != values.size() ) {
+      m_selector.log() << Log::ERROR << "Histogram \"" << hist.name << "\" has " << values.size() << " values but " << weights->size()
+		       << " weights" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+    for (unsigned int k = 0; k < values.size(); ++k) {
+      if ( std::isnan(values[k]) ) continue;
+      hist.values.push_back(values[k]);
+      hist.weights.push_back(weights ? (*weights)[k] : weight);
+    }
+
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void HistogramBook::Flush()
+{
+
+  for (unsigned int i = 0; i < m_histograms.size(); ++i) {
+
+    Histogram & hist = m_histograms[i];
+    if ( hist.values.empty() ) continue;
+
+    // bin indices of batch, then weights added to bins
+    const std::size_t n = hist.values.size();
+    hist.bins.resize(n);
+    hist.hist->FindBins( hist.values.data() , hist.bins.data() , n );
+    for (std::size_t k = 0; k < n; ++k) hist.hist->FillBin( hist.bins[k] , hist.values[k] , &hist.weights[k] );
+
+    // clear batch
+    hist.values.clear();
+    hist.weights.clear();
+
+  }
+
+}
+
+
+void HistogramBook::Write()
+{
+
+  Flush();
+
+  // histograms are created in the current directory, which takes ownership
+  for (unsigned int i = 0; i < m_histograms.size(); ++i) m_histograms[i].hist->Write();
+
+}
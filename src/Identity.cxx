@@ -0,0 +1,53 @@
+// Standard Template Library includes
+#include <sstream>
+#include <iomanip>
+
+// POSIX includes
+#include <sys/stat.h>
+
+// Analysis includes
+#include "Identity.h"
+
+
+std::string IDENTITY::File(const std::string & fileName)
+{
+
+  struct stat info;
+  if ( stat(fileName.c_str(), &info) != 0 ) return "";
+
+  std::ostringstream identity;
+  identity << "file=" << fileName << ";size=" << info.st_size << ";mtime=" << info.st_mtime << ";inode=" << info.st_ino << ";";
+
+  return identity.str();
+
+}
+
+
+std::string IDENTITY::Build()
+{
+
+  struct stat info;
+  if ( stat("/proc/self/exe", &info) != 0 ) return "unknown";
+
+  std::ostringstream identity;
+  identity << "size=" << info.st_size << ",mtime=" << info.st_mtime;
+
+  return identity.str();
+
+}
+
+
+std::string IDENTITY::Hash(const std::string & text)
+{
+
+  unsigned long long hash = 14695981039346656037ULL; // FNV-1a
+  for (unsigned int i = 0; i < text.size(); ++i) {
+    hash ^= static_cast<unsigned char>(text[i]);
+    hash *= 1099511628211ULL;
+  }
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+  return name.str();
+
+}
@@ -0,0 +1,129 @@
+// Standard Template Library includes
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+// POSIX includes
+#include <sys/stat.h>
+
+// Analysis includes
+#include "IncrementalCache.h"
+#include "Identity.h"
+#include "Store.h"
+
+
+namespace {
+
+  // check if card file key doesn't change the results of an input file
+  bool IsIgnored(const std::string & key)
+  {
+    static const char * ignored[] = { "inputFileNames", "outputHistogramFileName", "outputNtupleFileName", "outputColumnarFileName",
+				      "useIncrementalCache", "incrementalCacheDirectory" };
+    const std::string name = key.substr( key.rfind("::") == std::string::npos ? 0 : key.rfind("::") + 2 );
+    for (unsigned int i = 0; i < sizeof(ignored) / sizeof(ignored[0]); ++i) {
+      if ( name == ignored[i] ) return true;
+    }
+    return false;
+  }
+
+}
+
+
+IncrementalCache::IncrementalCache(const std::string & directory, const Store & config, const Log::LEVEL & logLevel) :
+  m_directory(directory),
+  m_config(config),
+  m_log("IncrementalCache")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+  // create cache directory
+  if ( mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST ) {
+    m_log << Log::WARNING << "Couldn't create directory \"" << m_directory << "\"" << Log::endl();
+  }
+
+  // card file settings (lines "<type> <key> = <value>") and executable
+  std::istringstream lines( config.describe() );
+  std::string line;
+  while ( std::getline(lines,line) ) {
+    std::istringstream tokens(line);
+    std::string type, key;
+    tokens >> type >> key;
+    if ( ! IsIgnored(key) ) m_configIdentity += line + "\n";
+  }
+  m_configIdentity += "build=" + IDENTITY::Build() + ";";
+
+  config.getif<std::vector<std::string> >( "chains" , m_chains );
+
+}
+
+
+bool IncrementalCache::IsCached(const std::string & fileName) const
+{
+
+  // marker must belong to identity (the name is only a hash)
+  const std::string identity = Identity(fileName);
+  std::ifstream marker( ( GetBaseName(fileName) + ".done" ).c_str() );
+  if ( identity.empty() || ! marker.is_open() ) return false;
+  const std::string stored( (std::istreambuf_iterator<char>(marker)) , std::istreambuf_iterator<char>() );
+  if ( stored != identity ) return false;
+
+  m_log << Log::INFO << "Taking partial outputs of \"" << fileName << "\" from cache \"" << GetBaseName(fileName) << "\"" << Log::endl();
+
+  return true;
+
+}
+
+
+Store * IncrementalCache::CreateConfig(const std::string & fileName) const
+{
+
+  // same settings, with input file and partial outputs in cache
+  Store * config = new Store(m_config);
+  config->put<std::vector<std::string> >( "inputFileNames" , std::vector<std::string>(1,fileName) , true );
+  config->put<std::string>( "outputHistogramFileName" , GetHistogramFileName(fileName)   , true );
+  config->put<std::string>( "outputNtupleFileName"    , GetNtupleFileName(fileName,"")   , true );
+  for (unsigned int i = 0; i < m_chains.size(); ++i) {
+    config->put<std::string>( m_chains[i] + "::outputNtupleFileName" , GetNtupleFileName(fileName,m_chains[i]) , true );
+  }
+
+  return config;
+
+}
+
+
+GLOBAL::STATUS IncrementalCache::Commit(const std::string & fileName) const
+{
+
+  const std::string name = GetBaseName(fileName) + ".done";
+  std::ofstream marker( name.c_str() , std::ios::trunc );
+  marker << Identity(fileName);
+  marker.close();
+  if ( ! marker ) {
+    m_log << Log::ERROR << "Couldn't write \"" << name << "\"" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+std::string IncrementalCache::Identity(const std::string & fileName) const
+{
+
+  const std::string file = IDENTITY::File(fileName);
+
+  return file.empty() ? "" : file + "\n" + m_configIdentity;
+
+}
+
+
+std::string IncrementalCache::GetBaseName(const std::string & fileName) const
+{
+
+  return m_directory + "/" + fileName.substr(fileName.find_last_of('/') + 1) + "." + IDENTITY::Hash( Identity(fileName) );
+
+}
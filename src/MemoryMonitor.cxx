@@ -0,0 +1,114 @@
+// Standard Template Library includes
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+// POSIX includes
+#include <unistd.h>
+
+// Analysis includes
+#include "MemoryMonitor.h"
+
+
+namespace {
+
+  // bytes to MB
+  double MB(long bytes) { return bytes / ( 1024. * 1024. ); }
+
+}
+
+
+MemoryMonitor::MemoryMonitor(long budgetMB, bool enabled, const Log::LEVEL & logLevel) :
+  m_budget(budgetMB > 0 ? budgetMB * 1024 * 1024 : 0),
+  m_enabled(enabled),
+  m_sampling(enabled),
+  m_before(0),
+  m_peak(0),
+  m_exceeded(false),
+  m_log("MemoryMonitor")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+long MemoryMonitor::GetRSS()
+{
+
+  // second field of /proc/self/statm is the resident set in pages
+  static const long pageSize = sysconf(_SC_PAGESIZE);
+  FILE * file = std::fopen("/proc/self/statm", "r");
+  if ( ! file ) return 0;
+  long size = 0, resident = 0;
+  if ( std::fscanf(file, "%ld %ld", &size, &resident) != 2 ) resident = 0;
+  std::fclose(file);
+
+  return resident * pageSize;
+
+}
+
+
+unsigned int MemoryMonitor::AddComponent(const std::string & name)
+{
+
+  Component component;
+  component.name    = name;
+  component.growth  = 0;
+  component.peak    = 0;
+  component.samples = 0;
+  m_components.push_back(component);
+
+  return m_components.size() - 1;
+
+}
+
+
+void MemoryMonitor::Attribute(unsigned int index, long rss, unsigned int shares)
+{
+
+  Component & component = m_components[index];
+  if ( rss > m_before ) component.growth += ( rss - m_before ) / shares;
+  component.peak = std::max(component.peak, rss);
+  ++component.samples;
+  m_peak = std::max(m_peak, rss);
+
+  // warn once when budget is exceeded
+  if ( m_budget > 0 && rss > m_budget && ! m_exceeded ) {
+    m_exceeded = true;
+    m_log << Log::WARNING << "Resident memory (" << static_cast<long>(MB(rss)) << " MB) exceeds budget of " << static_cast<long>(MB(m_budget))
+	  << " MB after \"" << component.name << "\"" << Log::endl();
+  }
+
+}
+
+
+void MemoryMonitor::Report() const
+{
+
+  if ( ! m_enabled ) return;
+
+  // largest growth first
+  std::vector<const Component *> components;
+  for (unsigned int i = 0; i < m_components.size(); ++i) components.push_back( &m_components[i] );
+  std::stable_sort(components.begin(), components.end(), [](const Component * a, const Component * b) { return a->growth > b->growth; });
+
+  std::ostringstream summary;
+  summary << "Memory statistics (peak RSS " << std::fixed << std::setprecision(1) << MB(m_peak) << " MB";
+  if ( m_budget > 0 ) summary << ", budget " << MB(m_budget) << " MB";
+  m_log << Log::INFO << summary.str() << "):" << Log::endl();
+  std::ostringstream header;
+  header << std::setw(40) << std::left << "component" << std::right << std::setw(16) << "growth [MB]"
+	 << std::setw(18) << "peak RSS [MB]" << std::setw(12) << "samples";
+  m_log << Log::INFO << header.str() << Log::endl();
+  for (unsigned int i = 0; i < components.size(); ++i) {
+    const Component & component = *components[i];
+    std::ostringstream line;
+    line << std::setw(40) << std::left << component.name << std::right << std::fixed << std::setprecision(1)
+	 << std::setw(16) << MB(component.growth) << std::setw(18) << MB(component.peak) << std::setw(12) << component.samples;
+    m_log << Log::INFO << line.str() << Log::endl();
+  }
+
+}
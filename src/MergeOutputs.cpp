@@ -0,0 +1,52 @@
+// Standard Template Library includes
+#include <vector>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+// Analysis includes
+#include "OutputMerger.h"
+#include "Log.h"
+
+
+// Merges output files of sharded jobs (histograms.root, ntuple.root, ...) into one file (see OutputMerger.h).
+
+
+int Usage(Log & log) {
+
+  log << Log::INFO << "Usage :"                                                        << Log::endl();
+  log << Log::INFO << "   bin/MergeOutputs [-j nThreads] output.root input1.root ..."  << Log::endl();
+  log << Log::INFO << "This message :"                                                 << Log::endl();
+  log << Log::INFO << "   bin/MergeOutputs --help"                                     << Log::endl();
+
+  return 1;
+
+}
+
+
+int main(int argc, char** argv)
+{
+
+  // declare logger
+  Log log("MergeOutputs");
+
+  // read arguments
+  unsigned int nThreads = std::thread::hardware_concurrency();
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if ( args.size() >= 2 && args[0] == "-j" ) {
+    nThreads = std::atoi(args[1].c_str());
+    args.erase(args.begin(), args.begin() + 2);
+  }
+  if ( args.size() < 2 || args[0] == "--help" || args[0] == "-h" ) return Usage( log );
+  const std::string outputName = args[0];
+  const std::vector<std::string> inputs(args.begin() + 1, args.end());
+  if ( nThreads < 1 ) nThreads = 1;
+
+  // merge (output is removed if merging failed)
+  OutputMerger merger(nThreads, log.GetLevel());
+  if ( merger.Merge(outputName, inputs) != GLOBAL::SUCCESS ) return 1;
+  log << Log::INFO << "Done" << Log::endl();
+
+  return 0;
+
+}
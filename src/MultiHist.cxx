@@ -0,0 +1,126 @@
+// Standard Template Library includes
+#include <cmath>
+#include <algorithm>
+
+// ROOT includes
+#include "TH1D.h"
+
+// Analysis includes
+#include "MultiHist.h"
+
+
+MultiHist::MultiHist(const std::string & name, const std::string & title, unsigned int nBins, double low, double high,
+		     const std::vector<std::string> & variations) :
+  m_name(name),
+  m_title(title),
+  m_nBins(nBins),
+  m_low(low),
+  m_high(high),
+  m_scale(nBins / (high - low)),
+  m_variations(variations.empty() ? std::vector<std::string>(1) : variations),
+  m_sumw((nBins + 2) * m_variations.size(), 0.),
+  m_sumw2((nBins + 2) * m_variations.size(), 0.),
+  m_stats(4 * m_variations.size(), 0.),
+  m_entries(0.)
+{
+
+}
+
+
+MultiHist::MultiHist(const std::string & name, const std::string & title, const std::vector<double> & edges,
+		     const std::vector<std::string> & variations) :
+  m_name(name),
+  m_title(title),
+  m_nBins(edges.size() - 1),
+  m_low(edges.front()),
+  m_high(edges.back()),
+  m_scale(0.),
+  m_edges(edges),
+  m_variations(variations.empty() ? std::vector<std::string>(1) : variations),
+  m_sumw((m_nBins + 2) * m_variations.size(), 0.),
+  m_sumw2((m_nBins + 2) * m_variations.size(), 0.),
+  m_stats(4 * m_variations.size(), 0.),
+  m_entries(0.)
+{
+
+}
+
+
+unsigned int MultiHist::FindBin(double x) const
+{
+
+  if ( ! m_edges.empty() ) return std::upper_bound(m_edges.begin(), m_edges.end(), x) - m_edges.begin();
+
+  // in range, rounding may give nBins+1 just below the upper edge (NaN goes to overflow, as in ROOT)
+  return x < m_low ? 0 : ! ( x < m_high ) ? m_nBins + 1 : std::min( 1 + static_cast<unsigned int>( ( x - m_low ) * m_scale ) , m_nBins );
+
+}
+
+
+void MultiHist::FindBins(const double * x, unsigned int * bins, std::size_t n) const
+{
+
+  if ( ! m_edges.empty() ) {
+    const double * begin = m_edges.data();
+    const double * end   = begin + m_edges.size();
+    for (std::size_t k = 0; k < n; ++k) bins[k] = std::upper_bound(begin, end, x[k]) - begin;
+    return;
+  }
+
+  const double low = m_low, high = m_high, scale = m_scale;
+  const unsigned int nBins = m_nBins;
+  for (std::size_t k = 0; k < n; ++k) {
+    bins[k] = x[k] < low ? 0 : ! ( x[k] < high ) ? nBins + 1 : std::min( 1 + static_cast<unsigned int>( ( x[k] - low ) * scale ) , nBins );
+  }
+
+}
+
+
+void MultiHist::FillBin(unsigned int bin, double x, const double * weights)
+{
+
+  const std::size_t nVar = m_variations.size();
+  double * sumw  = &m_sumw [bin * nVar];
+  double * sumw2 = &m_sumw2[bin * nVar];
+  for (std::size_t v = 0; v < nVar; ++v) {
+    sumw [v] += weights[v];
+    sumw2[v] += weights[v] * weights[v];
+  }
+  m_entries += 1.;
+
+  // statistics only in range (as in ROOT)
+  if ( bin == 0 || bin > m_nBins ) return;
+  double * sw   = &m_stats[0];
+  double * sw2  = &m_stats[nVar];
+  double * swx  = &m_stats[2 * nVar];
+  double * swx2 = &m_stats[3 * nVar];
+  for (std::size_t v = 0; v < nVar; ++v) {
+    sw  [v] += weights[v];
+    sw2 [v] += weights[v] * weights[v];
+    swx [v] += weights[v] * x;
+    swx2[v] += weights[v] * x * x;
+  }
+
+}
+
+
+void MultiHist::Write() const
+{
+
+  const std::size_t nVar = m_variations.size();
+  for (std::size_t v = 0; v < nVar; ++v) {
+
+    const std::string name = m_variations[v].empty() ? m_name : m_name + "_" + m_variations[v];
+    TH1D * hist = m_edges.empty() ? new TH1D( name.c_str() , m_title.c_str() , m_nBins , m_low , m_high ) :
+                                    new TH1D( name.c_str() , m_title.c_str() , m_nBins , m_edges.data() );
+    for (unsigned int bin = 0; bin < m_nBins + 2; ++bin) {
+      hist->SetBinContent( bin , m_sumw [bin * nVar + v] );
+      hist->SetBinError  ( bin , std::sqrt( m_sumw2[bin * nVar + v] ) );
+    }
+    hist->SetEntries( m_entries );
+    double stats[4] = { m_stats[v] , m_stats[nVar + v] , m_stats[2 * nVar + v] , m_stats[3 * nVar + v] };
+    hist->PutStats( stats );
+
+  }
+
+}
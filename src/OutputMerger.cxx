@@ -0,0 +1,301 @@
+// Standard Template Library includes
+#include <cstring>
+#include <cstdio>
+
+// ROOT includes
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TDirectory.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TObjArray.h"
+#include "TClass.h"
+#include "TH1.h"
+
+// Analysis includes
+#include "OutputMerger.h"
+#include "ThreadPool.h"
+
+
+namespace {
+
+  // check if class is (or inherits from) base class
+  bool InheritsFrom(const std::string & className, const char * base)
+  {
+    TClass * cl = TClass::GetClass(className.c_str());
+    return cl && cl->InheritsFrom(base);
+  }
+
+}
+
+
+OutputMerger::OutputMerger(unsigned int nThreads, const Log::LEVEL & logLevel) :
+  m_nThreads(nThreads > 0 ? nThreads : 1),
+  m_output(0),
+  m_log("OutputMerger")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+OutputMerger::Content OutputMerger::GetContent(TDirectory * dir)
+{
+
+  Content content;
+  TIter next(dir->GetListOfKeys());
+  while ( TKey * key = static_cast<TKey *>(next()) ) content[key->GetName()] = key->GetClassName();
+
+  return content;
+
+}
+
+
+TDirectory * OutputMerger::GetDirectory(TDirectory * file, const std::string & path)
+{
+
+  return path.empty() ? file : file->GetDirectory(path.c_str());
+
+}
+
+
+std::string OutputMerger::GetSchema(TTree * tree)
+{
+
+  std::string schema;
+  TObjArray * branches = tree->GetListOfBranches();
+  for (Int_t i = 0; i < branches->GetEntriesFast(); ++i) {
+    TBranch * branch = static_cast<TBranch *>(branches->UncheckedAt(i));
+    TLeaf * leaf = branch->GetLeaf(branch->GetName());
+    schema += std::string(branch->GetName()) + ":" + ( std::strlen(branch->GetClassName()) > 0 ? branch->GetClassName() :
+						      leaf ? leaf->GetTypeName() : "?" ) + ";";
+  }
+
+  return schema;
+
+}
+
+
+void OutputMerger::Scan(TDirectory * dir, const std::string & path, std::vector<std::string> & directories, std::vector<std::string> & trees)
+{
+
+  directories.push_back(path);
+  const Content content = GetContent(dir);
+  for (Content::const_iterator iter = content.begin(); iter != content.end(); ++iter) {
+    const std::string child = path.empty() ? iter->first : path + "/" + iter->first;
+    if      ( InheritsFrom(iter->second,"TDirectory") ) Scan(dir->GetDirectory(iter->first.c_str()),child,directories,trees);
+    else if ( InheritsFrom(iter->second,"TTree") )      trees.push_back(child);
+  }
+
+}
+
+
+GLOBAL::STATUS OutputMerger::Merge(const std::string & outputName, const std::vector<std::string> & inputs)
+{
+
+  if ( inputs.empty() ) {
+    m_log << Log::ERROR << "No inputs to merge into \"" << outputName << "\"" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // tasks open their own copies of the input files, and histograms must not be attached to them
+  ROOT::EnableThreadSafety();
+  const bool addDirectory = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+
+  // structure is taken from first input
+  std::vector<std::string> directories, trees;
+  TFile * first = new TFile(inputs[0].c_str(),"read");
+  if ( ! first->IsOpen() ) {
+    m_log << Log::ERROR << "Couldn't open file \"" << inputs[0] << "\"" << Log::endl();
+    delete first;
+    TH1::AddDirectory(addDirectory);
+    return GLOBAL::ERROR;
+  }
+  Scan(first,"",directories,trees);
+  first->Close();
+  delete first;
+
+  // create output with the same directories
+  m_output = new TFile(outputName.c_str(),"recreate");
+  if ( ! m_output->IsOpen() ) {
+    m_log << Log::ERROR << "Couldn't open output file \"" << outputName << "\"" << Log::endl();
+    delete m_output;
+    m_output = 0;
+    TH1::AddDirectory(addDirectory);
+    return GLOBAL::ERROR;
+  }
+  for (unsigned int i = 1; i < directories.size(); ++i) {
+    const std::string & path = directories[i];
+    const std::string::size_type slash = path.rfind('/');
+    TDirectory * parent = GetDirectory(m_output, slash == std::string::npos ? "" : path.substr(0,slash));
+    parent->mkdir(path.substr(slash == std::string::npos ? 0 : slash + 1).c_str());
+  }
+  m_log << Log::INFO << "Merging " << inputs.size() << " files (" << directories.size() << " directories, " << trees.size()
+	<< " trees) into \"" << outputName << "\" with " << m_nThreads << " threads" << Log::endl();
+
+  // trees are merged first, since they take longest
+  std::vector<char> status(trees.size() + directories.size(), 0);
+  ThreadPool pool(m_nThreads);
+  pool.Run(status.size(), [&](unsigned int task) {
+      status[task] = task < trees.size() ? MergeTree(trees[task],inputs,outputName + ".tree" + std::to_string(task) + ".tmp") :
+	MergeDirectory(directories[task - trees.size()],inputs);
+    });
+
+  // save output (removed if merging failed)
+  m_output->Close();
+  delete m_output;
+  m_output = 0;
+  TH1::AddDirectory(addDirectory);
+  for (unsigned int i = 0; i < status.size(); ++i) {
+    if ( ! status[i] ) {
+      m_log << Log::ERROR << "Merging failed - removing \"" << outputName << "\"" << Log::endl();
+      std::remove(outputName.c_str());
+      return GLOBAL::ERROR;
+    }
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+bool OutputMerger::MergeDirectory(const std::string & path, const std::vector<std::string> & inputs)
+{
+
+  Content reference;
+  std::map<std::string,TObject *> merged;
+  bool ok = true;
+  for (unsigned int i = 0; ok && i < inputs.size(); ++i) {
+
+    TFile * file = new TFile(inputs[i].c_str(),"read");
+    TDirectory * dir = file->IsOpen() ? GetDirectory(file,path) : 0;
+    const Content content = dir ? GetContent(dir) : Content();
+    if ( i == 0 ) reference = content;
+
+    // check structure against first input
+    if ( ! dir || content != reference ) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_log << Log::ERROR << "Directory \"" << path << "\" in \"" << inputs[i] << "\" is missing or has different content than in \""
+	    << inputs[0] << "\"" << Log::endl();
+      ok = false;
+    }
+
+    // sum histograms
+    for (Content::const_iterator iter = content.begin(); ok && iter != content.end(); ++iter) {
+      if ( InheritsFrom(iter->second,"TDirectory") || InheritsFrom(iter->second,"TTree") ) continue;
+      TObject * object = dir->Get(iter->first.c_str());
+      if ( i == 0 ) {
+	merged[iter->first] = object->Clone(iter->first.c_str());
+	if ( TH1 * hist = dynamic_cast<TH1 *>(merged[iter->first]) ) hist->SetDirectory(0);
+      }
+      else if ( TH1 * hist = dynamic_cast<TH1 *>(merged[iter->first]) ) {
+	if ( ! hist->Add(static_cast<TH1 *>(object)) ) {
+	  std::lock_guard<std::mutex> lock(m_mutex);
+	  m_log << Log::ERROR << "Histogram \"" << iter->first << "\" in directory \"" << path << "\" of \"" << inputs[i]
+		<< "\" has incompatible binning" << Log::endl();
+	  ok = false;
+	}
+      }
+
+      // objects read are owned by us (histograms are not attached to the file)
+      delete object;
+    }
+
+    file->Close();
+    delete file;
+
+  }
+
+  // write merged objects
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TDirectory * dir = GetDirectory(m_output,path);
+    std::map<std::string,TObject *>::iterator iter = merged.begin();
+    for ( ; iter != merged.end(); ++iter) {
+      if ( ok ) dir->WriteTObject(iter->second,iter->first.c_str());
+      delete iter->second;
+    }
+    if ( ok ) m_log << Log::DEBUG << "Merged directory \"" << path << "\" (" << merged.size() << " objects)" << Log::endl();
+  }
+
+  return ok;
+
+}
+
+
+bool OutputMerger::MergeTree(const std::string & path, const std::vector<std::string> & inputs, const std::string & tempName)
+{
+
+  // the inputs are copied into a temporary file of this task, so trees are merged in parallel. Only
+  // the final copy into the shared output holds the lock
+  const std::string::size_type slash = path.rfind('/');
+  const std::string dirPath = slash == std::string::npos ? "" : path.substr(0,slash);
+  TFile * temp = new TFile(tempName.c_str(),"recreate");
+  TTree * merged = 0;
+  std::string schema;
+  bool ok = temp->IsOpen();
+  if ( ! ok ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_log << Log::ERROR << "Couldn't open temporary file \"" << tempName << "\"" << Log::endl();
+  }
+  for (unsigned int i = 0; ok && i < inputs.size(); ++i) {
+
+    TFile * file = new TFile(inputs[i].c_str(),"read");
+    TTree * tree = file->IsOpen() ? static_cast<TTree *>( file->Get(path.c_str()) ) : 0;
+    if ( ! tree ) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_log << Log::ERROR << "Tree \"" << path << "\" is missing in \"" << inputs[i] << "\"" << Log::endl();
+      ok = false;
+    }
+    else if ( i == 0 ) {
+
+      // empty copy of first tree in temporary file
+      schema = GetSchema(tree);
+      temp->cd();
+      merged = tree->CloneTree(0);
+
+    }
+    else if ( GetSchema(tree) != schema ) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_log << Log::ERROR << "Tree \"" << path << "\" in \"" << inputs[i] << "\" has different branches than in \"" << inputs[0] << "\"" << Log::endl();
+      ok = false;
+    }
+    if ( ok && merged->CopyEntries(tree,-1,"fast") < 0 ) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_log << Log::ERROR << "Couldn't copy tree \"" << path << "\" from \"" << inputs[i] << "\"" << Log::endl();
+      ok = false;
+    }
+
+    file->Close();
+    delete file;
+
+  }
+
+  // copy merged tree into output (baskets are copied without decompressing them)
+  if ( ok ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    GetDirectory(m_output,dirPath)->cd();
+    TTree * output = merged->CloneTree(-1,"fast");
+    if ( ! output ) {
+      m_log << Log::ERROR << "Couldn't copy tree \"" << path << "\" to output" << Log::endl();
+      ok = false;
+    }
+    else {
+      output->Write();
+      m_log << Log::INFO << "Merged tree \"" << path << "\" (" << output->GetEntries() << " entries)" << Log::endl();
+    }
+  }
+
+  temp->Close();
+  delete temp;
+  std::remove(tempName.c_str());
+
+  return ok;
+
+}
@@ -0,0 +1,235 @@
+// Standard Template Library includes
+#include <cstdio>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+
+// POSIX includes
+#include <sys/stat.h>
+
+// ROOT includes
+#include "TDirectory.h"
+#include "TH1D.h"
+
+// Analysis includes
+#include "PassCache.h"
+#include "SelectorBase.h"
+#include "Store.h"
+#include "Identity.h"
+
+
+namespace {
+
+  // tag at start of bitmap files
+  const char MAGIC[8] = { 'A', 'M', 'P', 'A', 'S', 'S', '0', '1' };
+
+}
+
+
+PassCache::PassCache(const std::string & directory, bool ignoreBuild, const Log::LEVEL & logLevel) :
+  m_directory(directory),
+  m_build(ignoreBuild ? "" : IDENTITY::Build()),
+  m_nFiles(0),
+  m_useEntryList(false),
+  m_log("PassCache")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+  // create cache directory
+  if ( mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST ) {
+    m_log << Log::WARNING << "Couldn't create directory \"" << m_directory << "\"" << Log::endl();
+  }
+
+}
+
+
+void PassCache::AddChain(const std::vector<SelectorBase *> & selectors, const Store & config)
+{
+
+  Chain chain;
+  chain.selectors = selectors;
+  chain.nSkipped  = 0;
+
+  // identity of selector i includes all selectors before it
+  std::string key = "build=" + m_build + ";";
+  for (unsigned int i = 0; i < selectors.size(); ++i) {
+    const std::string & name = selectors[i]->GetName();
+    key += "selector=" + name + "{" + config.describe(name + "::") + "};";
+    chain.keys.push_back(key);
+  }
+  chain.bitmaps.resize(selectors.size());
+  chain.nFilesSkipped.resize(selectors.size(), 0);
+
+  m_chains.push_back(chain);
+
+}
+
+
+GLOBAL::STATUS PassCache::NewInputFile(const std::string & fileName, const std::string & treeName, long nEntries)
+{
+
+  m_fileName = fileName;
+  m_fileIdentity.clear();
+  ++m_nFiles;
+  m_useEntryList = false;
+  m_entryList.Reset(nEntries);
+
+  // input file is identified by name, size, modification time and inode
+  const std::string identity = IDENTITY::File(fileName);
+  if ( ! identity.empty() ) {
+    std::ostringstream tree;
+    tree << "tree=" << treeName << ";entries=" << nEntries << ";";
+    m_fileIdentity = identity + tree.str();
+  }
+  else m_log << Log::WARNING << "Couldn't determine identity of \"" << fileName << "\" - bitmaps will not be used" << Log::endl();
+
+  // find bitmaps of leading selectors (selectors with outputs must run)
+  bool readAll = false;
+  for (unsigned int ichain = 0; ichain < m_chains.size(); ++ichain) {
+
+    Chain & chain = m_chains[ichain];
+    chain.nSkipped = 0;
+    chain.passed.Reset(0);
+    for (unsigned int i = 0; i < chain.bitmaps.size(); ++i) chain.bitmaps[i].Reset(nEntries);
+    if ( m_fileIdentity.empty() ) {
+      readAll = true;
+      continue;
+    }
+
+    PassBitmap bitmap;
+    while ( chain.nSkipped < chain.selectors.size() && chain.selectors[chain.nSkipped]->GetOutputs().empty() &&
+	    Load(m_fileIdentity + chain.keys[chain.nSkipped], bitmap) ) {
+      chain.passed = bitmap;
+      ++chain.nSkipped;
+    }
+
+    if ( chain.nSkipped == 0 ) {
+      readAll = true;
+      continue;
+    }
+    m_entryList.Merge(chain.passed);
+    m_log << Log::INFO << "Skipping " << chain.nSkipped << " selectors (up to \"" << chain.selectors[chain.nSkipped - 1]->GetName()
+	  << "\") for \"" << fileName << "\" - " << chain.passed.Count() << " of " << nEntries << " entries passed them" << Log::endl();
+    for (unsigned int i = 0; i < chain.nSkipped; ++i) {
+      ++chain.nFilesSkipped[i];
+      m_log << Log::WARNING << "Selector \"" << chain.selectors[i]->GetName() << "\" is skipped for \"" << fileName
+	    << "\" - its own histograms and Store objects are not filled for this file" << Log::endl();
+    }
+
+  }
+
+  // read only entries passing the skipped selectors of all chains
+  m_useEntryList = ! readAll && ! m_chains.empty();
+  if ( ! m_useEntryList ) m_entryList.Reset(0);
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS PassCache::EndInputFile(bool complete)
+{
+
+  if ( m_fileIdentity.empty() ) return GLOBAL::SUCCESS;
+  if ( ! complete ) {
+    m_log << Log::INFO << "Not all entries were processed - bitmaps for \"" << m_fileName << "\" are not written" << Log::endl();
+    return GLOBAL::SUCCESS;
+  }
+
+  for (unsigned int ichain = 0; ichain < m_chains.size(); ++ichain) {
+    const Chain & chain = m_chains[ichain];
+    for (unsigned int i = chain.nSkipped; i < chain.selectors.size(); ++i) {
+      if ( Save(m_fileIdentity + chain.keys[i], chain.bitmaps[i]) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+    }
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+std::string PassCache::FileName(const std::string & identity) const
+{
+
+  return m_directory + "/" + m_fileName.substr(m_fileName.find_last_of('/') + 1) + "." + IDENTITY::Hash(identity) + ".ampass";
+
+}
+
+
+bool PassCache::Load(const std::string & identity, PassBitmap & bitmap) const
+{
+
+  std::ifstream file( FileName(identity).c_str() , std::ios::binary );
+  if ( ! file.is_open() ) return false;
+
+  // check that file belongs to identity (the name is only a hash)
+  char magic[sizeof(MAGIC)];
+  uint64_t length = 0, nEntries = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char *>(&length), sizeof(length));
+  if ( ! file || std::string(magic, sizeof(magic)) != std::string(MAGIC, sizeof(MAGIC)) || length != identity.size() ) return false;
+  std::string stored(length, '\0');
+  file.read(&stored[0], length);
+  file.read(reinterpret_cast<char *>(&nEntries), sizeof(nEntries));
+  if ( ! file || stored != identity ) return false;
+
+  bitmap.Reset(nEntries);
+  std::vector<uint64_t> & words = bitmap.GetWords();
+  file.read(reinterpret_cast<char *>(words.data()), words.size() * sizeof(uint64_t));
+  if ( ! file ) {
+    m_log << Log::WARNING << "Bitmap file \"" << FileName(identity) << "\" is truncated - ignoring it" << Log::endl();
+    return false;
+  }
+
+  return true;
+
+}
+
+
+GLOBAL::STATUS PassCache::Save(const std::string & identity, const PassBitmap & bitmap) const
+{
+
+  // write to temporary file first, so an interrupted run leaves no partial bitmap
+  const std::string name = FileName(identity);
+  const std::string tmpName = name + ".tmp";
+  std::ofstream file( tmpName.c_str() , std::ios::binary | std::ios::trunc );
+  const uint64_t length = identity.size(), nEntries = bitmap.GetSize();
+  const std::vector<uint64_t> & words = bitmap.GetWords();
+  file.write(MAGIC, sizeof(MAGIC));
+  file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+  file.write(identity.data(), length);
+  file.write(reinterpret_cast<const char *>(&nEntries), sizeof(nEntries));
+  file.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+  file.close();
+  if ( ! file || std::rename(tmpName.c_str(), name.c_str()) != 0 ) {
+    m_log << Log::ERROR << "Couldn't write bitmap file \"" << name << "\"" << Log::endl();
+    std::remove(tmpName.c_str());
+    return GLOBAL::ERROR;
+  }
+
+  m_log << Log::DEBUG << "Wrote bitmap file \"" << name << "\" (" << bitmap.Count() << " of " << nEntries << " entries)" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void PassCache::Annotate(unsigned int chain, unsigned int selector, TDirectory * dir) const
+{
+
+  const unsigned int nFilesSkipped = m_chains.at(chain).nFilesSkipped.at(selector);
+  if ( nFilesSkipped == 0 ) return;
+
+  TDirectory * current = TDirectory::CurrentDirectory();
+  dir->cd();
+  TH1D * hist = new TH1D( "passCacheSkipped" , "input files where selector was skipped (bin 1) and input files (bin 2)" , 2 , 0. , 2. );
+  hist->SetBinContent( 1 , nFilesSkipped );
+  hist->SetBinContent( 2 , m_nFiles );
+  if ( current ) current->cd();
+
+  m_log << Log::WARNING << "Selector \"" << m_chains.at(chain).selectors.at(selector)->GetName() << "\" was skipped for " << nFilesSkipped
+	<< " of " << m_nFiles << " input files - its own histograms only include the other files" << Log::endl();
+
+}
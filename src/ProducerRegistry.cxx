@@ -0,0 +1,53 @@
+// Standard Template Library includes
+#include <iomanip>
+#include <sstream>
+
+// Analysis includes
+#include "ProducerRegistry.h"
+
+
+ProducerRegistry::ProducerRegistry(const Log::LEVEL & logLevel) :
+  m_event(0),
+  m_failed(false),
+  m_log("ProducerRegistry")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+}
+
+
+ProducerRegistry::~ProducerRegistry()
+{
+
+  std::map<std::string,ProducerBase *>::iterator it = m_producers.begin();
+  for ( ; it != m_producers.end(); ++it) delete it->second;
+  m_producers.clear();
+
+}
+
+
+void ProducerRegistry::Report()
+{
+
+  if ( m_producers.empty() ) return;
+
+  m_log << Log::INFO << std::setw(30) << std::left << "Producer" 
+	<< std::setw(12) << std::right << "hits" << std::setw(12) << "misses" 
+	<< std::setw(12) << "hit rate" << std::setw(12) << "total [s]" << std::setw(14) << "per miss [us]" << Log::endl();
+
+  std::map<std::string,ProducerBase *>::const_iterator it = m_producers.begin();
+  for ( ; it != m_producers.end(); ++it) {
+    const ProducerBase * producer = it->second;
+    const unsigned long requests = producer->GetHits() + producer->GetMisses();
+    std::ostringstream line;
+    line << std::setw(30) << std::left << producer->GetName() 
+	 << std::setw(12) << std::right << producer->GetHits() << std::setw(12) << producer->GetMisses() 
+	 << std::setw(12) << std::fixed << std::setprecision(3) << (requests ? static_cast<double>(producer->GetHits())/requests : 0.) 
+	 << std::setw(12) << producer->GetSeconds() 
+	 << std::setw(14) << (producer->GetMisses() ? 1e6*producer->GetSeconds()/producer->GetMisses() : 0.);
+    m_log << Log::INFO << line.str() << Log::endl();
+  }
+
+}
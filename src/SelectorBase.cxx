@@ -11,7 +11,8 @@ SelectorBase::SelectorBase(const std::string & name, const Store & config, Servi
   m_config(config), 
   m_name(name),
   m_service(service),
-  m_log(name)
+  m_log(name),
+  m_isCut(true)
 {
 
   // set log level
@@ -89,9 +90,13 @@ GLOBAL::STATUS SelectorBase::EndInputFile()
 SelectorBase * SelectorBase::CreateSelector(const std::string & name, const Store & config, Service & service) 
 {
 
+  // type of selector is its name, unless given in the card file (several instances of the same type)
+  std::string type = name;
+  config.getif<std::string>( name + "::type" , type );
+
   // declare selector
   SelectorBase * pointer = 0;
-  CREATE_SELECTOR(name,config,service,pointer);
+  CREATE_SELECTOR(type,name,config,service,pointer);
 
   return pointer;
 
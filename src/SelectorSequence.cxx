@@ -0,0 +1,188 @@
+// Standard Template Library includes
+#include <set>
+#include <string>
+#include <algorithm>
+#include <sstream>
+
+// ROOT includes
+#include "TROOT.h"
+
+// Analysis includes
+#include "SelectorSequence.h"
+#include "SelectorBase.h"
+#include "ThreadPool.h"
+#include "MemoryMonitor.h"
+#include "AllocationProfiler.h"
+#include "Tracer.h"
+
+
+namespace {
+
+  // check if two sets share an element
+  bool Overlap(const std::set<std::string> & a, const std::set<std::string> & b)
+  {
+    std::set<std::string>::const_iterator ia = a.begin(), ib = b.begin();
+    while ( ia != a.end() && ib != b.end() ) {
+      if      ( *ia < *ib ) ++ia;
+      else if ( *ib < *ia ) ++ib;
+      else return true;
+    }
+    return false;
+  }
+
+}
+
+
+SelectorSequence::SelectorSequence(const std::vector<SelectorBase *> & selectors, unsigned int nThreads, const Log::LEVEL & logLevel) :
+  m_selectors(selectors),
+  m_status(selectors.size(), GLOBAL::SUCCESS),
+  m_nPassed(0),
+  m_nSkipped(0),
+  m_pool(0),
+  m_memory(0),
+  m_allocationContexts(selectors.size(), 0),
+  m_traceNames(selectors.size(), 0),
+  m_log("SelectorSequence")
+{
+
+  // set log level
+  m_log.SetLevel(logLevel);
+
+  // start threads
+  if ( nThreads > 1 ) {
+    ROOT::EnableThreadSafety();
+    m_pool = new ThreadPool(nThreads);
+    m_log << Log::INFO << "Running selectors on " << nThreads << " threads" << Log::endl();
+  }
+
+  // until scheduled, run selectors one by one
+  for (unsigned int i = 0; i < m_selectors.size(); ++i) m_levels.push_back( std::vector<unsigned int>(1,i) );
+
+}
+
+
+SelectorSequence::~SelectorSequence()
+{
+
+  delete m_pool;
+
+}
+
+
+bool SelectorSequence::DependsOn(unsigned int j, unsigned int i) const
+{
+
+  const SelectorBase * earlier = m_selectors.at(i);
+  const SelectorBase * later   = m_selectors.at(j);
+
+  return earlier->IsCut() ||
+    Overlap(earlier->GetOutputs(), later->GetInputs()) ||
+    Overlap(earlier->GetInputs(), later->GetOutputs()) ||
+    Overlap(earlier->GetOutputs(), later->GetOutputs());
+
+}
+
+
+GLOBAL::STATUS SelectorSequence::Schedule()
+{
+
+  // without threads, selectors run one by one in sequence order
+  if ( ! m_pool ) return GLOBAL::SUCCESS;
+
+  // level of a selector is one above the highest level of the selectors it depends on
+  std::vector<unsigned int> level(m_selectors.size(), 0);
+  unsigned int nLevels = 0;
+  for (unsigned int j = 0; j < m_selectors.size(); ++j) {
+    for (unsigned int i = 0; i < j; ++i) {
+      if ( DependsOn(j,i) ) level[j] = std::max(level[j], level[i] + 1);
+    }
+    nLevels = std::max(nLevels, level[j] + 1);
+  }
+
+  m_levels.assign(nLevels, std::vector<unsigned int>());
+  for (unsigned int j = 0; j < m_selectors.size(); ++j) m_levels[ level[j] ].push_back(j);
+
+  for (unsigned int l = 0; l < m_levels.size(); ++l) {
+    std::ostringstream names;
+    for (unsigned int k = 0; k < m_levels[l].size(); ++k) names << " " << m_selectors.at( m_levels[l][k] )->GetName();
+    m_log << Log::DEBUG << "Level " << l << " :" << names.str() << Log::endl();
+  }
+  m_log << Log::INFO << "Scheduled " << m_selectors.size() << " selectors in " << m_levels.size() << " levels" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void SelectorSequence::SetMemoryMonitor(MemoryMonitor * monitor, const std::vector<unsigned int> & components)
+{
+
+  m_memory           = monitor;
+  m_memoryComponents = components;
+
+}
+
+
+GLOBAL::STATUS SelectorSequence::ExecuteEvent()
+{
+
+  // run one selector after the other
+  if ( ! m_pool ) {
+    for (m_nPassed = m_nSkipped; m_nPassed < m_selectors.size(); ++m_nPassed) {
+      AllocationProfiler::Scope scope( m_allocationContexts[m_nPassed] );
+      Tracer::Span span( m_traceNames[m_nPassed] );
+      if ( m_memory ) m_memory->Begin();
+      GLOBAL::STATUS status = m_selectors[m_nPassed]->ExecuteEvent();
+      if ( m_memory ) m_memory->End( m_memoryComponents[m_nPassed] );
+      if ( status != GLOBAL::SUCCESS ) return status;
+    }
+    return GLOBAL::SUCCESS;
+  }
+
+  // run selectors level by level, and join after each level (selectors that don't run are skipped)
+  m_status.assign(m_selectors.size(), GLOBAL::SKIP);
+  std::fill(m_status.begin(), m_status.begin() + m_nSkipped, GLOBAL::SUCCESS);
+  m_nPassed = 0;
+  for (unsigned int l = 0; l < m_levels.size(); ++l) {
+
+    const std::vector<unsigned int> & level = m_levels[l];
+    if ( level.size() == 1 ) {
+      AllocationProfiler::Scope scope( m_allocationContexts[ level[0] ] );
+      Tracer::Span span( m_traceNames[ level[0] ] );
+      if ( level[0] >= m_nSkipped ) {
+	if ( m_memory ) m_memory->Begin();
+	m_status[ level[0] ] = m_selectors[ level[0] ]->ExecuteEvent();
+	if ( m_memory ) m_memory->End( m_memoryComponents[ level[0] ] );
+      }
+    }
+    else {
+      if ( m_memory ) m_memory->Begin();
+      m_pool->Run(level.size(), [this,&level](unsigned int k) { 
+	  AllocationProfiler::Scope scope( m_allocationContexts[ level[k] ] );
+	  Tracer::Span span( m_traceNames[ level[k] ] );
+	  if ( level[k] >= m_nSkipped ) m_status[ level[k] ] = m_selectors[ level[k] ]->ExecuteEvent(); 
+	});
+
+      // memory of level is shared by the selectors that ran in it
+      if ( m_memory && m_memory->IsSampling() ) {
+	m_levelComponents.clear();
+	for (unsigned int k = 0; k < level.size(); ++k) {
+	  if ( level[k] >= m_nSkipped ) m_levelComponents.push_back( m_memoryComponents[ level[k] ] );
+	}
+	m_memory->End( m_levelComponents );
+      }
+    }
+
+    // stop at first selector (in sequence order) that didn't pass
+    for (unsigned int k = 0; k < level.size(); ++k) {
+      if ( m_status[ level[k] ] == GLOBAL::SUCCESS ) continue;
+      while ( m_status[m_nPassed] == GLOBAL::SUCCESS ) ++m_nPassed;
+      return m_status[ level[k] ];
+    }
+
+  }
+  m_nPassed = m_selectors.size();
+
+  return GLOBAL::SUCCESS;
+
+}
@@ -1,49 +1,105 @@
+// Standard Template Library includes
+#include <algorithm>
+
 // ROOT includes
 #include "TTree.h"
 #include "TFile.h"
 #include "TH1D.h"
+#include "TROOT.h"
 
 // Analysis includes
 #include "Service.h"
+#include "ViewBase.h"
+#include "ColumnCache.h"
+#include "ColumnOutput.h"
+#include "FieldBase.h"
+#include "Snapshot.h"
+#include "EventPipeline.h"
+#include "BulkReader.h"
+#include "Tracer.h"
 #include "Enums.h"
 
 
 Service::Service(const Log::LEVEL & logLevel) : 
+  m_activeChain(0),
   m_treeName("tree"),
   m_inTree(0), 
-  m_outTree(0),
+  m_entryList(0),
+  m_convergence(logLevel),
+  m_inputCacheSize(0),
+  m_outputFlushSize(0),
   m_counter(0),
   m_nEvents(0),
+  m_cache(0),
+  m_bulk(0),
+  m_pipeline(0),
+  m_event(0),
+  m_eventStatus(GLOBAL::SUCCESS),
   m_log("Service")
 {
 
   // set log level
   m_log.SetLevel(logLevel);
 
+  // default chain
+  AddChain("");
+
 }
 
 
 Service::~Service() 
 {
 
+  // finish column cache of last input file
+  delete m_cache;
+
+  // report baskets read in bulk
+  delete m_bulk;
+
+  // stop pipeline
+  delete m_pipeline;
+
+  // delete chains (columnar output, buffers of new variables and derived quantities)
+  ClearChains();
+
+  // delete copies of input variables
+  std::map<std::string,SnapshotBase *>::iterator snapshot = m_snapshots.begin();
+  for ( ; snapshot != m_snapshots.end(); ++snapshot) delete snapshot->second;
+  m_snapshots.clear();
+
   // close input files
   for (unsigned int ifile = 0; ifile < m_inFiles.size(); ++ifile) {
     m_inFiles.at(ifile)->Close();
     delete m_inFiles.at(ifile);
   }  
 
+  // delete views
+  std::map<std::string,ViewBase *>::iterator iter = m_views.begin();
+  for ( ; iter != m_views.end(); ++iter) delete iter->second;
+  m_views.clear();
+
 }
 
 
 GLOBAL::STATUS Service::PrepareOutTree()
 {
 
-  // initialise output tree
-  if ( m_outTree ) {
+  // initialise output tree of active chain
+  ChainState & chain = m_chains[m_activeChain];
+  if ( chain.outTree ) {
     m_log << Log::ERROR << "Output tree already initialised!" << Log::endl();
     return GLOBAL::ERROR;
   }
-  m_outTree = new TTree(m_treeName.c_str(),m_treeName.c_str());
+
+  // no output tree needed if output is disabled
+  if ( ! chain.hasOutput ) {
+    m_log << Log::INFO << "Output disabled - not preparing output tree" << Log::endl();
+    return GLOBAL::SUCCESS;
+  }
+  chain.outTree = new TTree(m_treeName.c_str(),m_treeName.c_str());
+
+  // flush baskets once they hold given number of bytes (negative auto-flush)
+  if ( m_outputFlushSize > 0 ) chain.outTree->SetAutoFlush(-m_outputFlushSize);
 
   return GLOBAL::SUCCESS;
   
@@ -89,8 +145,22 @@ GLOBAL::STATUS Service::PrepareInput(const std::vector<std::string> & inFileName
 GLOBAL::STATUS Service::NextInTree()
 {
   
+  // finish previous input tree
+  if ( FinishInTree() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
   // reset input tree
-  m_inTree = 0;
+  m_inTree    = 0;
+  m_entryList = 0;
+
+  // detach views from previous tree (selectors re-connect them in BeginInputFile)
+  std::map<std::string,ViewBase *>::iterator iter = m_views.begin();
+  for ( ; iter != m_views.end(); ++iter) iter->second->Release();
+
+  // forget copies of input variables (selectors re-connect them in BeginInputFile)
+  m_protected.clear();
+  std::map<std::string,SnapshotBase *>::iterator snapshot = m_snapshots.begin();
+  for ( ; snapshot != m_snapshots.end(); ++snapshot) delete snapshot->second;
+  m_snapshots.clear();
   
   // check index
   if ( m_counter < 0 || m_counter > m_inFiles.size() ) {
@@ -110,9 +180,443 @@ GLOBAL::STATUS Service::NextInTree()
 
   // disable all branches (later, used branches will be activated by selectors)
   m_inTree->SetBranchStatus("*",0);
+  if ( m_inputCacheSize > 0 ) m_inTree->SetCacheSize(m_inputCacheSize);
+
+  // finish column cache of previous input file
+  if ( m_cache ) {
+    Tracer::Span span( Tracer::AddName( "column cache: new input file" ) );
+    if ( m_cache->NewInputFile(m_inTree,file->GetName()) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  }
+
+  // forget variables read in bulk from previous input file (selectors re-connect them in BeginInputFile)
+  if ( m_bulk ) m_bulk->NewInputFile(m_inTree);
+
+  // bind typed event model (its members are shared by selectors connecting the same branches)
+  if ( BindEvent() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
  
   m_log << Log::INFO << "Loaded tree \"" << m_treeName << "\"in file \"" << file->GetName() << "\"" << Log::endl();
   
   return GLOBAL::SUCCESS;
 
 }
+
+
+GLOBAL::STATUS Service::BindEvent()
+{
+
+  if ( ! m_bindEvent ) return GLOBAL::SUCCESS;
+
+  // bind all members at once (declaring them in the output trees changes the active chain)
+  const unsigned int activeChain = m_activeChain;
+  m_eventStatus = GLOBAL::SUCCESS;
+  m_bindEvent();
+  m_activeChain = activeChain;
+
+  if ( m_eventStatus != GLOBAL::SUCCESS ) m_log << Log::ERROR << "Couldn't bind event to input tree - check the schema (cards/eventSchema)" << Log::endl();
+  else m_log << Log::DEBUG << "Bound event to input tree" << Log::endl();
+
+  return m_eventStatus;
+
+}
+
+
+GLOBAL::STATUS Service::PrepareColumnCache()
+{
+
+  if ( m_cache->Prepare() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  if ( ! m_cache->IsReading() ) return GLOBAL::SUCCESS;
+
+  // vectors only read through views are not copied from the cache - the views are mapped onto it
+  // instead (unless the vectors are written to an output)
+  for (unsigned int i = 0; i < m_chains.size(); ++i) {
+    if ( m_chains[i].hasOutput ) return GLOBAL::SUCCESS;
+  }
+  std::map<std::string,ViewBase *>::const_iterator iter = m_views.begin();
+  for ( ; iter != m_views.end(); ++iter) {
+    if ( m_directInputs.find(iter->first) == m_directInputs.end() ) m_cache->SkipRead(iter->first);
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void Service::TrackDirectInput(const char* _keyword, const void * _ptr)
+{
+
+  std::map<std::string,ViewBase *>::const_iterator iter = m_views.find(_keyword);
+  if ( iter != m_views.end() && iter->second->MapsSource(_ptr) ) return;
+
+  m_directInputs.insert(_keyword);
+
+}
+
+
+GLOBAL::STATUS Service::GetEntry(long entry)
+{
+
+  // decide whether to read or write column cache, or start pipeline (all variables are connected by the first entry)
+  if ( m_cache && ! m_cache->IsPrepared() && PrepareColumnCache() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  if ( m_pipeline && ! m_pipeline->IsPrepared() && StartPipeline() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  if ( m_bulk && ! m_bulk->IsPrepared() && m_bulk->Prepare() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+  const bool readCache = m_cache && m_cache->IsReading();
+
+  if ( m_pipeline && m_pipeline->IsRunning() ) {
+
+    // take entry from pipeline (read by reader thread)
+    if ( m_pipeline->Next(entry) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  }
+  else if ( readCache ) {
+
+    // read entry from column cache (input tree is not touched)
+    if ( m_cache->Read(entry) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  }
+  else {
+
+    // read entry from input tree
+    if ( m_inTree->GetEntry(entry) < 0 ) {
+      m_log << Log::ERROR << "Couldn't read entry " << entry << " from input tree" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+
+    // copy entry of branches read in bulk
+    if ( m_bulk && m_bulk->Read(entry) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+    // copy entry to column cache
+    if ( m_cache && m_cache->IsWriting() && m_cache->Write(entry) != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  }
+
+  // invalidate derived quantities of previous entry
+  for (unsigned int i = 0; i < m_chains.size(); ++i) m_chains[i].producers->NewEvent();
+
+  // refresh views derived from branches in input tree (pointing them into the cache if possible)
+  std::map<std::string,ViewBase *>::iterator iter = m_views.begin();
+  for ( ; iter != m_views.end(); ++iter) {
+    if ( ! ( readCache && m_cache->MapView(iter->first,entry,iter->second) ) ) iter->second->Update();
+  }
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::EnableColumnCache(const std::string & directory)
+{
+
+  if ( m_cache ) {
+    m_log << Log::ERROR << "Column cache already enabled!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_pipeline ) {
+    m_log << Log::ERROR << "Column cache can't be combined with the pipeline!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_bulk ) {
+    m_log << Log::ERROR << "Column cache can't be combined with bulk reading!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  m_cache = new ColumnCache(directory,m_log.GetLevel());
+
+  m_log << Log::INFO << "Column cache enabled in directory \"" << directory << "\"" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::EnablePipeline(unsigned int depth, unsigned int batchSize, unsigned int nWriters, unsigned int blockSize, bool keepOrder)
+{
+
+  if ( m_pipeline ) {
+    m_log << Log::ERROR << "Pipeline already enabled!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_cache ) {
+    m_log << Log::ERROR << "Pipeline can't be combined with the column cache!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_bulk ) {
+    m_log << Log::ERROR << "Pipeline can't be combined with bulk reading!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_inTree ) {
+    m_log << Log::ERROR << "Pipeline must be enabled before the first input tree is loaded!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  m_pipeline = new EventPipeline(depth,batchSize,m_log.GetLevel());
+  m_pipeline->SetCacheSize(m_inputCacheSize);
+  m_pipeline->SetWriters(nWriters,blockSize,keepOrder);
+
+  m_log << Log::INFO << "Pipeline enabled, " << depth << " batches of " << batchSize << " entries, " << nWriters << " writers" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::EnableImplicitMT(unsigned int poolSize)
+{
+
+  // baskets of the branches of an entry are decompressed and deserialised in parallel by ROOT's
+  // thread pool (pool size 0 uses all cores). Entries are still read one after the other, in order
+  ROOT::EnableImplicitMT(poolSize);
+  if ( ! ROOT::IsImplicitMTEnabled() ) {
+    m_log << Log::ERROR << "Couldn't enable implicit multi-threading - ROOT was built without it (imt)" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  m_log << Log::INFO << "Implicit multi-threading enabled, pool of " << ROOT::GetThreadPoolSize() << " threads" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::EnableBulkRead()
+{
+
+  if ( m_bulk ) {
+    m_log << Log::ERROR << "Bulk reading already enabled!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_cache || m_pipeline ) {
+    m_log << Log::ERROR << "Bulk reading can't be combined with the column cache or the pipeline!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( m_inTree ) {
+    m_log << Log::ERROR << "Bulk reading must be enabled before the first input tree is loaded!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  m_bulk = new BulkReader(m_log.GetLevel());
+
+  m_log << Log::INFO << "Bulk reading of scalar branches enabled" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void Service::SetInputCacheSize(long bytes)
+{
+
+  m_inputCacheSize = bytes;
+  if ( m_pipeline ) m_pipeline->SetCacheSize(bytes);
+
+}
+
+
+GLOBAL::STATUS Service::StartPipeline()
+{
+
+  // output trees and columnar outputs of chains are filled by the writer thread
+  std::vector<TTree *>        outTrees;
+  std::vector<ColumnOutput *> columnOutputs;
+  for (unsigned int i = 0; i < m_chains.size(); ++i) {
+    const ChainState & chain = m_chains[i];
+    outTrees.push_back( chain.hasOutput && chain.treeOutput ? chain.outTree : 0 );
+    columnOutputs.push_back( chain.hasOutput ? chain.columnOutput : 0 );
+  }
+
+  return m_pipeline->Start(m_inTree, m_inFiles.at(m_counter - 1)->GetName(), outTrees, columnOutputs, m_entryList);
+
+}
+
+
+GLOBAL::STATUS Service::FinishInTree()
+{
+
+  // write output of entries still in the pipeline, and stop its threads
+  if ( m_pipeline && m_pipeline->Stop() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::EnableColumnOutput(const std::string & fileName)
+{
+
+  ChainState & chain = m_chains[m_activeChain];
+  if ( chain.columnOutput ) {
+    m_log << Log::ERROR << "Columnar output already enabled!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  if ( chain.outTree ) {
+    m_log << Log::ERROR << "Columnar output must be enabled before the output tree is prepared!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  chain.columnOutput = new ColumnOutput(fileName,m_treeName,m_log.GetLevel());
+
+  m_log << Log::INFO << "Columnar output enabled, file name = \"" << fileName << "\"" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::FillOutput()
+{
+
+  // output is filled by writer thread of pipeline
+  if ( m_pipeline && m_pipeline->IsRunning() ) {
+    m_pipeline->Fill(m_activeChain);
+    return GLOBAL::SUCCESS;
+  }
+
+  // ROOT ntuple
+  ChainState & chain = m_chains[m_activeChain];
+  if ( chain.treeOutput && chain.outTree->Fill() < 0 ) {
+    m_log << Log::ERROR << "Couldn't fill output tree" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  // columnar output
+  if ( chain.columnOutput && chain.columnOutput->Fill() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::CloseOutput()
+{
+
+  // write output still in the pipeline
+  if ( FinishInTree() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  // the ROOT ntuple is written together with its file - close columnar output
+  ChainState & chain = m_chains[m_activeChain];
+  if ( chain.columnOutput && chain.columnOutput->Close() != GLOBAL::SUCCESS ) return GLOBAL::ERROR;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::SetChains(const std::vector<std::string> & names)
+{
+
+  // chains must be defined before any output is prepared
+  for (unsigned int i = 0; i < m_chains.size(); ++i) {
+    if ( m_chains[i].outTree || m_chains[i].columnOutput ) {
+      m_log << Log::ERROR << "Chains must be defined before output is prepared!" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+  }
+  if ( names.empty() ) {
+    m_log << Log::ERROR << "No chains specified!" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  for (unsigned int i = 0; i < names.size(); ++i) {
+    if ( names[i].empty() || std::count(names.begin(),names.end(),names[i]) > 1 ) {
+      m_log << Log::ERROR << "Chain names must be non-empty and unique (\"" << names[i] << "\")" << Log::endl();
+      return GLOBAL::ERROR;
+    }
+  }
+
+  // replace default chain
+  ClearChains();
+  for (unsigned int i = 0; i < names.size(); ++i) AddChain(names[i]);
+  m_activeChain = 0;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+GLOBAL::STATUS Service::SetActiveChain(unsigned int index)
+{
+
+  if ( index >= m_chains.size() ) {
+    m_log << Log::ERROR << "Couldn't activate chain - index is out of range (" << index << ")" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+  m_activeChain = index;
+
+  return GLOBAL::SUCCESS;
+
+}
+
+
+void Service::ProtectInputs(const std::set<std::string> & names)
+{
+
+  // copy input variables declared as outputs (TrackInputVariable() only keeps track with more than one chain)
+  std::set<std::string>::const_iterator name = names.begin();
+  for ( ; name != names.end(); ++name) {
+    std::map<std::string,SnapshotBase *>::iterator iter = m_snapshots.find(*name);
+    if ( iter == m_snapshots.end() || std::find(m_protected.begin(),m_protected.end(),iter->second) != m_protected.end() ) continue;
+    m_protected.push_back(iter->second);
+    m_log << Log::INFO << "Input variable \"" << *name << "\" is overwritten by a selector - restoring it before each chain" << Log::endl();
+  }
+
+}
+
+
+void Service::SaveInputs()
+{
+
+  // all input variables are copied (not only those declared as outputs), so CheckInputs() can compare them
+  std::map<std::string,SnapshotBase *>::iterator snapshot = m_snapshots.begin();
+  for ( ; snapshot != m_snapshots.end(); ++snapshot) snapshot->second->Save();
+
+}
+
+
+GLOBAL::STATUS Service::CheckInputs()
+{
+
+  // input variables not declared as outputs are not restored - the next chain would see the modification
+  GLOBAL::STATUS status = GLOBAL::SUCCESS;
+  std::map<std::string,SnapshotBase *>::iterator snapshot = m_snapshots.begin();
+  for ( ; snapshot != m_snapshots.end(); ++snapshot) {
+    if ( std::find(m_protected.begin(),m_protected.end(),snapshot->second) != m_protected.end() || ! snapshot->second->IsModified() ) continue;
+    m_log << Log::ERROR << "Input variable \"" << snapshot->first << "\" was modified in chain \"" << GetChainName()
+	  << "\" without being declared as output - declare it with DeclareOutput() in the selector overwriting it" << Log::endl();
+    status = GLOBAL::ERROR;
+  }
+
+  return status;
+
+}
+
+
+void Service::RestoreInputs()
+{
+
+  for (unsigned int i = 0; i < m_protected.size(); ++i) m_protected[i]->Restore();
+
+}
+
+
+void Service::AddChain(const std::string & name)
+{
+
+  ChainState chain;
+  chain.name         = name;
+  chain.producers    = new ProducerRegistry(m_log.GetLevel());
+  chain.outTree      = 0;
+  chain.hasOutput    = true;
+  chain.treeOutput   = true;
+  chain.columnOutput = 0;
+  m_chains.push_back(chain);
+
+}
+
+
+void Service::ClearChains()
+{
+
+  for (unsigned int i = 0; i < m_chains.size(); ++i) {
+    ChainState & chain = m_chains[i];
+    delete chain.producers;
+    delete chain.columnOutput;
+    std::map<std::string,FieldBase *>::iterator buffer = chain.buffers.begin();
+    for ( ; buffer != chain.buffers.end(); ++buffer) delete buffer->second;
+  }
+  m_chains.clear();
+
+}
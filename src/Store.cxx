@@ -38,12 +38,16 @@ Store::Store(const Store & other)
 
   }
 
+  m_lines = other.m_lines;
+
 }
 
 
 Store& Store::operator=(const Store & other)
 {
 
+  std::lock_guard<std::mutex> lock(m_mutex);
+
   std::map<std::string,FieldBase*>::const_iterator it    = other.m_data.begin();
   std::map<std::string,FieldBase*>::const_iterator itEnd = other.m_data.end();
 
@@ -55,6 +59,7 @@ Store& Store::operator=(const Store & other)
     m_data[key] = value;
 
   }
+  m_lines = other.m_lines;
   
   return *this;
 
@@ -86,7 +91,9 @@ Store* Store::createStore(const char* filename)
   // bool           applyCorr   = true
   // double         Muons_ptmin = 25000.
   // vector<string> jetTools    = JetCleaning AnotherJetTool 
+  // string         cut         = my_float > 40 && my_int > 0
   //
+  // A string value is the rest of the line (words separated by single spaces).
   // Empty lines and lines beginning with '#' are ignored.
 
   ifstream steerFile( filename );
@@ -153,8 +160,9 @@ Store* Store::createStore(const char* filename)
 	else wrongNumTokens = true;
       }
       else if ( tokens[0].compare("string") == 0 ) {
-	if ( nTokens == 4 ) store->put<string>( tokens[1] , tokens[3] , true );
-	else wrongNumTokens = true;
+	string value = tokens[3];
+	for (unsigned int i = 4; i < nTokens; ++i) value += " " + tokens[i];
+	store->put<string>( tokens[1] , value , true );
       }
       else {      
 	vector<string> vec(tokens.begin()+3,tokens.end());
@@ -189,6 +197,11 @@ Store* Store::createStore(const char* filename)
       break;
     }
 
+    // keep line, so the configuration can be described
+    string text = tokens[0];
+    for (unsigned int i = 1; i < nTokens; ++i) text += " " + tokens[i];
+    store->m_lines[ tokens[1] ] = text;
+
   }
     
   return store;
@@ -199,6 +212,8 @@ Store* Store::createStore(const char* filename)
 void Store::remove(const std::string & key) 
 {
 
+  std::lock_guard<std::mutex> lock(m_mutex);
+
   std::map<std::string,FieldBase*>::iterator it = m_data.find(key);
   
   if ( it == m_data.end() ) {
@@ -209,6 +224,7 @@ void Store::remove(const std::string & key)
     it->second = 0;
     m_data.erase(key);
   }
+  m_lines.erase(key);
   
 }
 
@@ -217,6 +233,8 @@ void Store::remove(const std::string & key)
 void Store::flush() 
 {
 
+  std::lock_guard<std::mutex> lock(m_mutex);
+
   std::map<std::string,FieldBase*>::iterator it    = m_data.begin();
   std::map<std::string,FieldBase*>::iterator itEnd = m_data.end();
 
@@ -226,6 +244,21 @@ void Store::flush()
   }
 
   m_data.clear();
+  m_lines.clear();
+
+}
+
+
+std::string Store::describe(const std::string & prefix) const
+{
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::string text;
+  std::map<std::string,std::string>::const_iterator it = m_lines.lower_bound(prefix);
+  for ( ; it != m_lines.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) text += it->second + "\n";
+
+  return text;
 
 }
 
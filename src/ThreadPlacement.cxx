@@ -0,0 +1,163 @@
+// Standard Template Library includes
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+// POSIX includes
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Analysis includes
+#include "ThreadPlacement.h"
+#include "Store.h"
+
+
+namespace {
+
+  // names and card file keys of roles
+  const char * g_names[ThreadPlacement::NROLES] = { "main" , "selector worker" , "pipeline reader" , "pipeline writer" , "pipeline sink" };
+  const char * g_keys [ThreadPlacement::NROLES] = { "mainCpus" , "workerCpus" , "readerCpus" , "writerCpus" , "sinkCpus" };
+
+  // cores of roles
+  std::mutex &                       Mutex() { static std::mutex mutex; return mutex; }
+  std::vector<int>                   g_cpus[ThreadPlacement::NROLES];
+  Log::LEVEL                         g_logLevel = Log::INFO;
+
+  // parse list of cores of sysfs (e.g. "0-7,16-23")
+  std::vector<int> ParseCpuList(const std::string & list)
+  {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while ( std::getline(ss,range,',') ) {
+      if ( range.empty() ) continue;
+      const std::string::size_type dash = range.find('-');
+      const int first = std::atoi( range.substr(0,dash).c_str() );
+      const int last  = dash == std::string::npos ? first : std::atoi( range.substr(dash + 1).c_str() );
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+
+  // cores of NUMA nodes (empty if the machine has no NUMA information)
+  std::vector<std::vector<int> > LoadNodes()
+  {
+    std::vector<std::vector<int> > nodes;
+    for (int node = 0; ; ++node) {
+      std::ifstream file( ( "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist" ).c_str() );
+      if ( ! file ) break;
+      std::string list;
+      std::getline(file,list);
+      nodes.push_back( ParseCpuList(list) );
+    }
+    return nodes;
+  }
+  const std::vector<std::vector<int> > & Nodes() { static const std::vector<std::vector<int> > nodes = LoadNodes(); return nodes; }
+
+  // cores as text
+  std::string ToString(const std::vector<int> & cpus)
+  {
+    std::ostringstream text;
+    for (unsigned int i = 0; i < cpus.size(); ++i) text << ( i ? " " : "" ) << cpus[i];
+    return text.str();
+  }
+
+}
+
+
+void ThreadPlacement::Configure(const Store & config, const Log::LEVEL & logLevel)
+{
+
+  Log log("ThreadPlacement");
+  log.SetLevel(logLevel);
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex());
+    g_logLevel = logLevel;
+    for (unsigned int role = 0; role < NROLES; ++role) config.getif<std::vector<int> >( g_keys[role] , g_cpus[role] );
+  }
+
+  // machine
+  const std::vector<std::vector<int> > & nodes = Nodes();
+  for (unsigned int node = 0; node < nodes.size(); ++node) {
+    log << Log::INFO << "NUMA node " << node << " : cores " << ToString(nodes[node]) << Log::endl();
+  }
+
+  // requested placement
+  bool pinned = false;
+  for (unsigned int role = 0; role < NROLES; ++role) {
+    if ( g_cpus[role].empty() ) continue;
+    std::ostringstream placement;
+    for (unsigned int i = 0; i < g_cpus[role].size(); ++i) placement << ( i ? ", " : "" ) << g_cpus[role][i] << " (node " << GetNode( g_cpus[role][i] ) << ")";
+    log << Log::INFO << "Pinning " << g_names[role] << " threads to cores " << placement.str() << Log::endl();
+    pinned = true;
+  }
+  if ( ! pinned ) {
+    log << Log::DEBUG << "Threads are not pinned to cores (see " << g_keys[MAIN] << ", " << g_keys[WORKER] << ", ... in card file)" << Log::endl();
+    return;
+  }
+
+  // threads sharing memory on different nodes - the reader and writers exchange entries with the main thread
+  const int mainNode = g_cpus[MAIN].empty() ? -1 : GetNode( g_cpus[MAIN][0] );
+  for (unsigned int role = WORKER; role < NROLES && mainNode >= 0; ++role) {
+    for (unsigned int i = 0; i < g_cpus[role].size(); ++i) {
+      if ( GetNode( g_cpus[role][i] ) < 0 || GetNode( g_cpus[role][i] ) == mainNode ) continue;
+      log << Log::WARNING << "Core " << g_cpus[role][i] << " of " << g_names[role] << " threads is not on NUMA node " << mainNode
+	  << " of the main thread - buffers shared with it are remote" << Log::endl();
+    }
+  }
+
+  Apply(MAIN,0);
+
+}
+
+
+void ThreadPlacement::Apply(ROLE role, unsigned int index)
+{
+
+  std::lock_guard<std::mutex> lock(Mutex());
+  if ( g_cpus[role].empty() ) return;
+  const int cpu = g_cpus[role][ index % g_cpus[role].size() ];
+
+  Log log("ThreadPlacement");
+  log.SetLevel(g_logLevel);
+
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if ( cpu < 0 || cpu >= CPU_SETSIZE ) {
+    log << Log::WARNING << "Couldn't pin " << g_names[role] << " thread " << index << " to core " << cpu << " - no such core" << Log::endl();
+    return;
+  }
+  CPU_SET(cpu, &set);
+  const int error = pthread_setaffinity_np( pthread_self() , sizeof(set) , &set );
+  if ( error != 0 ) {
+    log << Log::WARNING << "Couldn't pin " << g_names[role] << " thread " << index << " to core " << cpu << " - " << std::strerror(error) << Log::endl();
+    return;
+  }
+  log << Log::INFO << "Pinned " << g_names[role] << " thread " << index << " to core " << cpu << " (NUMA node " << GetNode(cpu) << ")" << Log::endl();
+#else
+  log << Log::WARNING << "Pinning threads to cores is only supported on Linux - " << g_names[role] << " thread " << index << " is not pinned" << Log::endl();
+#endif
+
+}
+
+
+int ThreadPlacement::GetNode(int cpu)
+{
+
+  const std::vector<std::vector<int> > & nodes = Nodes();
+  for (unsigned int node = 0; node < nodes.size(); ++node) {
+    for (unsigned int i = 0; i < nodes[node].size(); ++i) {
+      if ( nodes[node][i] == cpu ) return node;
+    }
+  }
+
+  return -1;
+
+}
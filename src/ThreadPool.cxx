@@ -0,0 +1,98 @@
+// Analysis includes
+#include "ThreadPool.h"
+#include "Tracer.h"
+#include "ThreadPlacement.h"
+
+
+ThreadPool::ThreadPool(unsigned int nThreads) :
+  m_function(0),
+  m_n(0),
+  m_next(0),
+  m_active(0),
+  m_generation(0),
+  m_stop(false)
+{
+
+  for (unsigned int i = 1; i < nThreads; ++i) m_threads.push_back( std::thread(&ThreadPool::Work,this,i - 1) );
+
+}
+
+
+ThreadPool::~ThreadPool()
+{
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_start.notify_all();
+  for (unsigned int i = 0; i < m_threads.size(); ++i) m_threads[i].join();
+
+}
+
+
+void ThreadPool::Run(unsigned int n, const std::function<void(unsigned int)> & function)
+{
+
+  // nothing to share
+  if ( m_threads.empty() || n == 1 ) {
+    for (unsigned int i = 0; i < n; ++i) function(i);
+    return;
+  }
+
+  // wake up workers
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_function = &function;
+    m_n        = n;
+    m_next     = 0;
+    m_active   = m_threads.size();
+    ++m_generation;
+  }
+  m_start.notify_all();
+
+  // take part in the work
+  Drain();
+
+  // wait for workers (every worker passes through each generation once)
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_active == 0; });
+  m_function = 0;
+
+}
+
+
+void ThreadPool::Work(unsigned int index)
+{
+
+  ThreadPlacement::Apply( ThreadPlacement::WORKER , index );
+  Tracer::SetThreadName( "selector worker" );
+  unsigned long generation = 0;
+
+  while ( true ) {
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start.wait(lock, [this,generation] { return m_stop || m_generation != generation; });
+      if ( m_stop ) return;
+      generation = m_generation;
+    }
+
+    Drain();
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if ( --m_active == 0 ) m_done.notify_one();
+    }
+
+  }
+
+}
+
+
+void ThreadPool::Drain()
+{
+
+  for (unsigned int i = m_next++; i < m_n; i = m_next++) (*m_function)(i);
+
+}
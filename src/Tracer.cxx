@@ -0,0 +1,191 @@
+// Standard Template Library includes
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+// Analysis includes
+#include "Tracer.h"
+
+
+namespace {
+
+  // span of a thread
+  struct Entry {
+    unsigned int name;
+    long long    start;
+    long long    end;
+  };
+
+  // ring buffer of a thread (only written by its thread)
+  struct Buffer {
+    std::string        name;
+    unsigned int       tid;
+    std::vector<Entry> entries;
+    unsigned long      count;
+  };
+
+  std::atomic<bool>         g_enabled(false);
+  std::atomic<unsigned int> g_capacity(1000000);
+  std::atomic<long long>    g_epoch(0);
+  thread_local Buffer *     t_buffer = 0;
+
+  // buffers of all threads, and names and categories of spans (name 0 is "other")
+  std::mutex & Mutex() { static std::mutex mutex; return mutex; }
+  std::vector<Buffer *> & Buffers() { static std::vector<Buffer *> buffers; return buffers; }
+  std::vector<std::pair<std::string,std::string> > & Names() 
+  { 
+    static std::vector<std::pair<std::string,std::string> > names(1,std::make_pair(std::string("other"),std::string("framework"))); 
+    return names; 
+  }
+
+  // buffer of calling thread (created on first use, it lives until the program terminates)
+  Buffer & ThreadBuffer()
+  {
+    if ( ! t_buffer ) {
+      std::lock_guard<std::mutex> lock(Mutex());
+      t_buffer = new Buffer();
+      t_buffer->tid   = Buffers().size() + 1;
+      t_buffer->name  = "thread " + std::to_string(t_buffer->tid);
+      t_buffer->entries.resize( g_capacity.load() > 0 ? g_capacity.load() : 1 );
+      t_buffer->count = 0;
+      Buffers().push_back(t_buffer);
+    }
+    return *t_buffer;
+  }
+
+  // string as JSON string
+  std::string Quote(const std::string & text)
+  {
+    std::string quoted = "\"";
+    for (unsigned int i = 0; i < text.size(); ++i) {
+      if ( text[i] == '"' || text[i] == '\\' ) quoted += '\\';
+      if ( static_cast<unsigned char>(text[i]) >= 0x20 ) quoted += text[i];
+    }
+    return quoted + "\"";
+  }
+
+}
+
+
+void Tracer::Enable(bool enable, unsigned int capacity)
+{
+
+  // times are counted from the first time the tracer is enabled
+  if ( enable ) {
+    long long expected = 0;
+    g_epoch.compare_exchange_strong(expected, std::chrono::steady_clock::now().time_since_epoch().count());
+    g_capacity.store(capacity);
+  }
+  g_enabled.store(enable, std::memory_order_relaxed);
+
+}
+
+
+bool Tracer::IsEnabled()
+{
+
+  return g_enabled.load(std::memory_order_relaxed);
+
+}
+
+
+unsigned int Tracer::AddName(const std::string & name, const std::string & category)
+{
+
+  std::lock_guard<std::mutex> lock(Mutex());
+  std::vector<std::pair<std::string,std::string> > & names = Names();
+  for (unsigned int i = 0; i < names.size(); ++i) {
+    if ( names[i].first == name ) return i;
+  }
+  if ( names.size() == MAXNAMES ) return 0;
+  names.push_back( std::make_pair(name,category) );
+
+  return names.size() - 1;
+
+}
+
+
+void Tracer::SetThreadName(const std::string & name)
+{
+
+  // threads started while disabled get no buffer (and appear with a number if they record later)
+  if ( ! IsEnabled() ) return;
+  Buffer & buffer = ThreadBuffer();
+  std::lock_guard<std::mutex> lock(Mutex());
+  buffer.name = name;
+
+}
+
+
+long long Tracer::Now()
+{
+
+  const long long ticks = std::chrono::steady_clock::now().time_since_epoch().count() - g_epoch.load(std::memory_order_relaxed);
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::duration(ticks) ).count();
+
+}
+
+
+void Tracer::Record(unsigned int name, long long start, long long end)
+{
+
+  Buffer & buffer = ThreadBuffer();
+  Entry & entry = buffer.entries[ buffer.count % buffer.entries.size() ];
+  entry.name  = name < MAXNAMES ? name : 0;
+  entry.start = start;
+  entry.end   = end;
+  ++buffer.count;
+
+}
+
+
+GLOBAL::STATUS Tracer::Write(const std::string & fileName, const Log::LEVEL & logLevel)
+{
+
+  Log log("Tracer");
+  log.SetLevel(logLevel);
+
+  std::ofstream file( fileName.c_str() );
+  if ( ! file ) {
+    log << Log::ERROR << "Couldn't open file \"" << fileName << "\" for writing the trace" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  std::lock_guard<std::mutex> lock(Mutex());
+  const std::vector<std::pair<std::string,std::string> > & names = Names();
+  const std::vector<Buffer *> & buffers = Buffers();
+
+  // thread names, and spans of each thread (oldest first) as complete events - times in microseconds
+  unsigned long nSpans = 0, nDropped = 0;
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::fixed << std::setprecision(3);
+  for (unsigned int b = 0; b < buffers.size(); ++b) {
+    const Buffer & buffer = *buffers[b];
+    file << ( b ? ",\n" : "\n" ) << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.tid << ",\"args\":{\"name\":" << Quote(buffer.name) << "}}";
+    const unsigned long capacity = buffer.entries.size();
+    const unsigned long first = buffer.count > capacity ? buffer.count - capacity : 0;
+    for (unsigned long i = first; i < buffer.count; ++i) {
+      const Entry & entry = buffer.entries[ i % capacity ];
+      file << ",\n{\"name\":" << Quote(names[entry.name].first) << ",\"cat\":" << Quote(names[entry.name].second) 
+	   << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.tid << ",\"ts\":" << entry.start * 1e-3 << ",\"dur\":" << ( entry.end - entry.start ) * 1e-3 << "}";
+    }
+    nSpans   += buffer.count - first;
+    nDropped += first;
+  }
+  file << "\n]}\n";
+  file.close();
+  if ( ! file ) {
+    log << Log::ERROR << "Couldn't write trace to file \"" << fileName << "\"" << Log::endl();
+    return GLOBAL::ERROR;
+  }
+
+  log << Log::INFO << "Wrote " << nSpans << " spans of " << buffers.size() << " threads to \"" << fileName << "\"" << Log::endl();
+  if ( nDropped > 0 ) log << Log::WARNING << "Dropped the " << nDropped << " oldest spans - increase traceBufferSize to keep them" << Log::endl();
+
+  return GLOBAL::SUCCESS;
+
+}